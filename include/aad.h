@@ -0,0 +1,116 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace aemps {
+
+// Minimal tape for reverse-mode algorithmic differentiation. Every operation
+// on an AReal appends one node holding the local partials w.r.t. at most two
+// arguments; propagate() then sweeps the adjoints backwards. Monte Carlo
+// adjoints record inputs once, then per path: mark(), record, propagate down
+// to the mark and rewind(), so the tape never grows beyond one path and the
+// input adjoints sum over all paths.
+class Tape {
+public:
+    struct Node {
+        double partial[2];
+        std::uint32_t arg[2];
+    };
+
+    std::size_t size() const { return nodes_.size(); }
+    void reserve(std::size_t n) {
+        nodes_.reserve(n);
+        adjoints_.reserve(n);
+    }
+
+    std::size_t record(double d0, std::size_t a0, double d1, std::size_t a1) {
+        nodes_.push_back({{d0, d1}, {static_cast<std::uint32_t>(a0), static_cast<std::uint32_t>(a1)}});
+        adjoints_.push_back(0.0);
+        return nodes_.size() - 1;
+    }
+    std::size_t record(double d0, std::size_t a0) { return record(d0, a0, 0.0, a0); }
+    std::size_t record_leaf() { return record(0.0, nodes_.size()); }
+
+    std::size_t mark() const { return nodes_.size(); }
+    // Drops nodes [mark, size()); adjoints below the mark are kept
+    void rewind(std::size_t mark) {
+        nodes_.resize(mark);
+        adjoints_.resize(mark);
+    }
+
+    double& adjoint(std::size_t i) { return adjoints_[i]; }
+    double adjoint(std::size_t i) const { return adjoints_[i]; }
+
+    // Pushes the adjoints of nodes [stop, from] onto their arguments,
+    // last node first
+    void propagate(std::size_t from, std::size_t stop);
+
+private:
+    std::vector<Node> nodes_;
+    std::vector<double> adjoints_;
+};
+
+// Active double: a value plus its node on a tape
+class AReal {
+public:
+    AReal() = default;
+    AReal(Tape& tape, double value) : tape_(&tape), value_(value), index_(tape.record_leaf()) {}
+    AReal(Tape& tape, double value, std::size_t index) : tape_(&tape), value_(value), index_(index) {}
+
+    double value() const { return value_; }
+    std::size_t index() const { return index_; }
+    Tape& tape() const { return *tape_; }
+    double adjoint() const { return tape_->adjoint(index_); }
+
+private:
+    Tape* tape_ = nullptr;
+    double value_ = 0.0;
+    std::size_t index_ = 0;
+};
+
+inline AReal operator+(const AReal& a, const AReal& b) {
+    return AReal(a.tape(), a.value() + b.value(), a.tape().record(1.0, a.index(), 1.0, b.index()));
+}
+inline AReal operator-(const AReal& a, const AReal& b) {
+    return AReal(a.tape(), a.value() - b.value(), a.tape().record(1.0, a.index(), -1.0, b.index()));
+}
+inline AReal operator*(const AReal& a, const AReal& b) {
+    return AReal(a.tape(), a.value() * b.value(), a.tape().record(b.value(), a.index(), a.value(), b.index()));
+}
+inline AReal operator/(const AReal& a, const AReal& b) {
+    const double inv = 1.0 / b.value();
+    return AReal(a.tape(), a.value() * inv,
+                 a.tape().record(inv, a.index(), -a.value() * inv * inv, b.index()));
+}
+inline AReal operator-(const AReal& a) { return AReal(a.tape(), -a.value(), a.tape().record(-1.0, a.index())); }
+
+inline AReal operator+(const AReal& a, double b) { return AReal(a.tape(), a.value() + b, a.tape().record(1.0, a.index())); }
+inline AReal operator+(double a, const AReal& b) { return b + a; }
+inline AReal operator-(const AReal& a, double b) { return a + -b; }
+inline AReal operator-(double a, const AReal& b) { return AReal(b.tape(), a - b.value(), b.tape().record(-1.0, b.index())); }
+inline AReal operator*(const AReal& a, double b) { return AReal(a.tape(), a.value() * b, a.tape().record(b, a.index())); }
+inline AReal operator*(double a, const AReal& b) { return b * a; }
+inline AReal operator/(const AReal& a, double b) { return a * (1.0 / b); }
+
+inline AReal exp(const AReal& a) {
+    const double e = std::exp(a.value());
+    return AReal(a.tape(), e, a.tape().record(e, a.index()));
+}
+inline AReal log(const AReal& a) {
+    return AReal(a.tape(), std::log(a.value()), a.tape().record(1.0 / a.value(), a.index()));
+}
+// The partial at 0 is taken as 0 rather than infinity, so zero-variance
+// inputs differentiate to 0 instead of poisoning the sweep with NaNs
+inline AReal sqrt(const AReal& a) {
+    const double s = std::sqrt(a.value());
+    return AReal(a.tape(), s, a.tape().record(s > 0.0 ? 0.5 / s : 0.0, a.index()));
+}
+// Pathwise derivative of the kink: 1 where a > b, else 0
+inline AReal max(const AReal& a, double b) {
+    const bool above = a.value() > b;
+    return AReal(a.tape(), above ? a.value() : b, a.tape().record(above ? 1.0 : 0.0, a.index()));
+}
+
+}
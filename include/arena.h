@@ -0,0 +1,102 @@
+#pragma once
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <vector>
+#include "utils.h"
+
+namespace aemps {
+
+// Bump allocator over cache-line aligned chunks for per-simulation scratch.
+// Allocation is a pointer bump, deallocation is a no-op, and rewinding to a
+// marker releases everything allocated after it at once. Chunks are kept
+// across rewinds, so a thread that prices repeatedly reuses the same
+// already-faulted pages; when a full reset finds the scratch spread over
+// several chunks it folds them into one sized for the high-water mark.
+class Arena {
+public:
+    struct Marker {
+        std::size_t chunk;
+        std::size_t offset;
+    };
+
+    explicit Arena(std::size_t chunk_bytes = std::size_t(1) << 20) : chunk_bytes_(chunk_bytes) {}
+    ~Arena();
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Alignment must be a power of two no larger than kCacheLine
+    void* allocate(std::size_t bytes, std::size_t alignment = kCacheLine);
+
+    Marker mark() const { return {current_, offset_}; }
+    void rewind(const Marker& m);
+    // Rewinds to empty and consolidates chunks
+    void reset();
+
+    std::size_t capacity() const;   // bytes held
+    std::size_t high_water() const { return high_water_; }
+
+private:
+    struct Chunk {
+        char* data;
+        std::size_t size;
+    };
+    std::size_t used() const;
+
+    std::vector<Chunk> chunks_;
+    std::size_t current_ = 0;
+    std::size_t offset_ = 0;
+    std::size_t chunk_bytes_;
+    std::size_t high_water_ = 0;
+};
+
+// Arena of the calling thread; engine blocks draw their scratch from it
+Arena& thread_arena();
+
+// Rewinds an arena to where it was on construction. An outermost scope
+// (arena empty on entry) resets it, so its chunks consolidate between
+// requests.
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena& arena = thread_arena()) : arena_(arena), mark_(arena.mark()) {}
+    ~ArenaScope() {
+        if (mark_.chunk == 0 && mark_.offset == 0)
+            arena_.reset();
+        else
+            arena_.rewind(mark_);
+    }
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+    Arena& arena_;
+    Arena::Marker mark_;
+};
+
+// Standard allocator over an Arena; storage lives until the arena rewinds
+template <class T>
+struct ArenaAllocator {
+    using value_type = T;
+
+    ArenaAllocator(Arena& arena = thread_arena()) : arena(&arena) {}
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(std::size_t n) {
+        if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) throw std::bad_alloc();
+        return static_cast<T*>(arena->allocate(n * sizeof(T)));
+    }
+    void deallocate(T*, std::size_t) {}
+
+    template <class U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template <class U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+
+    Arena* arena;
+};
+
+template <class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+}
@@ -1,13 +1,84 @@
 #pragma once
 #include "option.h"
+#include "scenario.h"
 
 namespace aemps {
 
+class VolatilityModel;
+
+// Analytic sensitivities. Vega and rho are per unit (not per percent) move,
+// theta is the per-year decay -dV/dT.
+struct Greeks {
+    double price;
+    double delta;
+    double gamma;
+    double vega;
+    double theta;
+    double rho;
+};
+
+// Output columns for batch Greeks; each non-null column receives batch.size
+// values. Null columns are skipped, and so is the work only they need.
+struct GreeksOutput {
+    double* price = nullptr;
+    double* delta = nullptr;
+    double* gamma = nullptr;
+    double* vega = nullptr;
+    double* theta = nullptr;
+    double* rho = nullptr;
+};
+
 class BlackScholes {
 public:
     // Returns Black-Scholes price for European option
     // volatility is annualized std dev
     static double price(const Option& opt, double rate, double volatility);
+
+    // Batch pricing over a structure-of-arrays book; writes batch.size
+    // prices to `prices`. Expired or zero-vol contracts price at their
+    // discounted intrinsic value. Precision::Single prices in float to
+    // within 1e-6 relative of Double; out-of-the-money contracts, whose
+    // price cancels too many float digits, are priced again in double.
+    static void price(const OptionBatch& batch, double* prices, Precision precision = Precision::Double);
+
+    // Batch pricing with each contract's vol read from `vol` at its strike
+    // and maturity instead of batch.volatility
+    static void price(const OptionBatch& batch, const VolatilityModel& vol, double* prices);
+
+    // The book under every scenario in one call: writes batch.size *
+    // scenarios.size() prices, contract i under scenario k at
+    // prices[i * scenarios.size() + k]. Lanes run across the scenarios, so
+    // each contract's log-moneyness, sqrt(T) and type are worked out once
+    // for all of them. Spot shifts must be above -1.
+    static void price(const OptionBatch& batch, const ScenarioSet& scenarios, double* prices);
+
+    // Book value under each scenario, sum_i quantity[i] * price, into
+    // scenarios.size() values, without materialising the price matrix;
+    // a null `quantity` weights every contract 1. Base these on a scenario
+    // of zero shifts to get scenario P&L.
+    static void book_values(const OptionBatch& batch, const double* quantity, const ScenarioSet& scenarios,
+                            double* values);
+
+    // Price and all Greeks from one evaluation of d1, d2 and the discount
+    static Greeks greeks(const Option& opt, double rate, double volatility);
+
+    // Batch price and Greeks; d1/d2, N(d1), N(d2), n(d1) and exp(-rT) are
+    // evaluated once per contract and shared by every requested column
+    static void greeks(const OptionBatch& batch, const GreeksOutput& out);
+
+    // Batch Greeks with vols from `vol`, as in price(batch, vol, prices)
+    static void greeks(const OptionBatch& batch, const VolatilityModel& vol, const GreeksOutput& out);
+
+    // Volatility at which price(opt, rate, vol) == price. Returns NaN when
+    // the price is outside the no-arbitrage bounds or the option has
+    // expired, and 0 at exactly the discounted intrinsic value.
+    static double implied_vol(const Option& opt, double rate, double price);
+
+    // Implied vols for a whole chain: writes batch.size vols to `vols`
+    // from the quotes in `prices`; batch.volatility is not read. Vectorized
+    // like price(), at a fixed cost of about a dozen price evaluations per
+    // quote whatever the moneyness.
+    static void implied_vol(const OptionBatch& batch, const double* prices, double* vols);
 };
 
 }
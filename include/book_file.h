@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "option.h"
+
+namespace aemps {
+
+// Columnar on-disk option book, laid out so a read-only mapping of the file
+// is directly an OptionBatch: no parsing, no copies, and every process that
+// maps the same file shares one copy in the page cache.
+//
+// Version 1 layout, all little-endian:
+//
+//     offset 0   BookFileHeader (64 bytes)
+//     offset 64  column_count BookFileColumn entries (24 bytes each)
+//     ...        column data, each column starting on a 64-byte boundary
+//
+// Columns hold `rows` values in the in-memory representation of the
+// matching OptionBatch field (OptionType as its 32-bit enum value). Type,
+// strike, maturity and spot are required; volatility, rate and trade ids
+// are optional. Readers skip column ids they do not know, so columns can
+// be added without a version bump, which is reserved for layout changes.
+struct BookFileHeader {
+    char magic[8];               // "AEMPSBK" and a NUL
+    std::uint32_t version;       // 1
+    std::uint32_t byte_order;    // 0x01020304 as written by the producer
+    std::uint64_t rows;
+    std::uint32_t column_count;
+    std::uint32_t reserved[9];
+};
+
+enum class BookColumn : std::uint32_t { Type = 1, Strike, Maturity, Spot, Volatility, Rate, TradeId };
+
+struct BookFileColumn {
+    BookColumn id;
+    std::uint32_t element_size;
+    std::uint64_t offset; // from the start of the file
+    std::uint64_t bytes;
+};
+
+// Writes `batch` and, when not null, one trade id per row. Null
+// volatility or rate columns are left out. The file is written beside
+// `path` and renamed over it, so processes still mapping an older book
+// keep reading it intact. Throws std::runtime_error on I/O failure.
+void write_book_file(const std::string& path, const OptionBatch& batch, const std::uint64_t* trade_ids = nullptr);
+
+// Read-only mapping of a book file. view() points straight into the
+// mapping and stays valid for the lifetime of this object; optional
+// columns the file lacks are null there, so pricing callers fill in
+// volatility or rate themselves. Move-only.
+class MappedBook {
+public:
+    // Maps and validates `path`; throws std::runtime_error if it cannot
+    // be opened or is not a well-formed version 1 book
+    explicit MappedBook(const std::string& path);
+    ~MappedBook();
+    MappedBook(MappedBook&& other) noexcept;
+    MappedBook& operator=(MappedBook&& other) noexcept;
+    MappedBook(const MappedBook&) = delete;
+    MappedBook& operator=(const MappedBook&) = delete;
+
+    const OptionBatch& view() const { return view_; }
+    std::size_t size() const { return view_.size; }
+    const std::uint64_t* trade_ids() const { return trade_ids_; }
+
+private:
+    void* base_ = nullptr;
+    std::size_t length_ = 0;
+    OptionBatch view_;
+    const std::uint64_t* trade_ids_ = nullptr;
+};
+
+}
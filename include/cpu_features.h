@@ -0,0 +1,17 @@
+#pragma once
+
+namespace aemps {
+
+// Instruction sets the vectorized kernels are built for. Portable is the
+// baseline translation unit (SSE2 on x86-64, NEON on AArch64, plain vector
+// lowering elsewhere) and is always available.
+enum class SimdIsa { Portable, Sse2, Neon, Avx2, Avx512 };
+
+// ISA selected for the batch kernels. Detected once, on first use, as the
+// widest one supported by both the binary and the running CPU; the
+// AEMPS_SIMD environment variable (sse2, neon, avx2, avx512) can cap it.
+SimdIsa active_simd_isa();
+
+const char* to_string(SimdIsa isa);
+
+}
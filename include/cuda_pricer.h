@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include "monte_carlo_pricer.h"
+#include "option.h"
+
+namespace aemps {
+
+// Execution policy that runs whole pricing calls on a CUDA device: path
+// generation, payoff and the per-block reduction all happen on device and
+// only block partials come back. Part of the optional pricer_cuda target
+// (PRICER_ENABLE_CUDA); CPU-only builds never see it. The launch grid is
+// fixed by these settings, not by the GPU, so results are reproducible
+// across devices.
+struct CudaExecutor {
+    int device = 0;
+    unsigned threads_per_block = 256;
+    unsigned blocks_per_trade = 128;
+};
+
+// True when a CUDA device is visible to the process
+bool cuda_available();
+
+// GPU engine behind the MonteCarloPricer interface. Normals are PhiloxRng's
+// (seed, path, step) stream evaluated on device, so prices agree with
+// MonteCarloPricer<PhiloxRng> on the CPU to rounding, and whole batches go
+// out in one kernel launch. Vanilla payoffs with VarianceReduction None or
+// Antithetic (control variates reduce to the Black-Scholes price for
+// vanillas and are honoured on the host); in-pass Greeks, adaptive stopping
+// and Precision::Single are CPU-only and rejected with
+// std::invalid_argument. CUDA errors throw std::runtime_error.
+template <>
+class MonteCarloPricer<PhiloxRng, CudaExecutor, IncrementalPath> {
+public:
+    explicit MonteCarloPricer(const McConfig& config = McConfig(), CudaExecutor executor = CudaExecutor());
+
+    const McConfig& config() const { return config_; }
+
+    McResult price(const Option& opt, double rate, double volatility) const;
+
+    // Prices every option of the batch in a single launch; out holds
+    // batch.size results. batch.volatility and batch.rate must be set
+    // (std::invalid_argument otherwise).
+    void price(const OptionBatch& batch, McResult* out) const;
+
+private:
+    McConfig config_;
+    CudaExecutor executor_;
+};
+
+using CudaMonteCarloPricer = MonteCarloPricer<PhiloxRng, CudaExecutor>;
+
+}
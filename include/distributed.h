@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "monte_carlo_pricer.h"
+#include "option.h"
+
+namespace aemps {
+
+// Monte Carlo across processes and nodes over plain TCP. A run is cut into
+// tasks, each a contiguous range of one contract's path blocks, which the
+// coordinator deals to workers one at a time; a worker simulates its range
+// with MonteCarloPricer<PhiloxRng> on its own thread pool and sends back one
+// PathStats partial (sums, sums of squares, control and Greek accumulators)
+// per block. The coordinator merges them in block order, so a distributed
+// run reproduces a single-process MonteCarloPricer<PhiloxRng> run with the
+// same McConfig bit for bit, whatever the number of workers or the
+// interleaving. Adaptive stopping is not applied. A worker that cannot be
+// reached or drops its connection has its task handed to the others; the
+// run throws std::runtime_error once none are left, or with the message of
+// a task that failed on a worker.
+//
+// Frames carry a magic, protocol version, byte-order mark and the sender's
+// kernel ISA (active_simd_isa()) and are rejected on mismatch, so every rank
+// must run the same build family on hosts of one byte order and dispatch
+// the same ISA: the ISAs differ in FMA contraction, hence in the last bit.
+// A worker on another ISA turns tasks down and the others take them; cap a
+// mixed cluster to a common ISA with AEMPS_SIMD. There is no
+// authentication: listen on trusted networks only.
+class DistributedMc {
+public:
+    // endpoints are "host:port" of running workers (pricer_demo --mc-worker
+    // PORT). blocks_per_task == 0 picks about four tasks per worker.
+    explicit DistributedMc(std::vector<std::string> endpoints, std::size_t blocks_per_task = 0);
+
+    McResult price(const Option& opt, double rate, double volatility, const McConfig& config) const;
+
+    // One result per contract of the book, at batch.volatility and
+    // batch.rate; tasks from all contracts share the workers
+    std::vector<McResult> price(const OptionBatch& book, const McConfig& config) const;
+
+    const std::vector<std::string>& endpoints() const { return endpoints_; }
+
+private:
+    std::vector<std::string> endpoints_;
+    std::size_t blocks_per_task_;
+};
+
+// Worker side: answers tasks on the connected socket fd until the peer
+// closes it. Malformed frames end the connection; a task that throws is
+// answered with its error message, which the coordinator rethrows.
+void serve_mc_worker(int fd);
+
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include "heston.h"
+#include "path_kernels.h"
+#include "volatility_model.h"
+
+namespace aemps {
+
+// Path dynamics for MonteCarloPricer beyond its built-in GBM; pass a model
+// where price() takes a volatility. A model declares
+//
+//     using evolution_type = ...;
+//     evolution_type evolution(double spot, double maturity, double rate, std::size_t steps) const;
+//
+// and the evolution, built once per pricing call, advances whole blocks of
+// paths in log spot x, plus `state` extra SoA columns (e.g. the variance):
+//
+//     static constexpr std::size_t factors; // normals per path and step
+//     static constexpr std::size_t state;
+//     std::size_t steps; double maturity;
+//     void init(double* aux, std::size_t lanes) const;
+//     void advance(std::size_t step, double* x, double* aux, const double* z, std::size_t lanes) const;
+//
+// z holds `factors` rows of `lanes` independent normals and aux `state`
+// rows. Both evolutions below run one vectorized kernel per step.
+
+template <class Model, class = void>
+struct is_dynamics : std::false_type {};
+template <class Model>
+struct is_dynamics<Model, std::void_t<typename Model::evolution_type>> : std::true_type {};
+
+// Dupire local volatility sigma(t, S), tabulated on a uniform grid in time
+// and in log-moneyness y = ln(S / F(t)) and interpolated bilinearly, flat
+// beyond the grid. Immutable; share one instance across pricing threads.
+class LocalVolSurface {
+public:
+    // Local vols vols[i * space_nodes + j] at t = i * max_time /
+    // (time_nodes - 1) and y = y_min + j (y_max - y_min) / (space_nodes - 1).
+    // Needs at least two nodes per axis; throws std::invalid_argument.
+    LocalVolSurface(double max_time, std::size_t time_nodes, double y_min, double y_max, std::size_t space_nodes,
+                    std::vector<double> vols);
+
+    // Dupire's formula in total implied variance w(y, T),
+    //   sigma^2 = w_T / (1 - y w_y / w + (-1/4 - 1/w + y^2 / w^2) w_y^2 / 4 + w_yy / 2),
+    // by central differences of `implied` on a grid spanning +-width ATM
+    // standard deviations at max_time. Local variance is kept within
+    // [1e-8, 25] where the surface is not arbitrage-free.
+    static LocalVolSurface from_implied(const VolatilityModel& implied, double spot, double rate, double max_time,
+                                        std::size_t time_nodes = 64, std::size_t space_nodes = 161,
+                                        double width = 6.0);
+
+    double local_vol(double t, double y) const;
+    // Local vols at time t on every space node
+    void slice(double t, double* out) const;
+
+    double max_time() const { return max_time_; }
+    std::size_t space_nodes() const { return space_nodes_; }
+    double y_min() const { return y_min_; }
+    double dy() const { return dy_; }
+
+private:
+    double max_time_;
+    std::size_t time_nodes_;
+    double dt_;
+    double y_min_;
+    double dy_;
+    std::size_t space_nodes_;
+    std::vector<double> vols_;
+};
+
+// Log-Euler local-vol dynamics dS / S = r dt + sigma(t, S) dW with sigma
+// frozen over each step at its start
+class LocalVolModel {
+public:
+    explicit LocalVolModel(std::shared_ptr<const LocalVolSurface> surface);
+
+    class Evolution {
+    public:
+        static constexpr std::size_t factors = 1;
+        static constexpr std::size_t state = 0;
+        std::size_t steps;
+        double maturity;
+
+        void init(double*, std::size_t) const {}
+        void advance(std::size_t s, double* x, double*, const double* z, std::size_t lanes) const {
+            LocalVolStep step = step_;
+            step.vol = &slices_[s * step.nodes];
+            step.shift = shift_ + step.rate_dt * static_cast<double>(s);
+            local_vol_advance(x, z, lanes, step);
+        }
+
+    private:
+        friend class LocalVolModel;
+        std::vector<double> slices_; // steps rows of space nodes
+        LocalVolStep step_;
+        double shift_;
+    };
+    using evolution_type = Evolution;
+
+    Evolution evolution(double spot, double maturity, double rate, std::size_t steps) const;
+
+private:
+    std::shared_ptr<const LocalVolSurface> surface_;
+};
+
+// Heston dynamics by Andersen's QE scheme with martingale correction;
+// variance and spot take one normal each per step (two RNG dimensions,
+// 2s and 2s + 1, per step s)
+class HestonModel {
+public:
+    // Throws std::invalid_argument unless v0 >= 0, kappa, theta, xi > 0 and
+    // |rho| <= 1
+    explicit HestonModel(const HestonParams& params);
+
+    const HestonParams& params() const { return params_; }
+
+    class Evolution {
+    public:
+        static constexpr std::size_t factors = 2;
+        static constexpr std::size_t state = 1;
+        std::size_t steps;
+        double maturity;
+
+        void init(double* v, std::size_t lanes) const {
+            for (std::size_t i = 0; i < lanes; ++i) v[i] = v0_;
+        }
+        void advance(std::size_t, double* x, double* v, const double* z, std::size_t lanes) const {
+            heston_qe_advance(x, v, z, z + lanes, lanes, step_);
+        }
+
+    private:
+        friend class HestonModel;
+        HestonStep step_;
+        double v0_;
+    };
+    using evolution_type = Evolution;
+
+    Evolution evolution(double spot, double maturity, double rate, std::size_t steps) const;
+
+private:
+    HestonParams params_;
+};
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include "option.h"
+
+namespace aemps {
+
+// Heston parameters: dv = kappa (theta - v) dt + xi sqrt(v) dW_v,
+// d<W_v, W_S> = rho dt
+struct HestonParams {
+    double v0;
+    double kappa;
+    double theta;
+    double xi;
+    double rho;
+};
+
+// Semi-analytic Heston prices by the COS method (Fang & Oosterlee): the
+// put payoff is expanded in a cosine series on a truncated range of
+// ln(S_T / K), and calls follow by put-call parity. The characteristic
+// function depends on the maturity only, so a strike strip costs one set
+// of evaluations plus a vectorized series sum per strike; that is what
+// keeps calibration loops cheap. Stateless apart from the parameters.
+class HestonAnalytic {
+public:
+    // The range spans `width` times sqrt(c2 + sqrt(c4)) of ln(S_T) beyond
+    // the strip's extreme strikes (c_n its cumulants), and the series runs
+    // until |phi| < tolerance. Throws std::invalid_argument for invalid
+    // parameters, as HestonModel.
+    explicit HestonAnalytic(const HestonParams& params, double width = 10.0, double tolerance = 1e-12);
+
+    const HestonParams& params() const { return params_; }
+
+    double price(const Option& opt, double rate) const;
+
+    // Contracts sharing spot, maturity and rate; writes n prices. Prices
+    // are floored at the discounted intrinsic value.
+    void price_strip(double spot, double maturity, double rate, const OptionType* type, const double* strike,
+                     std::size_t n, double* prices) const;
+
+    // Whole book; batch.volatility is not read. Contracts are grouped by
+    // (maturity, spot, rate) and each group is priced as one strip.
+    void price(const OptionBatch& batch, double* prices) const;
+
+private:
+    HestonParams params_;
+    double width_;
+    double tolerance_;
+};
+
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "black_scholes.h"
+#include "option.h"
+#include "utils.h"
+#include "volatility_model.h"
+
+namespace aemps {
+
+// One market-data change: an underlier's spot or rate, or one node of its
+// vol grid (node = m * strikes + k, as in GridVolSurface)
+struct MarketUpdate {
+    enum class Field : std::uint8_t { Spot, Rate, Vol };
+
+    Field field;
+    std::uint32_t underlier;
+    std::uint32_t node;
+    double value;
+
+    static MarketUpdate spot(std::size_t underlier, double s) {
+        return {Field::Spot, static_cast<std::uint32_t>(underlier), 0, s};
+    }
+    static MarketUpdate rate(std::size_t underlier, double r) {
+        return {Field::Rate, static_cast<std::uint32_t>(underlier), 0, r};
+    }
+    static MarketUpdate vol(std::size_t underlier, std::size_t node, double v) {
+        return {Field::Vol, static_cast<std::uint32_t>(underlier), static_cast<std::uint32_t>(node), v};
+    }
+};
+
+// Black-Scholes book that keeps prices and Greeks cached per position and,
+// on a market-data tick, revalues only the positions that depend on it. A
+// dependency index maps every underlier to its positions and every node of
+// its vol grid to the positions whose interpolation reads that node, so a
+// spot tick costs one batch over that name and a vol-node tick one over a
+// handful of contracts, not a sweep of the book. Vols are sticky strike:
+// each position's vol is cached and only re-read from the surface when one
+// of its nodes moves. Per-underlier totals are kept up to date by the same
+// deltas. Not thread-safe; one market-data thread owns an instance.
+class IncrementalRepricer {
+public:
+    // Adds an underlier with its spot, rate and vol grid (vols[m * strikes
+    // + k], see GridVolSurface); returns its id
+    std::size_t add_underlier(double spot, double rate, std::vector<double> strikes, std::vector<double> maturities,
+                              std::vector<double> vols);
+
+    // Adds `quantity` of a European option on `underlier`, priced at once;
+    // returns its position id. Throws std::out_of_range for an unknown
+    // underlier.
+    std::size_t add_position(std::size_t underlier, OptionType type, double strike, double maturity,
+                             double quantity = 1.0);
+
+    // Applies a burst of updates, then revalues each affected position
+    // once, with each touched surface rebuilt once. Returns the number of
+    // positions revalued. Throws std::out_of_range for an unknown
+    // underlier or node, before anything is changed.
+    std::size_t apply(const MarketUpdate* updates, std::size_t n);
+    std::size_t apply(const MarketUpdate& update) { return apply(&update, 1); }
+
+    // Full revaluation of the book, also resetting the running totals
+    void reprice_all();
+
+    std::size_t positions() const { return book_.size(); }
+    std::size_t underliers() const { return underliers_.size(); }
+
+    // Cached unit price and Greeks of one position
+    Greeks position(std::size_t i) const;
+    // Quantity-weighted sum of position() over one underlier's positions
+    const Greeks& totals(std::size_t underlier) const;
+    const GridVolSurface& surface(std::size_t underlier) const;
+
+    // Cached columns indexed by position id
+    const OptionBook& book() const { return book_; }
+    const double* prices() const { return greeks_.price.data(); }
+
+private:
+    struct Underlier {
+        double spot;
+        double rate;
+        std::vector<double> vols;
+        std::shared_ptr<const GridVolSurface> surface;
+        std::vector<std::uint32_t> positions;
+        std::vector<std::vector<std::uint32_t>> node_positions;
+        Greeks totals{};
+        std::uint64_t stamp = 0; // epoch whose updates moved a vol node
+    };
+
+    struct Columns {
+        AlignedVector<double> price, delta, gamma, vega, theta, rho;
+
+        void resize(std::size_t n);
+        GreeksOutput output();
+    };
+
+    void mark(std::uint32_t position, bool revol);
+    void revalue();
+
+    OptionBook book_;
+    std::vector<std::uint32_t> underlier_of_;
+    std::vector<double> quantity_;
+    Columns greeks_;
+    std::vector<Underlier> underliers_;
+
+    // Positions marked in the current apply(), deduplicated by epoch stamp;
+    // vol_stamp_ flags those whose vol must be re-read from the surface
+    std::uint64_t epoch_ = 0;
+    std::vector<std::uint64_t> stamp_;
+    std::vector<std::uint64_t> vol_stamp_;
+    std::vector<std::uint32_t> dirty_;
+    std::vector<std::uint32_t> resurface_;
+
+    // Gather buffers for the dirty batch
+    OptionBook scratch_;
+    Columns fresh_;
+};
+
+}
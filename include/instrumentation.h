@@ -0,0 +1,111 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#if AEMPS_INSTRUMENTATION
+#include <chrono>
+#endif
+
+// Hot-path instrumentation, compiled in when AEMPS_INSTRUMENTATION is 1
+// (CMake: -DPRICER_ENABLE_INSTRUMENTATION=ON) and to nothing otherwise.
+// Each thread bumps its own counters with plain relaxed stores, so
+// recording never contends; a snapshot sums every thread, including those
+// that have exited.
+
+namespace aemps {
+
+// Monte Carlo engine stages, timed per block and step
+enum class Stage : std::uint8_t { Rng, PathEvolution, Payoff, Reduction };
+constexpr std::size_t kStageCount = 4;
+
+enum class Counter : std::uint8_t {
+    PathsSimulated,
+    CacheHits,   // VolPredictionCache lookups
+    CacheMisses,
+    Allocations, // aligned_alloc calls: SoA columns and arena chunks
+    ArenaChunks, // of which arena chunks
+    ResultCacheHits, // ResultCache lookups
+    ResultCacheMisses
+};
+constexpr std::size_t kCounterCount = 7;
+
+const char* to_string(Stage stage);
+const char* to_string(Counter counter);
+
+struct InstrumentationSnapshot {
+    std::uint64_t stage_ns[kStageCount] = {};
+    std::uint64_t stage_calls[kStageCount] = {};
+    std::uint64_t counters[kCounterCount] = {};
+    std::size_t threads = 0; // that have recorded anything
+
+    std::uint64_t operator[](Counter c) const { return counters[static_cast<std::size_t>(c)]; }
+    double seconds(Stage s) const { return 1e-9 * static_cast<double>(stage_ns[static_cast<std::size_t>(s)]); }
+    double cache_hit_rate() const;        // vol prediction cache; 0 before any lookup
+    double result_cache_hit_rate() const; // likewise for ResultCache
+};
+
+// Totals so far; all zero when instrumentation is compiled out.
+// Subtract two snapshots to get the activity in between.
+InstrumentationSnapshot instrumentation_snapshot();
+
+// Prometheus text exposition format (version 0.0.4)
+std::string to_prometheus(const InstrumentationSnapshot& snapshot);
+
+#if AEMPS_INSTRUMENTATION
+constexpr bool kInstrumentation = true;
+
+namespace detail {
+
+struct ThreadCounters {
+    std::atomic<std::uint64_t> stage_ns[kStageCount];
+    std::atomic<std::uint64_t> stage_calls[kStageCount];
+    std::atomic<std::uint64_t> counters[kCounterCount];
+};
+
+// The calling thread's counters, registered on first use
+ThreadCounters& thread_counters();
+
+// Single writer per counter, so no read-modify-write is needed
+inline void bump(std::atomic<std::uint64_t>& a, std::uint64_t n) {
+    a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+}
+
+inline void add_count(Counter c, std::uint64_t n = 1) {
+    detail::bump(detail::thread_counters().counters[static_cast<std::size_t>(c)], n);
+}
+
+// Adds the time until the end of the scope to `stage`
+class StageTimer {
+public:
+    explicit StageTimer(Stage stage) : stage_(stage), start_(std::chrono::steady_clock::now()) {}
+    ~StageTimer() {
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_);
+        detail::ThreadCounters& t = detail::thread_counters();
+        const std::size_t s = static_cast<std::size_t>(stage_);
+        detail::bump(t.stage_ns[s], static_cast<std::uint64_t>(ns.count()));
+        detail::bump(t.stage_calls[s], 1);
+    }
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    Stage stage_;
+    std::chrono::steady_clock::time_point start_;
+};
+#else
+constexpr bool kInstrumentation = false;
+
+inline void add_count(Counter, std::uint64_t = 1) {}
+
+class StageTimer {
+public:
+    explicit StageTimer(Stage) {}
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+};
+#endif
+
+}
@@ -0,0 +1,1224 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "aad.h"
+#include "arena.h"
+#include "black_scholes.h"
+#include "dynamics.h"
+#include "instrumentation.h"
+#include "option.h"
+#include "path_builder.h"
+#include "path_kernels.h"
+#include "payoff.h"
+#include "rng.h"
+#include "scenario.h"
+#include "thread_pool.h"
+#include "vol_term_structure.h"
+#include "volatility_model.h"
+
+namespace aemps {
+
+// Variance reduction applied by MonteCarloPricer. Antithetic pairs every
+// path with its mirror (-z at every step); ControlVariate regresses the
+// payoff on the terminal vanilla payoff, whose mean is the Black-Scholes
+// price, with the optimal beta estimated from the same paths.
+enum class VarianceReduction { None, Antithetic, ControlVariate, AntitheticControlVariate };
+
+// Estimators for the in-simulation Greeks. Pathwise differentiates the
+// payoff along each path (delta, vega) and uses its likelihood-ratio mix
+// for gamma; LikelihoodRatio weights the payoff by the score of the path
+// density and also works for discontinuous payoffs. Auto picks pathwise
+// whenever the payoff is Lipschitz.
+enum class GreekMethod { Auto, Pathwise, LikelihoodRatio };
+
+struct McConfig {
+    std::size_t paths = 100000;
+    std::size_t steps = 1;         // time steps per path
+    std::uint64_t seed = 42;
+    std::size_t block_size = 4096; // paths per scheduled block
+    VarianceReduction variance_reduction = VarianceReduction::None;
+    // Accumulate delta, gamma and vega in the pricing pass. They come from
+    // the terminal spot, so path-dependent payoffs reject them with
+    // std::invalid_argument; under non-GBM dynamics they stay zero.
+    bool greeks = false;
+    GreekMethod greek_method = GreekMethod::Auto;
+    // Adaptive mode: when > 0, price() stops after the first round of
+    // adaptive_round blocks whose standard error is at most this, with
+    // `paths` as the cap. For a confidence half-width h at quantile q
+    // (1.96 for 95%), pass h / q. Rounds have a fixed size, so where it
+    // stops does not depend on the thread count.
+    double target_std_error = 0.0;
+    std::size_t adaptive_round = 8;
+    // Single draws the normals in float where the RNG policy can
+    // (PhiloxRng); paths evolve and statistics accumulate in double either way
+    Precision precision = Precision::Double;
+};
+
+struct McResult {
+    double price = 0.0;
+    double std_error = 0.0;
+    std::size_t paths = 0;
+    double beta = 0.0; // control variate coefficient, 0 without one
+    bool converged = true; // adaptive mode: target_std_error was reached
+    // Filled when McConfig::greeks is set, for terminal payoffs under GBM;
+    // vega is per unit volatility
+    double delta = 0.0, delta_error = 0.0;
+    double gamma = 0.0, gamma_error = 0.0;
+    double vega = 0.0, vega_error = 0.0;
+};
+
+// Price with adjoint sensitivities to every model input
+struct McSensitivities {
+    double price = 0.0;
+    double std_error = 0.0;
+    std::size_t paths = 0;
+    double delta = 0.0;       // d price / d spot
+    double rho = 0.0;         // d price / d rate
+    std::vector<double> vega; // d price / d vols[j], one per bucket or grid node
+};
+
+// Early exercise for MonteCarloPricer::price_american. The holder may
+// exercise on `dates` equally spaced dates, the last at maturity: a
+// Bermudan, and the American in the limit of many dates. Longstaff-Schwartz
+// fits the exercise rule on `regression_paths` paths of their own, by least
+// squares of the continuation value on the powers 0 .. basis - 1 of the
+// moneyness S / K over the in-the-money paths of each date.
+struct ExerciseConfig {
+    static constexpr std::size_t kMaxBasis = 5;
+    std::size_t dates = 50;
+    std::size_t basis = 4;
+    std::size_t regression_paths = 1 << 16;
+};
+
+// Running moments of the per-sample payoff x and control c (a sample is one
+// path, or one antithetic pair average), kept as Welford means and centred
+// sums so long runs do not cancel catastrophically. Blocks are reduced in
+// block order, so the result does not depend on which thread ran which block.
+struct PathStats {
+    std::size_t n = 0;
+    double mean = 0.0;
+    double m2 = 0.0;   // sum of (x - mean)^2
+    double mean_c = 0.0;
+    double m2_c = 0.0;
+    double c_xc = 0.0; // sum of (x - mean)(c - mean_c)
+    std::size_t greek_n = 0;
+    double greek_mean[3] = {0.0, 0.0, 0.0}; // delta, gamma, vega
+    double greek_m2[3] = {0.0, 0.0, 0.0};
+
+    void add(double x) {
+        ++n;
+        const double dx = x - mean;
+        mean += dx / static_cast<double>(n);
+        m2 += dx * (x - mean);
+    }
+    void add(double x, double c) {
+        ++n;
+        const double inv = 1.0 / static_cast<double>(n);
+        const double dx = x - mean;
+        const double dc = c - mean_c;
+        mean += dx * inv;
+        mean_c += dc * inv;
+        m2 += dx * (x - mean);
+        m2_c += dc * (c - mean_c);
+        c_xc += dx * (c - mean_c);
+    }
+    void add_greeks(double delta, double gamma, double vega) {
+        const double g[3] = {delta, gamma, vega};
+        ++greek_n;
+        for (int k = 0; k < 3; ++k) {
+            const double d = g[k] - greek_mean[k];
+            greek_mean[k] += d / static_cast<double>(greek_n);
+            greek_m2[k] += d * (g[k] - greek_mean[k]);
+        }
+    }
+    // Chan et al. pairwise combination
+    void merge(const PathStats& other);
+    // Discounted mean and its standard error
+    McResult result(double discount) const;
+    // Control variate estimate x - beta (c - control_mean), beta = cov(x, c) / var(c)
+    McResult result(double discount, double control_mean) const;
+    // Discounted Greek means and standard errors into r
+    void greeks(double discount, McResult& r) const;
+};
+
+// Normal equations of one exercise date's regression of continuation
+// values y on the powers of moneyness m. The Gram matrix of monomials is a
+// Hankel matrix, so the power sums of m are all it takes: 2 basis - 1
+// accumulators plus basis cross sums per path, summed per block and merged
+// in block order.
+struct ExerciseMoments {
+    std::size_t n = 0;
+    double power[2 * ExerciseConfig::kMaxBasis - 1] = {}; // sum of m^j
+    double cross[ExerciseConfig::kMaxBasis] = {};         // sum of y m^j
+
+    void add(double m, double y, std::size_t basis) {
+        ++n;
+        double p = 1.0;
+        for (std::size_t j = 0; j + 1 < 2 * basis; ++j) {
+            power[j] += p;
+            if (j < basis) cross[j] += y * p;
+            p *= m;
+        }
+    }
+    void merge(const ExerciseMoments& other);
+    // Least-squares coefficients into beta by Cholesky; false when the
+    // system is singular or has fewer paths than unknowns
+    bool solve(std::size_t basis, double* beta) const;
+};
+
+// Fitted continuation value at moneyness m
+inline double continuation_value(const double* beta, std::size_t basis, double m) {
+    double c = beta[basis - 1];
+    for (std::size_t j = basis - 1; j-- > 0;) c = c * m + beta[j];
+    return c;
+}
+
+inline bool uses_antithetic(VarianceReduction vr) {
+    return vr == VarianceReduction::Antithetic || vr == VarianceReduction::AntitheticControlVariate;
+}
+
+inline bool uses_control_variate(VarianceReduction vr) {
+    return vr == VarianceReduction::ControlVariate || vr == VarianceReduction::AntitheticControlVariate;
+}
+
+// Parallelization strategies. Executors run body(block) for every block in
+// [0, blocks); blocks must be independent.
+struct SerialExecutor {
+    std::size_t concurrency() const { return 1; }
+
+    template <class F>
+    void parallel_for(std::size_t blocks, F&& body) const {
+        for (std::size_t b = 0; b < blocks; ++b) body(b);
+    }
+};
+
+// Spreads path blocks over a work-stealing ThreadPool
+class ThreadPoolExecutor {
+public:
+    ThreadPoolExecutor() : pool_(&default_thread_pool()) {}
+    explicit ThreadPoolExecutor(ThreadPool& pool) : pool_(&pool) {}
+
+    std::size_t concurrency() const { return pool_->concurrency(); }
+
+    template <class F>
+    void parallel_for(std::size_t blocks, F&& body) const {
+        pool_->parallel_for(blocks, std::function<void(std::size_t)>(std::ref(body)));
+    }
+
+private:
+    ThreadPool* pool_;
+};
+
+// Monte Carlo pricer for European options under geometric Brownian motion.
+// Paths are simulated in blocks of config.block_size; each block draws its
+// normals from its own Rng and contributes one PathStats partial. With
+// antithetic sampling, path 2k + 1 mirrors path 2k and the RNG is indexed by
+// pair k; the path count is rounded up to an even number. PathBuilder maps
+// RNG dimensions to time steps (see path_builder.h). Products are payoff
+// policies (see payoff.h); the Option overloads dispatch on its type once.
+template <class Rng = Mt19937Rng, class Executor = ThreadPoolExecutor, class PathBuilder = IncrementalPath>
+class MonteCarloPricer {
+public:
+    explicit MonteCarloPricer(const McConfig& config = McConfig(), Executor executor = Executor())
+        : config_(config), executor_(std::move(executor)) {}
+
+    const McConfig& config() const { return config_; }
+
+    McResult price(const Option& opt, double rate, double volatility) const {
+        return dispatch_payoff(opt, [&](const auto& payoff) {
+            return price(payoff, opt.spot, opt.maturity, rate, volatility);
+        });
+    }
+    template <class Payoff>
+    McResult price(const Payoff& payoff, double spot, double maturity, double rate, double volatility) const {
+        return run(payoff, spot, rate, Gbm(config_, maturity, rate, volatility));
+    }
+
+    // Price under the deterministic vol term structure that `vol` implies
+    // at the product's strike: step s diffuses the forward variance
+    // w(K, t_{s+1}) - w(K, t_s), so vanillas reprice at the surface's
+    // implied vol and path-dependent products see its term structure. The
+    // surface is read steps + 1 times per call, never per path.
+    McResult price(const Option& opt, double rate, const VolatilityModel& vol) const {
+        return dispatch_payoff(opt, [&](const auto& payoff) {
+            return price(payoff, opt.spot, opt.maturity, rate, vol);
+        });
+    }
+    template <class Payoff>
+    McResult price(const Payoff& payoff, double spot, double maturity, double rate, const VolatilityModel& vol) const {
+        return run(payoff, spot, rate, Gbm(config_, maturity, rate, payoff.control().strike, vol));
+    }
+
+    // Price under other dynamics (dynamics.h), such as LocalVolModel or
+    // HestonModel, on the same blocks, RNG dimensions and kernels as GBM.
+    // Control variates rely on the GBM closed form and are rejected with
+    // std::invalid_argument; in-pass Greeks are GBM-only and stay zero.
+    template <class Model, class = std::enable_if_t<is_dynamics<Model>::value>>
+    McResult price(const Option& opt, double rate, const Model& model) const {
+        return dispatch_payoff(opt, [&](const auto& payoff) {
+            return price(payoff, opt.spot, opt.maturity, rate, model);
+        });
+    }
+    template <class Payoff, class Model, class = std::enable_if_t<is_dynamics<Model>::value>>
+    McResult price(const Payoff& payoff, double spot, double maturity, double rate, const Model& model) const {
+        if (uses_control_variate(config_.variance_reduction))
+            throw std::invalid_argument("MonteCarloPricer: control variates need GBM dynamics");
+        return run(payoff, spot, rate, model.evolution(spot, maturity, rate, config_.steps));
+    }
+
+    // Prices under every scenario of `scenarios` (see scenario.h) from one
+    // set of normals, common random numbers: each block's increments are
+    // generated once into a steps x lanes buffer and every shifted market
+    // is simulated from it. The RNG is paid once rather than per scenario
+    // and scenario differences carry no fresh sampling noise. Result k
+    // matches price() on the market shifted by scenario k with the same
+    // config, bit for bit; all config().paths are run, as adaptive stopping
+    // would end scenarios at different rounds. Spot shifts must be above -1
+    // and the columns of equal length (std::invalid_argument otherwise).
+    std::vector<McResult> price(const Option& opt, double rate, double volatility,
+                                const ScenarioSet& scenarios) const {
+        return dispatch_payoff(opt, [&](const auto& payoff) {
+            return price(payoff, opt.spot, opt.maturity, rate, volatility, scenarios);
+        });
+    }
+    template <class Payoff>
+    std::vector<McResult> price(const Payoff& payoff, double spot, double maturity, double rate, double volatility,
+                                const ScenarioSet& scenarios) const;
+
+    // Distributed runs split the block sequence of one simulation across
+    // processes (see distributed.h): blocks() is its length,
+    // simulate_blocks() returns the partials of blocks [first, first + count),
+    // one per block, and combine() turns all blocks() partials, in block
+    // order, into the result. Every block seeds its own Rng from (seed, first
+    // draw), so this is price()'s result bit for bit whichever process ran
+    // which range. Adaptive stopping does not apply. Throws
+    // std::out_of_range for a range past blocks() and std::invalid_argument
+    // when combine() is not given exactly blocks() partials.
+    std::size_t blocks() const { return (total_draws() + draws_per_block() - 1) / draws_per_block(); }
+    std::vector<PathStats> simulate_blocks(const Option& opt, double rate, double volatility, std::size_t first,
+                                           std::size_t count) const {
+        return dispatch_payoff(opt, [&](const auto& payoff) {
+            return simulate_blocks(payoff, opt.spot, opt.maturity, rate, volatility, first, count);
+        });
+    }
+    template <class Payoff>
+    std::vector<PathStats> simulate_blocks(const Payoff& payoff, double spot, double maturity, double rate,
+                                           double volatility, std::size_t first, std::size_t count) const;
+    McResult combine(const Option& opt, double rate, double volatility, const std::vector<PathStats>& partials) const {
+        return dispatch_payoff(opt, [&](const auto& payoff) {
+            return combine(payoff, opt.spot, opt.maturity, rate, volatility, partials);
+        });
+    }
+    template <class Payoff>
+    McResult combine(const Payoff& payoff, double spot, double maturity, double rate, double volatility,
+                     const std::vector<PathStats>& partials) const;
+
+    // Early-exercise (Bermudan or American) price by Longstaff-Schwartz,
+    // in two passes. The rule is fitted backwards over regression paths of
+    // their own: each block keeps only its in-the-money spots per date plus
+    // one cash flow per path, and each date's regression sums those blocks'
+    // moments into one small dense solve. config().paths fresh paths then
+    // apply the rule block by block, so the price is out of sample (biased
+    // low by the rule's suboptimality) and costs O(block) memory whatever
+    // the path count. Paths step from exercise date to exercise date, exact
+    // for GBM, so config().steps does not apply; control variates use the
+    // European, adaptive stopping and Greeks do not apply. Throws
+    // std::invalid_argument for no dates or a basis outside [1, kMaxBasis].
+    McResult price_american(const Option& opt, double rate, double volatility,
+                            const ExerciseConfig& exercise = ExerciseConfig()) const {
+        return dispatch_payoff(opt, [&](const auto& payoff) {
+            return price_american(payoff, opt.spot, opt.maturity, rate, volatility, exercise);
+        });
+    }
+    template <class Payoff>
+    McResult price_american(const Payoff& payoff, double spot, double maturity, double rate, double volatility,
+                            const ExerciseConfig& exercise = ExerciseConfig()) const;
+
+    // Spot path of one simulation path, steps + 1 values starting at
+    // opt.spot, exactly as simulated by price(). Random-access RNGs touch
+    // only that path; stream RNGs replay the block that contains it.
+    // Throws std::out_of_range unless index < config().paths.
+    std::vector<double> path(const Option& opt, double rate, double volatility, std::uint64_t index) const;
+
+    // Price and adjoint (AAD) sensitivities to spot, rate and every vol
+    // bucket from a single simulation on the same paths as price(). Each path
+    // is recorded on a tape and swept back once, so the cost is a small
+    // constant multiple of one pricing run whatever the number of buckets.
+    // Antithetic pairs are averaged; control variates are not applied.
+    McSensitivities sensitivities(const Option& opt, double rate, const VolTermStructure& vol) const {
+        return dispatch_payoff(opt, [&](const auto& payoff) {
+            return sensitivities(payoff, opt.spot, opt.maturity, rate, vol);
+        });
+    }
+    template <class Payoff>
+    McSensitivities sensitivities(const Payoff& payoff, double spot, double maturity, double rate,
+                                  const VolTermStructure& vol) const;
+
+    // Same on a vol grid: the steps diffuse its forward variance at the
+    // strike, as price(opt, rate, vol) does for a surface, and vega holds
+    // d price / d vols[m * strikes + k] for every node, nonzero only on the
+    // nodes the strike's interpolation reads
+    McSensitivities sensitivities(const Option& opt, double rate, const GridVolSurface& vol) const {
+        return dispatch_payoff(opt, [&](const auto& payoff) {
+            return sensitivities(payoff, opt.spot, opt.maturity, rate, vol);
+        });
+    }
+    template <class Payoff>
+    McSensitivities sensitivities(const Payoff& payoff, double spot, double maturity, double rate,
+                                  const GridVolSurface& vol) const;
+
+private:
+    // Per-step log drift and diffusion; flat unless built from a surface,
+    // in which case `volatility` is the effective vol sqrt(w(K, T) / T).
+    // Also the built-in evolution (see dynamics.h).
+    struct Gbm {
+        static constexpr std::size_t factors = 1;
+        static constexpr std::size_t state = 0;
+        std::size_t steps;
+        double maturity;
+        double volatility;
+        double dt;
+        double drift;     // per step, log space
+        double diffusion; // per step
+        std::vector<double> step_drift;     // empty when flat
+        std::vector<double> step_diffusion;
+
+        Gbm(const McConfig& cfg, double T, double rate, double vol)
+            : steps(std::max<std::size_t>(cfg.steps, 1)), maturity(std::max(T, 0.0)), volatility(vol) {
+            dt = maturity / static_cast<double>(steps);
+            drift = (rate - 0.5 * vol * vol) * dt;
+            diffusion = vol * std::sqrt(dt);
+        }
+        Gbm(const McConfig& cfg, double T, double rate, double strike, const VolatilityModel& vol)
+            : Gbm(cfg, T, rate, vol.volatility(strike, std::max(T, 0.0))) {
+            step_drift.resize(steps);
+            step_diffusion.resize(steps);
+            double w0 = 0.0;
+            for (std::size_t s = 0; s < steps; ++s) {
+                const double w1 = s + 1 == steps ? volatility * volatility * maturity
+                                                 : vol.total_variance(strike, (s + 1) * dt);
+                const double var = std::max(w1 - w0, 0.0);
+                step_drift[s] = rate * dt - 0.5 * var;
+                step_diffusion[s] = std::sqrt(var);
+                w0 = std::max(w0, w1);
+            }
+        }
+
+        double drift_at(std::size_t s) const { return step_drift.empty() ? drift : step_drift[s]; }
+        double diffusion_at(std::size_t s) const { return step_diffusion.empty() ? diffusion : step_diffusion[s]; }
+
+        void init(double*, std::size_t) const {}
+        void advance(std::size_t s, double* x, double*, const double* z, std::size_t lanes) const {
+            gbm_advance(x, z, lanes, drift_at(s), diffusion_at(s));
+        }
+    };
+
+    template <class Payoff, class Evolution>
+    McResult run(const Payoff& payoff, double spot, double rate, const Evolution& evo) const;
+
+    // In-pass Greeks differentiate the terminal payoff, which a
+    // path-dependent product does not have
+    template <class Payoff>
+    void check_greeks() const {
+        if (is_path_dependent<Payoff>::value && config_.greeks)
+            throw std::invalid_argument("MonteCarloPricer: in-pass Greeks need a terminal payoff");
+    }
+
+    // RNG draws per path: one per path, or one per antithetic pair
+    std::size_t draws_per_block() const {
+        const std::size_t block = std::max<std::size_t>(config_.block_size, 1);
+        return uses_antithetic(config_.variance_reduction) ? (block + 1) / 2 : block;
+    }
+    std::size_t total_draws() const {
+        return uses_antithetic(config_.variance_reduction) ? (config_.paths + 1) / 2 : config_.paths;
+    }
+
+    // Per-lane accumulator of a payoff policy; unused for terminal payoffs
+    template <class Payoff, class = void>
+    struct path_state {
+        struct type {};
+    };
+    template <class Payoff>
+    struct path_state<Payoff, std::void_t<typename Payoff::state_type>> {
+        using type = typename Payoff::state_type;
+    };
+    template <class Payoff>
+    using path_state_t = typename path_state<Payoff>::type;
+
+    // The RNG policy of the block starting at path `first`, told the
+    // configured precision if it takes one
+    Rng make_rng(std::uint64_t first) const { return make_rng(config_.seed, first); }
+    Rng make_rng(std::uint64_t seed, std::uint64_t first) const {
+        if constexpr (std::is_constructible<Rng, std::uint64_t, std::uint64_t, Precision>::value)
+            return Rng(seed, first, config_.precision);
+        else
+            return Rng(seed, first);
+    }
+
+    // Undiscounted control variate mean, 0 without a control variate
+    template <class Payoff, class Evolution>
+    double control_mean(const Payoff& payoff, double spot, double rate, const Evolution& evo, double discount) const;
+    McResult finish(const PathStats& total, double discount, double control_mean) const;
+
+    template <class Payoff, class Evolution>
+    PathStats simulate_block(const Payoff& payoff, double spot, const Evolution& evo, std::uint64_t first,
+                             std::size_t count) const;
+    // The paths of one block of `count` draws on the normals that
+    // normals(s) returns for step s: factors * lanes values, factor-major,
+    // antithetic lanes already mirrored
+    template <class Payoff, class Evolution, class Normals>
+    PathStats evolve_block(const Payoff& payoff, double spot, const Evolution& evo, std::size_t count,
+                           Normals&& normals) const;
+
+    // Pathwise or likelihood-ratio Greeks of terminal payoffs from the
+    // terminal spots x, summed unit increments w and payoffs v
+    template <class Payoff>
+    void accumulate_greeks(const Payoff& payoff, double spot, const Gbm& gbm, const ArenaVector<double>& x,
+                           const ArenaVector<double>& w, const ArenaVector<double>& v, std::size_t count,
+                           PathStats& stats) const;
+
+    // Regression paths of one block: the lanes in the money at each
+    // exercise date but the last, date by date, with their spots, and each
+    // lane's cash flow under the rule fitted so far, in money of the date
+    // being fitted
+    struct ExerciseBlock {
+        std::vector<std::uint32_t> begin; // date s is [begin[s], begin[s + 1])
+        std::vector<std::uint32_t> lane;
+        std::vector<double> spot;
+        std::vector<double> cash;
+    };
+    // basis coefficients per exercise date, an infinite intercept on the
+    // dates that never exercise; the last date's are unused
+    template <class Payoff>
+    std::vector<double> exercise_rule(const Payoff& payoff, double spot, double rate, const Gbm& evo,
+                                      const ExerciseConfig& exercise) const;
+    // Evolves one block of `count` draws from `seed` on evo's grid and
+    // calls visit(s, spots) with every lane's spot at each step s
+    template <class Visit>
+    void exercise_paths(double spot, const Gbm& evo, std::uint64_t seed, std::uint64_t first, std::size_t count,
+                        Visit&& visit) const;
+
+    // sensitivities() on the given step variances: fills everything in
+    // `out` but vega and returns d price / d variance[s]
+    template <class Payoff>
+    std::vector<double> step_adjoints(const Payoff& payoff, double spot, double rate, double dt,
+                                      const std::vector<double>& variance, McSensitivities& out) const;
+
+    // Block partial of sensitivities(): discounted values plus the summed
+    // adjoints of spot, rate and each step variance, in that order
+    struct AdjointPartial {
+        PathStats stats;
+        std::vector<double> adjoint;
+    };
+    template <class Payoff>
+    AdjointPartial adjoint_block(const Payoff& payoff, double spot, double rate, double dt,
+                                 const std::vector<double>& variance, std::uint64_t first, std::size_t count) const;
+
+    McConfig config_;
+    Executor executor_;
+};
+
+template <class Rng, class Executor, class PathBuilder>
+template <class Payoff, class Evolution>
+McResult MonteCarloPricer<Rng, Executor, PathBuilder>::run(const Payoff& payoff, double spot, double rate,
+                                                           const Evolution& evo) const {
+    check_greeks<Payoff>();
+    const std::size_t block = draws_per_block();
+    const std::size_t draws = total_draws();
+    const std::size_t blocks = (draws + block - 1) / block;
+    const bool adaptive = config_.target_std_error > 0.0;
+    const std::size_t round = adaptive ? std::max<std::size_t>(config_.adaptive_round, 1) : std::max<std::size_t>(blocks, 1);
+
+    const double discount = std::exp(-rate * evo.maturity);
+    const double mean_c = control_mean(payoff, spot, rate, evo, discount);
+
+    PathStats total;
+    McResult r = finish(total, discount, mean_c);
+    std::vector<PathStats> partial;
+    for (std::size_t done = 0; done < blocks;) {
+        const std::size_t n = std::min(round, blocks - done);
+        partial.assign(n, PathStats());
+        executor_.parallel_for(n, [&](std::size_t b) {
+            const std::size_t first = (done + b) * block;
+            partial[b] = simulate_block(payoff, spot, evo, first, std::min(block, draws - first));
+        });
+        {
+            StageTimer timer(Stage::Reduction);
+            for (const PathStats& p : partial) total.merge(p);
+        }
+        done += n;
+        r = finish(total, discount, mean_c);
+        if (adaptive && total.n > 1 && r.std_error <= config_.target_std_error) break;
+    }
+    r.converged = !adaptive || (total.n > 1 && r.std_error <= config_.target_std_error);
+    return r;
+}
+
+template <class Rng, class Executor, class PathBuilder>
+template <class Payoff, class Evolution>
+double MonteCarloPricer<Rng, Executor, PathBuilder>::control_mean(const Payoff& payoff, double spot, double rate,
+                                                                  const Evolution& evo, double discount) const {
+    if constexpr (std::is_same<Evolution, Gbm>::value) {
+        if (uses_control_variate(config_.variance_reduction)) {
+            using Control = typename Payoff::control_type;
+            const Option control(Control::type, payoff.control().strike, evo.maturity, spot);
+            return BlackScholes::price(control, rate, evo.volatility) / discount;
+        }
+    }
+    return 0.0;
+}
+
+template <class Rng, class Executor, class PathBuilder>
+McResult MonteCarloPricer<Rng, Executor, PathBuilder>::finish(const PathStats& total, double discount,
+                                                              double control_mean) const {
+    McResult r = uses_control_variate(config_.variance_reduction) ? total.result(discount, control_mean)
+                                                                   : total.result(discount);
+    if (config_.greeks) total.greeks(discount, r);
+    if (uses_antithetic(config_.variance_reduction)) r.paths *= 2;
+    return r;
+}
+
+template <class Rng, class Executor, class PathBuilder>
+template <class Payoff>
+std::vector<McResult> MonteCarloPricer<Rng, Executor, PathBuilder>::price(const Payoff& payoff, double spot,
+                                                                          double maturity, double rate,
+                                                                          double volatility,
+                                                                          const ScenarioSet& scenarios) const {
+    check_greeks<Payoff>();
+    const std::size_t m = scenarios.size();
+    if (scenarios.vol.size() != m || scenarios.rate.size() != m)
+        throw std::invalid_argument("MonteCarloPricer: scenario columns differ in length");
+    for (std::size_t k = 0; k < m; ++k)
+        if (!(scenarios.spot[k] > -1.0)) throw std::invalid_argument("MonteCarloPricer: spot shift must be above -1");
+    std::vector<double> spots(m), discount(m), mean_c(m);
+    std::vector<Gbm> evo;
+    evo.reserve(m);
+    for (std::size_t k = 0; k < m; ++k) {
+        const double r = rate + scenarios.rate[k];
+        spots[k] = spot * (1.0 + scenarios.spot[k]);
+        evo.emplace_back(config_, maturity, r, std::max(volatility + scenarios.vol[k], 0.0));
+        discount[k] = std::exp(-r * evo[k].maturity);
+        mean_c[k] = control_mean(payoff, spots[k], r, evo[k], discount[k]);
+    }
+
+    const std::size_t block = draws_per_block();
+    const std::size_t draws = total_draws();
+    const std::size_t blocks = (draws + block - 1) / block;
+    const std::size_t steps = std::max<std::size_t>(config_.steps, 1);
+    const bool antithetic = uses_antithetic(config_.variance_reduction);
+    std::vector<PathStats> partial(blocks * m);
+    executor_.parallel_for(blocks, [&](std::size_t b) {
+        const std::uint64_t first = b * block;
+        const std::size_t count = std::min<std::uint64_t>(block, draws - first);
+        const std::size_t lanes = antithetic ? 2 * count : count;
+        // Every step's normals for the block, drawn in simulate_block's order
+        ArenaScope scratch;
+        Rng rng = make_rng(first);
+        PathBuilder builder(steps);
+        builder.begin(rng, first, count);
+        ArenaVector<double> z(steps * lanes);
+        {
+            StageTimer timer(Stage::Rng);
+            for (std::size_t s = 0; s < steps; ++s) {
+                double* row = &z[s * lanes];
+                builder.increments(rng, first, count, s, row);
+                if (antithetic)
+                    for (std::size_t i = 0; i < count; ++i) row[count + i] = -row[i];
+            }
+        }
+        const auto normals = [&](std::size_t s) { return static_cast<const double*>(&z[s * lanes]); };
+        for (std::size_t k = 0; k < m; ++k)
+            partial[b * m + k] = evolve_block(payoff, spots[k], evo[k], count, normals);
+    });
+
+    StageTimer timer(Stage::Reduction);
+    std::vector<McResult> out(m);
+    for (std::size_t k = 0; k < m; ++k) {
+        PathStats total;
+        for (std::size_t b = 0; b < blocks; ++b) total.merge(partial[b * m + k]);
+        out[k] = finish(total, discount[k], mean_c[k]);
+    }
+    return out;
+}
+
+template <class Rng, class Executor, class PathBuilder>
+template <class Payoff>
+std::vector<PathStats> MonteCarloPricer<Rng, Executor, PathBuilder>::simulate_blocks(
+    const Payoff& payoff, double spot, double maturity, double rate, double volatility, std::size_t first,
+    std::size_t count) const {
+    if (first > blocks() || count > blocks() - first)
+        throw std::out_of_range("MonteCarloPricer::simulate_blocks: block range out of range");
+    check_greeks<Payoff>();
+    const Gbm evo(config_, maturity, rate, volatility);
+    const std::size_t block = draws_per_block();
+    const std::size_t draws = total_draws();
+    std::vector<PathStats> partial(count);
+    executor_.parallel_for(count, [&](std::size_t b) {
+        const std::size_t begin = (first + b) * block;
+        partial[b] = simulate_block(payoff, spot, evo, begin, std::min(block, draws - begin));
+    });
+    return partial;
+}
+
+template <class Rng, class Executor, class PathBuilder>
+template <class Payoff>
+McResult MonteCarloPricer<Rng, Executor, PathBuilder>::combine(const Payoff& payoff, double spot, double maturity,
+                                                               double rate, double volatility,
+                                                               const std::vector<PathStats>& partials) const {
+    if (partials.size() != blocks())
+        throw std::invalid_argument("MonteCarloPricer::combine: expected one partial per block");
+    check_greeks<Payoff>();
+    const Gbm evo(config_, maturity, rate, volatility);
+    const double discount = std::exp(-rate * evo.maturity);
+    PathStats total;
+    for (const PathStats& p : partials) total.merge(p);
+    return finish(total, discount, control_mean(payoff, spot, rate, evo, discount));
+}
+
+template <class Rng, class Executor, class PathBuilder>
+std::vector<double> MonteCarloPricer<Rng, Executor, PathBuilder>::path(const Option& opt, double rate,
+                                                                       double volatility, std::uint64_t index) const {
+    if (index >= config_.paths) throw std::out_of_range("MonteCarloPricer::path: path index out of range");
+    const Gbm gbm(config_, opt.maturity, rate, volatility);
+    const bool antithetic = uses_antithetic(config_.variance_reduction);
+    const std::uint64_t draw = antithetic ? index / 2 : index;
+    const double sign = antithetic && (index & 1) ? -1.0 : 1.0;
+
+    std::uint64_t first = draw;
+    std::size_t count = 1;
+    if (!Rng::random_access) {
+        const std::size_t block = draws_per_block();
+        first = draw / block * block;
+        count = std::min<std::uint64_t>(block, total_draws() - first);
+    }
+    const std::size_t lane = static_cast<std::size_t>(draw - first);
+
+    // Same kernels as simulate_block so the replay matches bit for bit
+    ArenaScope scratch;
+    Rng rng = make_rng(first);
+    PathBuilder builder(gbm.steps);
+    builder.begin(rng, first, count);
+    ArenaVector<double> z(count);
+    std::vector<double> spots(1, opt.spot);
+    double x = std::log(opt.spot);
+    for (std::size_t s = 0; s < gbm.steps; ++s) {
+        builder.increments(rng, first, count, s, z.data());
+        const double zi = sign * z[lane];
+        gbm_advance(&x, &zi, 1, gbm.drift, gbm.diffusion);
+        double spot;
+        exp_array(&x, &spot, 1);
+        spots.push_back(spot);
+    }
+    return spots;
+}
+
+template <class Rng, class Executor, class PathBuilder>
+template <class Payoff, class Evolution>
+PathStats MonteCarloPricer<Rng, Executor, PathBuilder>::simulate_block(const Payoff& payoff, double spot,
+                                                                       const Evolution& evo, std::uint64_t first,
+                                                                       std::size_t count) const {
+    const bool antithetic = uses_antithetic(config_.variance_reduction);
+    const std::size_t lanes = antithetic ? 2 * count : count;
+    constexpr std::size_t factors = Evolution::factors;
+
+    // Scratch comes from this thread's arena and is released on return;
+    // antithetic lanes [count, 2 count) mirror lanes [0, count). Factor f
+    // of step s is RNG dimension s * factors + f.
+    ArenaScope scratch;
+    Rng rng = make_rng(first);
+    PathBuilder builder(evo.steps, factors);
+    builder.begin(rng, first, count);
+    ArenaVector<double> z(factors * lanes);
+    return evolve_block(payoff, spot, evo, count, [&](std::size_t s) {
+        StageTimer timer(Stage::Rng);
+        for (std::size_t f = 0; f < factors; ++f) {
+            double* zf = &z[f * lanes];
+            builder.increments(rng, first, count, s * factors + f, zf);
+            if (antithetic)
+                for (std::size_t i = 0; i < count; ++i) zf[count + i] = -zf[i];
+        }
+        return static_cast<const double*>(z.data());
+    });
+}
+
+template <class Rng, class Executor, class PathBuilder>
+template <class Payoff, class Evolution, class Normals>
+PathStats MonteCarloPricer<Rng, Executor, PathBuilder>::evolve_block(const Payoff& payoff, double spot,
+                                                                     const Evolution& evo, std::size_t count,
+                                                                     Normals&& normals) const {
+    const bool antithetic = uses_antithetic(config_.variance_reduction);
+    const bool control = uses_control_variate(config_.variance_reduction);
+    const std::size_t lanes = antithetic ? 2 * count : count;
+
+    ArenaScope scratch;
+    constexpr bool path_dependent = is_path_dependent<Payoff>::value;
+    constexpr bool gbm = std::is_same<Evolution, Gbm>::value;
+    bool greeks = false;
+    if constexpr (gbm) greeks = !path_dependent && config_.greeks && evo.maturity > 0.0 && evo.volatility > 0.0;
+    ArenaVector<double> x(lanes, std::log(spot));
+    ArenaVector<double> aux(Evolution::state * lanes);
+    evo.init(aux.data(), lanes);
+    ArenaVector<double> w(greeks ? lanes : 0, 0.0); // sum of unit increments
+    // Path-dependent products: the spots of the current date and one
+    // accumulator per lane, so the working set stays O(lanes)
+    ArenaVector<double> spots(path_dependent ? lanes : 0);
+    ArenaVector<path_state_t<Payoff>> state;
+    if constexpr (path_dependent) state.assign(lanes, payoff.init(spot));
+    // Normals are timed by whoever draws them, inside the RNG stage
+    for (std::size_t s = 0; s < evo.steps; ++s) {
+        const double* z = normals(s);
+        StageTimer timer(Stage::PathEvolution);
+        evo.advance(s, x.data(), aux.data(), z, lanes);
+        if constexpr (gbm) {
+            if (greeks) {
+                // Increments in units of the effective vol, so the terminal
+                // formulas below hold for a term structure too
+                const double scale = evo.diffusion_at(s) / evo.diffusion;
+                for (std::size_t i = 0; i < lanes; ++i) w[i] += scale * z[i];
+            }
+        }
+        if constexpr (path_dependent) {
+            exp_array(x.data(), spots.data(), lanes);
+            for (std::size_t i = 0; i < lanes; ++i) payoff.observe(state[i], spots[i], x[i]);
+        }
+    }
+    if constexpr (path_dependent) {
+        x.swap(spots);
+    } else {
+        StageTimer timer(Stage::PathEvolution);
+        exp_array(x.data(), x.data(), lanes);
+    }
+
+    // Payoffs first, in a loop the compiler sees whole, then the moments
+    ArenaVector<double> v(lanes);
+    ArenaVector<double> c;
+    {
+        StageTimer timer(Stage::Payoff);
+        if constexpr (path_dependent) {
+            for (std::size_t i = 0; i < lanes; ++i) v[i] = payoff.value(state[i], x[i], evo.steps);
+        } else {
+            for (std::size_t i = 0; i < lanes; ++i) v[i] = payoff(x[i]);
+        }
+        if (control) {
+            const typename Payoff::control_type vanilla = payoff.control();
+            c.resize(lanes);
+            for (std::size_t i = 0; i < lanes; ++i) c[i] = vanilla(x[i]);
+        }
+    }
+    StageTimer timer(Stage::Reduction);
+    add_count(Counter::PathsSimulated, lanes);
+    PathStats stats;
+    for (std::size_t i = 0; i < count; ++i) {
+        const double vi = antithetic ? 0.5 * (v[i] + v[count + i]) : v[i];
+        if (control)
+            stats.add(vi, antithetic ? 0.5 * (c[i] + c[count + i]) : c[i]);
+        else
+            stats.add(vi);
+    }
+    if constexpr (!path_dependent && gbm) {
+        if (greeks) accumulate_greeks(payoff, spot, evo, x, w, v, count, stats);
+    }
+    return stats;
+}
+
+template <class Rng, class Executor, class PathBuilder>
+template <class Payoff>
+void MonteCarloPricer<Rng, Executor, PathBuilder>::accumulate_greeks(const Payoff& payoff, double spot, const Gbm& gbm,
+                                                                     const ArenaVector<double>& x,
+                                                                     const ArenaVector<double>& w,
+                                                                     const ArenaVector<double>& v, std::size_t count,
+                                                                     PathStats& stats) const {
+    const bool antithetic = uses_antithetic(config_.variance_reduction);
+    // Terminal-distribution estimators: W_T = sqrt(dt) * w, Z = W_T / sqrt(T)
+    const bool pathwise = config_.greek_method == GreekMethod::Pathwise ||
+                          (config_.greek_method == GreekMethod::Auto && Payoff::lipschitz);
+    const double S0 = spot, sigma = gbm.volatility, T = gbm.maturity;
+    const double sqrt_T = std::sqrt(T), sqrt_dt = std::sqrt(gbm.dt);
+    double g[3];
+    const auto estimate = [&](std::size_t i, double* out) {
+        const double S = x[i];
+        const double W = sqrt_dt * w[i];
+        if (pathwise) {
+            const double dS = payoff.derivative(S) * S; // f'(S_T) S_T
+            out[0] = dS / S0;
+            out[1] = dS / (S0 * S0) * (W / (sigma * T) - 1.0);
+            out[2] = dS * (W - sigma * T);
+        } else {
+            const double f = v[i];
+            const double Z = W / sqrt_T;
+            out[0] = f * Z / (S0 * sigma * sqrt_T);
+            out[1] = f * ((Z * Z - 1.0) / (S0 * S0 * sigma * sigma * T) - Z / (S0 * S0 * sigma * sqrt_T));
+            out[2] = f * ((Z * Z - 1.0) / sigma - Z * sqrt_T);
+        }
+    };
+    for (std::size_t i = 0; i < count; ++i) {
+        estimate(i, g);
+        if (antithetic) {
+            double m[3];
+            estimate(count + i, m);
+            for (int k = 0; k < 3; ++k) g[k] = 0.5 * (g[k] + m[k]);
+        }
+        stats.add_greeks(g[0], g[1], g[2]);
+    }
+}
+
+template <class Rng, class Executor, class PathBuilder>
+template <class Payoff>
+McSensitivities MonteCarloPricer<Rng, Executor, PathBuilder>::sensitivities(const Payoff& payoff, double spot,
+                                                                            double maturity, double rate,
+                                                                            const VolTermStructure& vol) const {
+    const std::size_t steps = std::max<std::size_t>(config_.steps, 1);
+    const double dt = std::max(maturity, 0.0) / static_cast<double>(steps);
+    // The tape sees integrated step variances; the buckets enter once, below
+    std::vector<double> variance(steps);
+    for (std::size_t s = 0; s < steps; ++s) variance[s] = vol.variance(s * dt, (s + 1) * dt);
+
+    McSensitivities out;
+    const std::vector<double> adjoint = step_adjoints(payoff, spot, rate, dt, variance, out);
+    out.vega.assign(vol.buckets(), 0.0);
+    // d variance[s] / d vols[j] = 2 vols[j] overlap(j, step s)
+    for (std::size_t s = 0; s < steps; ++s) {
+        if (adjoint[s] == 0.0) continue;
+        for (std::size_t j = 0; j < vol.buckets(); ++j)
+            out.vega[j] += adjoint[s] * 2.0 * vol.vols[j] * vol.overlap(j, s * dt, (s + 1) * dt);
+    }
+    return out;
+}
+
+template <class Rng, class Executor, class PathBuilder>
+template <class Payoff>
+McSensitivities MonteCarloPricer<Rng, Executor, PathBuilder>::sensitivities(const Payoff& payoff, double spot,
+                                                                            double maturity, double rate,
+                                                                            const GridVolSurface& vol) const {
+    const std::size_t steps = std::max<std::size_t>(config_.steps, 1);
+    const double T = std::max(maturity, 0.0);
+    const double dt = T / static_cast<double>(steps);
+    const double strike = payoff.control().strike;
+    // Step s diffuses w(K, t_s+1) - w(K, t_s), floored at 0 as in Gbm; its
+    // derivative by node variance is the difference of the two stencils'
+    // weights, the earlier one taken where the running maximum was set
+    std::vector<double> variance(steps);
+    std::vector<std::size_t> nodes(4 * steps);
+    std::vector<double> weights(4 * steps, 0.0);
+    std::vector<std::size_t> used(steps, 0);
+    double w0 = 0.0;
+    for (std::size_t s = 0; s < steps; ++s) {
+        const double t = s + 1 == steps ? T : (s + 1) * dt;
+        const double w1 = vol.total_variance(strike, t);
+        variance[s] = std::max(w1 - w0, 0.0);
+        if (!(w1 > w0)) continue;
+        used[s] = vol.stencil(strike, t, &nodes[4 * s], &weights[4 * s]);
+        w0 = w1;
+    }
+
+    McSensitivities out;
+    const std::vector<double> adjoint = step_adjoints(payoff, spot, rate, dt, variance, out);
+    const std::size_t ns = vol.strikes().size();
+    std::vector<double> node_adjoint(ns * vol.maturities().size(), 0.0);
+    std::size_t prev = steps; // step that set the running maximum, none yet
+    for (std::size_t s = 0; s < steps; ++s) {
+        if (used[s] == 0) continue;
+        for (std::size_t j = 0; j < used[s]; ++j) node_adjoint[nodes[4 * s + j]] += adjoint[s] * weights[4 * s + j];
+        if (prev < steps)
+            for (std::size_t j = 0; j < used[prev]; ++j)
+                node_adjoint[nodes[4 * prev + j]] -= adjoint[s] * weights[4 * prev + j];
+        prev = s;
+    }
+    // d w / d vol = 2 vol T at each node
+    out.vega.assign(node_adjoint.size(), 0.0);
+    for (std::size_t n = 0; n < node_adjoint.size(); ++n) {
+        if (node_adjoint[n] == 0.0) continue;
+        const double t = vol.maturities()[n / ns];
+        out.vega[n] = node_adjoint[n] * 2.0 * vol.volatility(vol.strikes()[n % ns], t) * t;
+    }
+    return out;
+}
+
+template <class Rng, class Executor, class PathBuilder>
+template <class Payoff>
+std::vector<double> MonteCarloPricer<Rng, Executor, PathBuilder>::step_adjoints(const Payoff& payoff, double spot,
+                                                                                double rate, double dt,
+                                                                                const std::vector<double>& variance,
+                                                                                McSensitivities& out) const {
+    static_assert(!is_path_dependent<Payoff>::value, "MonteCarloPricer::sensitivities: terminal payoffs only");
+    static_assert(Payoff::lipschitz, "MonteCarloPricer::sensitivities: pathwise adjoints need a Lipschitz payoff");
+    const std::size_t steps = variance.size();
+    const std::size_t block = draws_per_block();
+    const std::size_t draws = total_draws();
+    const std::size_t blocks = (draws + block - 1) / block;
+    std::vector<AdjointPartial> partial(blocks);
+    executor_.parallel_for(blocks, [&](std::size_t b) {
+        const std::size_t first = b * block;
+        partial[b] = adjoint_block(payoff, spot, rate, dt, variance, first, std::min(block, draws - first));
+    });
+    PathStats total;
+    std::vector<double> adjoint(2 + steps, 0.0);
+    for (const AdjointPartial& p : partial) {
+        total.merge(p.stats);
+        for (std::size_t k = 0; k < adjoint.size(); ++k) adjoint[k] += p.adjoint[k];
+    }
+
+    const McResult r = total.result(1.0); // values are discounted on the tape
+    out.price = r.price;
+    out.std_error = r.std_error;
+    out.paths = uses_antithetic(config_.variance_reduction) ? 2 * r.paths : r.paths;
+    std::vector<double> step(steps, 0.0);
+    if (total.n == 0) return step;
+    const double inv_n = 1.0 / static_cast<double>(total.n);
+    out.delta = adjoint[0] * inv_n;
+    out.rho = adjoint[1] * inv_n;
+    for (std::size_t s = 0; s < steps; ++s) step[s] = adjoint[2 + s] * inv_n;
+    return step;
+}
+
+template <class Rng, class Executor, class PathBuilder>
+template <class Payoff>
+typename MonteCarloPricer<Rng, Executor, PathBuilder>::AdjointPartial
+MonteCarloPricer<Rng, Executor, PathBuilder>::adjoint_block(const Payoff& payoff, double spot0, double rate, double dt,
+                                                            const std::vector<double>& variance, std::uint64_t first,
+                                                            std::size_t count) const {
+    const bool antithetic = uses_antithetic(config_.variance_reduction);
+    const std::size_t steps = variance.size();
+    const std::size_t lanes = antithetic ? 2 * count : count;
+
+    // All increments up front: row s holds step s for every lane
+    ArenaScope scratch;
+    Rng rng = make_rng(first);
+    PathBuilder builder(steps);
+    builder.begin(rng, first, count);
+    ArenaVector<double> z(steps * lanes);
+    for (std::size_t s = 0; s < steps; ++s) {
+        double* row = &z[s * lanes];
+        builder.increments(rng, first, count, s, row);
+        if (antithetic)
+            for (std::size_t i = 0; i < count; ++i) row[count + i] = -row[i];
+    }
+
+    // Inputs and everything shared by the block's paths sit below the mark;
+    // the thread's tape keeps its capacity from block to block
+    thread_local Tape tape;
+    tape.rewind(0);
+    tape.reserve(4 * steps + 3 * steps * (antithetic ? 2 : 1) + 16);
+    const AReal spot(tape, spot0);
+    const AReal r(tape, rate);
+    ArenaVector<AReal> v;
+    v.reserve(steps);
+    for (std::size_t s = 0; s < steps; ++s) v.emplace_back(tape, variance[s]);
+    ArenaVector<AReal> drift, diffusion;
+    drift.reserve(steps);
+    diffusion.reserve(steps);
+    for (std::size_t s = 0; s < steps; ++s) {
+        drift.push_back(r * dt - 0.5 * v[s]);
+        diffusion.push_back(sqrt(v[s]));
+    }
+    const AReal x0 = log(spot);
+    const AReal discount = exp(r * -(dt * static_cast<double>(steps)));
+    const std::size_t mark = tape.mark();
+
+    const auto value = [&](std::size_t i) {
+        AReal x = x0;
+        for (std::size_t s = 0; s < steps; ++s) x = x + drift[s] + diffusion[s] * z[s * lanes + i];
+        return discount * payoff(exp(x));
+    };
+    AdjointPartial out;
+    for (std::size_t i = 0; i < count; ++i) {
+        AReal y = value(i);
+        if (antithetic) y = 0.5 * (y + value(count + i));
+        out.stats.add(y.value());
+        tape.adjoint(y.index()) = 1.0;
+        tape.propagate(y.index(), mark);
+        tape.rewind(mark);
+    }
+    tape.propagate(mark - 1, 0);
+
+    out.adjoint.resize(2 + steps);
+    out.adjoint[0] = spot.adjoint();
+    out.adjoint[1] = r.adjoint();
+    for (std::size_t s = 0; s < steps; ++s) out.adjoint[2 + s] = v[s].adjoint();
+    return out;
+}
+
+template <class Rng, class Executor, class PathBuilder>
+template <class Payoff>
+McResult MonteCarloPricer<Rng, Executor, PathBuilder>::price_american(const Payoff& payoff, double spot,
+                                                                      double maturity, double rate,
+                                                                      double volatility,
+                                                                      const ExerciseConfig& exercise) const {
+    static_assert(!is_path_dependent<Payoff>::value, "MonteCarloPricer: early exercise needs a terminal payoff");
+    if (exercise.dates == 0 || exercise.basis == 0 || exercise.basis > ExerciseConfig::kMaxBasis)
+        throw std::invalid_argument("MonteCarloPricer::price_american: need dates > 0 and basis in [1, kMaxBasis]");
+    McConfig grid = config_;
+    grid.steps = exercise.dates;
+    const Gbm evo(grid, maturity, rate, volatility);
+    const std::vector<double> rule = exercise_rule(payoff, spot, rate, evo, exercise);
+
+    const std::size_t dates = evo.steps, basis = exercise.basis;
+    const bool antithetic = uses_antithetic(config_.variance_reduction);
+    const bool control = uses_control_variate(config_.variance_reduction);
+    const double discount = std::exp(-rate * evo.maturity);
+    const double mean_c = control_mean(payoff, spot, rate, evo, discount);
+    const double inv_strike = 1.0 / payoff.control().strike;
+    // Exercise values carried to maturity, so finish() discounts each from
+    // its own date
+    std::vector<double> growth(dates);
+    for (std::size_t s = 0; s < dates; ++s)
+        growth[s] = std::exp(rate * (evo.maturity - static_cast<double>(s + 1) * evo.dt));
+
+    const std::size_t block = draws_per_block();
+    const std::size_t draws = total_draws();
+    const std::size_t blocks = (draws + block - 1) / block;
+    std::vector<PathStats> partial(blocks);
+    executor_.parallel_for(blocks, [&](std::size_t b) {
+        const std::uint64_t first = b * block;
+        const std::size_t count = std::min<std::uint64_t>(block, draws - first);
+        const std::size_t lanes = antithetic ? 2 * count : count;
+        ArenaScope scratch;
+        ArenaVector<double> v(lanes, 0.0);
+        ArenaVector<double> c(control ? lanes : 0);
+        ArenaVector<std::uint8_t> alive(lanes, 1);
+        exercise_paths(spot, evo, config_.seed, first, count, [&](std::size_t s, const double* S) {
+            StageTimer timer(Stage::Payoff);
+            if (s + 1 == dates) {
+                for (std::size_t i = 0; i < lanes; ++i)
+                    if (alive[i]) v[i] = payoff(S[i]);
+                if (control) {
+                    const typename Payoff::control_type vanilla = payoff.control();
+                    for (std::size_t i = 0; i < lanes; ++i) c[i] = vanilla(S[i]);
+                }
+                return;
+            }
+            const double* beta = &rule[s * basis];
+            for (std::size_t i = 0; i < lanes; ++i) {
+                if (!alive[i]) continue;
+                const double h = payoff(S[i]);
+                if (h > 0.0 && h > continuation_value(beta, basis, S[i] * inv_strike)) {
+                    v[i] = h * growth[s];
+                    alive[i] = 0;
+                }
+            }
+        });
+        StageTimer timer(Stage::Reduction);
+        add_count(Counter::PathsSimulated, lanes);
+        PathStats stats;
+        for (std::size_t i = 0; i < count; ++i) {
+            const double vi = antithetic ? 0.5 * (v[i] + v[count + i]) : v[i];
+            if (control)
+                stats.add(vi, antithetic ? 0.5 * (c[i] + c[count + i]) : c[i]);
+            else
+                stats.add(vi);
+        }
+        partial[b] = stats;
+    });
+
+    StageTimer timer(Stage::Reduction);
+    PathStats total;
+    for (const PathStats& p : partial) total.merge(p);
+    return finish(total, discount, mean_c);
+}
+
+template <class Rng, class Executor, class PathBuilder>
+template <class Payoff>
+std::vector<double> MonteCarloPricer<Rng, Executor, PathBuilder>::exercise_rule(const Payoff& payoff, double spot,
+                                                                                double rate, const Gbm& evo,
+                                                                                const ExerciseConfig& exercise) const {
+    const std::size_t dates = evo.steps, basis = exercise.basis;
+    const bool antithetic = uses_antithetic(config_.variance_reduction);
+    const std::size_t block = draws_per_block();
+    const std::size_t draws = antithetic ? (exercise.regression_paths + 1) / 2 : exercise.regression_paths;
+    const std::size_t blocks = (draws + block - 1) / block;
+    const double inv_strike = 1.0 / payoff.control().strike;
+    // A stream of their own, so the pricing pass is out of sample
+    const std::uint64_t seed = config_.seed ^ 0x9E3779B97F4A7C15ULL;
+
+    // Forward: keep only what the regressions read
+    std::vector<ExerciseBlock> paths(blocks);
+    executor_.parallel_for(blocks, [&](std::size_t b) {
+        const std::uint64_t first = b * block;
+        const std::size_t count = std::min<std::uint64_t>(block, draws - first);
+        ExerciseBlock& p = paths[b];
+        p.begin.assign(1, 0);
+        p.cash.resize(antithetic ? 2 * count : count);
+        exercise_paths(spot, evo, seed, first, count, [&](std::size_t s, const double* S) {
+            if (s + 1 == dates) {
+                for (std::size_t i = 0; i < p.cash.size(); ++i) p.cash[i] = payoff(S[i]);
+                return;
+            }
+            for (std::size_t i = 0; i < p.cash.size(); ++i) {
+                if (payoff(S[i]) > 0.0) {
+                    p.lane.push_back(static_cast<std::uint32_t>(i));
+                    p.spot.push_back(S[i]);
+                }
+            }
+            p.begin.push_back(static_cast<std::uint32_t>(p.lane.size()));
+        });
+    });
+
+    // Backward: one pass over the blocks per date applies the later date's
+    // decisions, discounts a period and sums this date's moments
+    std::vector<double> rule(dates * basis, 0.0);
+    std::vector<ExerciseMoments> moments(blocks);
+    const double df = std::exp(-rate * evo.dt);
+    for (std::size_t s = dates - 1; s-- > 0;) {
+        const double* next = s + 2 < dates ? &rule[(s + 1) * basis] : nullptr;
+        executor_.parallel_for(blocks, [&](std::size_t b) {
+            ExerciseBlock& p = paths[b];
+            if (next) {
+                for (std::uint32_t k = p.begin[s + 1]; k < p.begin[s + 2]; ++k) {
+                    const double h = payoff(p.spot[k]);
+                    if (h > continuation_value(next, basis, p.spot[k] * inv_strike)) p.cash[p.lane[k]] = h;
+                }
+            }
+            for (double& cash : p.cash) cash *= df;
+            ExerciseMoments m;
+            for (std::uint32_t k = p.begin[s]; k < p.begin[s + 1]; ++k)
+                m.add(p.spot[k] * inv_strike, p.cash[p.lane[k]], basis);
+            moments[b] = m;
+        });
+        ExerciseMoments total;
+        for (const ExerciseMoments& m : moments) total.merge(m);
+        double* beta = &rule[s * basis];
+        if (!total.solve(basis, beta)) {
+            std::fill(beta, beta + basis, 0.0);
+            beta[0] = HUGE_VAL;
+        }
+    }
+    return rule;
+}
+
+template <class Rng, class Executor, class PathBuilder>
+template <class Visit>
+void MonteCarloPricer<Rng, Executor, PathBuilder>::exercise_paths(double spot, const Gbm& evo, std::uint64_t seed,
+                                                                  std::uint64_t first, std::size_t count,
+                                                                  Visit&& visit) const {
+    const bool antithetic = uses_antithetic(config_.variance_reduction);
+    const std::size_t lanes = antithetic ? 2 * count : count;
+    ArenaScope scratch;
+    Rng rng = make_rng(seed, first);
+    PathBuilder builder(evo.steps);
+    builder.begin(rng, first, count);
+    ArenaVector<double> z(lanes);
+    ArenaVector<double> x(lanes, std::log(spot));
+    ArenaVector<double> spots(lanes);
+    for (std::size_t s = 0; s < evo.steps; ++s) {
+        {
+            StageTimer timer(Stage::Rng);
+            builder.increments(rng, first, count, s, z.data());
+            if (antithetic)
+                for (std::size_t i = 0; i < count; ++i) z[count + i] = -z[i];
+        }
+        {
+            StageTimer timer(Stage::PathEvolution);
+            evo.advance(s, x.data(), nullptr, z.data(), lanes);
+            exp_array(x.data(), spots.data(), lanes);
+        }
+        visit(s, static_cast<const double*>(spots.data()));
+    }
+}
+
+}
@@ -1,10 +1,19 @@
 #pragma once
+#include <cstddef>
 #include <string>
+#include "utils.h"
 
 namespace aemps {
 
 enum class OptionType { Call, Put };
 
+// Accuracy tier of the vectorized kernels. Single evaluates in float, twice
+// the lanes per vector, and hands back doubles; anything summed over many
+// values is still summed in double. Batch Black-Scholes prices stay within
+// 1e-6 relative of Double, contracts float cannot price that closely being
+// priced in double.
+enum class Precision { Double, Single };
+
 struct Option {
     OptionType type;
     double strike;
@@ -15,4 +24,34 @@ struct Option {
         : type(t), strike(k), maturity(T), spot(S) {}
 };
 
+// Non-owning structure-of-arrays view over a book of European options.
+// Every column points at `size` contiguous elements. Volatility and rate
+// are per contract so a whole surface update prices in a single call.
+struct OptionBatch {
+    std::size_t size = 0;
+    const OptionType* type = nullptr;
+    const double* strike = nullptr;
+    const double* maturity = nullptr; // in years
+    const double* spot = nullptr;
+    const double* volatility = nullptr;
+    const double* rate = nullptr;
+};
+
+// Owning structure-of-arrays option book with cache-line aligned columns.
+// Columns are public so market updates can overwrite them in place.
+struct OptionBook {
+    AlignedVector<OptionType> type;
+    AlignedVector<double> strike;
+    AlignedVector<double> maturity;
+    AlignedVector<double> spot;
+    AlignedVector<double> volatility;
+    AlignedVector<double> rate;
+
+    std::size_t size() const { return strike.size(); }
+    void reserve(std::size_t n);
+    void clear();
+    void push_back(const Option& opt, double vol, double r);
+    OptionBatch view() const;
+};
+
 }
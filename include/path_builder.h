@@ -0,0 +1,89 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "arena.h"
+
+namespace aemps {
+
+// Path builder policies for MonteCarloPricer. They turn the RNG's normals,
+// indexed by dimension, into per-step Brownian increments in units of
+// sqrt(dt) for each of `factors` independent drivers. The engine makes one
+// builder per path block and calls
+//
+//     PathBuilder builder(steps, factors);
+//     builder.begin(rng, first, count);
+//     builder.increments(rng, first, count, s * factors + f, dz); // step s, factor f
+
+// Dimension s * factors + f drives factor f of step s directly
+class IncrementalPath {
+public:
+    explicit IncrementalPath(std::size_t, std::size_t = 1) {}
+
+    template <class Rng>
+    void begin(Rng&, std::uint64_t, std::size_t) {}
+
+    template <class Rng>
+    void increments(Rng& rng, std::uint64_t first, std::size_t count, std::size_t step, double* dz) {
+        rng.normals(first, count, step, dz);
+    }
+};
+
+// Brownian bridge schedule on a uniform grid of `steps` points (Jaeckel's
+// construction order): dimension 0 fixes the terminal value, each further
+// dimension the midpoint of the widest remaining gap
+class BrownianBridge {
+public:
+    explicit BrownianBridge(std::size_t steps);
+
+    std::size_t steps() const { return bridge_.size(); }
+
+    // z holds steps rows of `lanes` normals, row d being dimension d; writes
+    // the unit-variance increments of step s to row s of dz
+    void build(const double* z, std::size_t lanes, double* dz) const;
+
+private:
+    std::vector<std::size_t> bridge_, left_, right_;
+    std::vector<double> left_weight_, right_weight_, std_dev_;
+};
+
+// Brownian-bridge path construction: the low, best-distributed dimensions of
+// a quasi-random sequence go to the coarse structure of the path. Each factor
+// gets its own bridge over the steps, and bridge point k of factor f is
+// dimension k * factors + f, so every factor's terminal value comes from the
+// first dimensions. Holds factors x steps x count normals per block, so size
+// blocks accordingly; they come from thread_arena() and live until the
+// enclosing ArenaScope closes.
+class BrownianBridgePath {
+public:
+    explicit BrownianBridgePath(std::size_t steps, std::size_t factors = 1) : bridge_(steps), factors_(factors) {}
+
+    template <class Rng>
+    void begin(Rng& rng, std::uint64_t first, std::size_t count) {
+        const std::size_t steps = bridge_.steps();
+        // Factor-major: rows [f * steps, (f + 1) * steps) belong to factor f
+        z_.resize(factors_ * steps * count);
+        dz_.resize(factors_ * steps * count);
+        for (std::size_t k = 0; k < steps; ++k)
+            for (std::size_t f = 0; f < factors_; ++f)
+                rng.normals(first, count, k * factors_ + f, &z_[(f * steps + k) * count]);
+        for (std::size_t f = 0; f < factors_; ++f)
+            bridge_.build(&z_[f * steps * count], count, &dz_[f * steps * count]);
+        count_ = count;
+    }
+
+    template <class Rng>
+    void increments(Rng&, std::uint64_t, std::size_t count, std::size_t dimension, double* dz) const {
+        const std::size_t step = dimension / factors_, factor = dimension % factors_;
+        const double* row = &dz_[(factor * bridge_.steps() + step) * count_];
+        for (std::size_t i = 0; i < count; ++i) dz[i] = row[i];
+    }
+
+private:
+    BrownianBridge bridge_;
+    std::size_t factors_;
+    ArenaVector<double> z_, dz_;
+    std::size_t count_ = 0;
+};
+
+}
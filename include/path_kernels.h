@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "option.h"
+
+namespace aemps {
+
+// Vectorized building blocks of the Monte Carlo path loop, dispatched to the
+// widest ISA like the batch Black-Scholes kernels. Arrays are SoA: one entry
+// per path.
+
+// Standard normals of paths [first_path, first_path + count) at `step`:
+// inverse CDF of Philox4x32-10 with key (k0, k1) at counter (path, step).
+// Precision::Single maps 23 bits of the first Philox word through a float
+// inverse CDF instead of 52 bits through the double one: a different
+// stream, equally a function of (path, step), with the tails cut at 5.3.
+void philox_normals(std::uint32_t k0, std::uint32_t k1, std::uint64_t first_path, std::size_t count,
+                    std::uint64_t step, double* out, Precision precision = Precision::Double);
+
+// out[i] = inverse standard normal CDF of u[i], u in (0, 1); out may alias u
+void norm_inv_array(const double* u, double* out, std::size_t n);
+
+// One GBM step in log space: x[i] += drift + diffusion * z[i]
+void gbm_advance(double* x, const double* z, std::size_t n, double drift, double diffusion);
+
+// out[i] = exp(x[i]); out may alias x
+void exp_array(const double* x, double* out, std::size_t n);
+
+// One log-Euler local-vol step. sigma is piecewise linear in
+// y = x - shift on `nodes` points y0 + j / inv_dy and flat beyond them.
+struct LocalVolStep {
+    const double* vol;
+    std::size_t nodes;
+    double y0;
+    double inv_dy;
+    double shift;   // log forward at the start of the step
+    double rate_dt; // r dt
+    double dt;
+    double sqrt_dt;
+};
+
+// x[i] += (r - sigma^2 / 2) dt + sigma sqrt(dt) z[i], sigma = sigma(x[i] - shift)
+void local_vol_advance(double* x, const double* z, std::size_t n, const LocalVolStep& step);
+
+// Per-step constants of the Heston quadratic-exponential scheme (Andersen,
+// 2008) with central (1/2, 1/2) weights on the integrated variance
+struct HestonStep {
+    double theta;
+    double decay;   // exp(-kappa dt)
+    double var_v;   // xi^2 decay (1 - decay) / kappa, times v
+    double var_c;   // theta xi^2 (1 - decay)^2 / (2 kappa)
+    double rate_dt; // r dt
+    double k0;      // -rho kappa theta dt / xi
+    double k1, k2;  // log-spot loadings on v_t and v_{t+dt}
+    double k3, k4;  // residual variance loadings on v_t and v_{t+dt}
+};
+
+// One QE step with Andersen's martingale correction: v advances from a
+// normal zv (the exponential branch maps it to a uniform through N(zv)),
+// then x from the independent normal zx
+void heston_qe_advance(double* x, double* v, const double* zv, const double* zx, std::size_t n,
+                       const HestonStep& step);
+
+}
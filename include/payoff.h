@@ -0,0 +1,161 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include "option.h"
+
+namespace aemps {
+
+// Terminal payoff policies for MonteCarloPricer. The engine is templated on
+// the policy, so each product compiles its own straight-line payoff loop; a
+// runtime OptionType is resolved once per pricing call, never per path.
+// A policy provides
+//
+//     T operator()(const T& spot) const;   // payoff at expiry, T = double or AReal
+//     double derivative(double spot) const; // d payoff / d spot, a.e.
+//     static constexpr bool lipschitz;     // pathwise Greeks are unbiased
+//     control_type control() const;        // vanilla used as control variate
+
+template <OptionType Type>
+struct VanillaPayoff {
+    static constexpr OptionType type = Type;
+    static constexpr bool lipschitz = true;
+    static constexpr double phi = Type == OptionType::Call ? 1.0 : -1.0;
+    using control_type = VanillaPayoff;
+
+    double strike;
+
+    template <class T>
+    T operator()(const T& spot) const {
+        using std::max;
+        return max(phi * (spot - strike), 0.0);
+    }
+    double derivative(double spot) const { return phi * (spot - strike) > 0.0 ? phi : 0.0; }
+    control_type control() const { return *this; }
+};
+
+using CallPayoff = VanillaPayoff<OptionType::Call>;
+using PutPayoff = VanillaPayoff<OptionType::Put>;
+
+// Cash-or-nothing digital: pays cash when the option finishes in the money.
+// Its pathwise derivative vanishes almost everywhere, so GreekMethod::Auto
+// falls back to likelihood-ratio weights.
+template <OptionType Type>
+struct DigitalPayoff {
+    static constexpr OptionType type = Type;
+    static constexpr bool lipschitz = false;
+    static constexpr double phi = Type == OptionType::Call ? 1.0 : -1.0;
+    using control_type = VanillaPayoff<Type>;
+
+    double strike;
+    double cash = 1.0;
+
+    double operator()(double spot) const { return phi * (spot - strike) > 0.0 ? cash : 0.0; }
+    double derivative(double) const { return 0.0; }
+    control_type control() const { return {strike}; }
+};
+
+using DigitalCallPayoff = DigitalPayoff<OptionType::Call>;
+using DigitalPutPayoff = DigitalPayoff<OptionType::Put>;
+
+// Path-dependent policies are streamed: the engine keeps one state_type per
+// path and folds every monitoring date (the end of each time step) into it
+// as the step is generated, so no paths x steps matrix is ever stored.
+// A policy provides
+//
+//     using state_type = ...;                                  // per-path accumulator
+//     state_type init(double spot0) const;
+//     void observe(state_type& st, double spot, double log_spot) const;
+//     double value(const state_type& st, double spot, std::size_t dates) const;
+//     control_type control() const;
+//
+// Monitoring is discrete on the config's time grid.
+template <class P, class = void>
+struct is_path_dependent : std::false_type {};
+template <class P>
+struct is_path_dependent<P, std::void_t<typename P::state_type>> : std::true_type {};
+
+enum class Averaging { Arithmetic, Geometric };
+
+// Fixed-strike Asian on the average of the monitoring dates
+template <OptionType Type, Averaging Avg = Averaging::Arithmetic>
+struct AsianPayoff {
+    static constexpr OptionType type = Type;
+    static constexpr double phi = Type == OptionType::Call ? 1.0 : -1.0;
+    using control_type = VanillaPayoff<Type>;
+    struct state_type {
+        double sum; // of spots, or of log spots when geometric
+    };
+
+    double strike;
+
+    state_type init(double) const { return {0.0}; }
+    void observe(state_type& st, double spot, double log_spot) const {
+        st.sum += Avg == Averaging::Arithmetic ? spot : log_spot;
+    }
+    double value(const state_type& st, double, std::size_t dates) const {
+        const double mean = st.sum / static_cast<double>(dates);
+        const double average = Avg == Averaging::Arithmetic ? mean : std::exp(mean);
+        return std::max(phi * (average - strike), 0.0);
+    }
+    control_type control() const { return {strike}; }
+};
+
+enum class BarrierKind { UpAndOut, UpAndIn, DownAndOut, DownAndIn };
+
+// Knock-in / knock-out vanilla; the barrier is also checked at inception
+template <OptionType Type, BarrierKind Kind>
+struct BarrierPayoff {
+    static constexpr OptionType type = Type;
+    static constexpr bool up = Kind == BarrierKind::UpAndOut || Kind == BarrierKind::UpAndIn;
+    static constexpr bool knock_in = Kind == BarrierKind::UpAndIn || Kind == BarrierKind::DownAndIn;
+    using control_type = VanillaPayoff<Type>;
+    struct state_type {
+        bool hit;
+    };
+
+    double strike;
+    double barrier;
+    double rebate = 0.0; // paid at expiry when a knock-out is hit
+
+    bool crossed(double spot) const { return up ? spot >= barrier : spot <= barrier; }
+    state_type init(double spot0) const { return {crossed(spot0)}; }
+    void observe(state_type& st, double spot, double) const { st.hit |= crossed(spot); }
+    double value(const state_type& st, double spot, std::size_t) const {
+        const double vanilla = VanillaPayoff<Type>{strike}(spot);
+        if (knock_in) return st.hit ? vanilla : 0.0;
+        return st.hit ? rebate : vanilla;
+    }
+    control_type control() const { return {strike}; }
+};
+
+// Fixed-strike lookback: a call pays max(M - K, 0) on the running maximum M,
+// a put max(K - m, 0) on the running minimum m, inception included
+template <OptionType Type>
+struct LookbackPayoff {
+    static constexpr OptionType type = Type;
+    static constexpr double phi = Type == OptionType::Call ? 1.0 : -1.0;
+    using control_type = VanillaPayoff<Type>;
+    struct state_type {
+        double extreme; // max for calls, min for puts
+    };
+
+    double strike;
+
+    state_type init(double spot0) const { return {spot0}; }
+    void observe(state_type& st, double spot, double) const {
+        st.extreme = phi * spot > phi * st.extreme ? spot : st.extreme;
+    }
+    double value(const state_type& st, double, std::size_t) const { return std::max(phi * (st.extreme - strike), 0.0); }
+    control_type control() const { return {strike}; }
+};
+
+// Calls f(payoff) with the vanilla policy matching a runtime OptionType
+template <class F>
+decltype(auto) dispatch_payoff(const Option& opt, F&& f) {
+    if (opt.type == OptionType::Call) return f(CallPayoff{opt.strike});
+    return f(PutPayoff{opt.strike});
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <string>
+#include "vol_predictor.h"
+
+namespace aemps {
+
+// VolPredictor that calls a Python function in an embedded CPython
+// interpreter, e.g. predict() of python/vol_model/model.py. Part of the
+// optional pricer_python target (PRICER_ENABLE_PYTHON); the interpreter is
+// started on first use if the host has not, and is never finalized.
+//
+// The function is called once per batch with a read-only 2-D float64
+// memoryview (shape rows x cols) that aliases the caller's feature matrix,
+// so np.asarray(features) is zero-copy. It must not keep the view, a slice
+// of it or an array over it past its return; predict() counts the buffers
+// handed out and throws std::runtime_error if one is still held. The result is any C-contiguous float64 buffer of length rows
+// (a numpy array, array('d'), ...) or a sequence of floats. Python errors
+// surface as std::runtime_error carrying the exception text. Calls from
+// several threads serialise on the GIL.
+class PythonVolPredictor : public VolPredictor {
+public:
+    // Imports `module` (after prepending search_path to sys.path when it
+    // is not empty) and looks up `function`; throws std::runtime_error if
+    // either fails
+    explicit PythonVolPredictor(const std::string& module, const std::string& function = "predict",
+                                const std::string& search_path = "");
+    ~PythonVolPredictor() override;
+    PythonVolPredictor(const PythonVolPredictor&) = delete;
+    PythonVolPredictor& operator=(const PythonVolPredictor&) = delete;
+
+    void predict(const FeatureMatrix& features, double* out) const override;
+
+private:
+    void* callable_ = nullptr; // PyObject*; keeps Python.h out of this header
+};
+
+}
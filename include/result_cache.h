@@ -0,0 +1,206 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+#include "black_scholes.h"
+#include "instrumentation.h"
+#include "monte_carlo_pricer.h"
+#include "option.h"
+
+namespace aemps {
+
+// Grid steps that canonicalise pricing inputs before they are hashed, so
+// requests within half a step of each other share an entry; a step of 0
+// keys on the exact value. The defaults only merge inputs that differ by
+// rounding noise.
+struct CacheQuantum {
+    double strike = 1e-8;
+    double maturity = 1e-10; // years, about 3 ms
+    double spot = 1e-8;
+    double rate = 1e-10;
+    double volatility = 1e-10;
+};
+
+// Canonical pricing request: a product tag (engine, model and settings)
+// followed by the option type and the quantised contract and market inputs
+struct CacheKey {
+    static constexpr std::size_t kWords = 7;
+    std::uint64_t words[kWords];
+
+    std::uint64_t hash() const;
+    bool operator==(const CacheKey& other) const;
+};
+
+CacheKey make_cache_key(std::uint64_t product, const Option& opt, double rate, double volatility,
+                        const CacheQuantum& quantum = CacheQuantum());
+
+// Product tags: hashes of everything besides the contract and market that
+// a result depends on. `policies` identifies the RNG and path builder.
+constexpr std::uint64_t kBlackScholesTag = 0x4253475245454B53ULL;
+std::uint64_t product_tag(const McConfig& config, std::uint64_t policies);
+
+// Sharded, lock-free cache of pricing results, so that identical requests
+// from different clients within one market snapshot are priced once.
+//
+// Every slot is a seqlock over atomic words. Readers never block and never
+// write to a slot; a writer claims a slot with one CAS and drops its insert
+// if another writer holds it. A key hashes to one shard and to a bucket of
+// kWays slots in it. An insert takes the slot already holding the key, else
+// a stale one, else one picked by the hash. Entries are stamped with the
+// epoch they were computed under and only match while it is current, so
+// advance_epoch() invalidates the whole cache in O(1) and stale slots are
+// reused as inserts meet them. Hits and misses are counted per thread by
+// the instrumentation layer (Counter::ResultCacheHits and ResultCacheMisses),
+// so a lookup writes nothing another thread reads.
+template <class Value>
+class ResultCache {
+    static_assert(std::is_trivially_copyable<Value>::value, "ResultCache: values are copied as raw words");
+
+public:
+    static constexpr std::size_t kWays = 4;
+
+    // `capacity` slots over `shards` shards, each rounded up to a power of
+    // two and to whole buckets
+    explicit ResultCache(std::size_t capacity = 16384, std::size_t shards = 16);
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    std::size_t capacity() const { return shards_.size() * shard_slots_; }
+    std::uint64_t epoch() const { return epoch_.load(std::memory_order_acquire); }
+
+    // Moves to a new market snapshot and returns its epoch
+    std::uint64_t advance_epoch() { return epoch_.fetch_add(1, std::memory_order_acq_rel) + 1; }
+
+    bool find(const CacheKey& key, Value& out) const;
+
+    // Stores a value computed under `epoch`; dropped when the cache has
+    // moved on since or the slot is being written
+    void insert(const CacheKey& key, const Value& value, std::uint64_t epoch);
+
+    // The cached value, or compute() stored under the epoch current when
+    // the lookup began
+    template <class Compute>
+    Value get_or_compute(const CacheKey& key, Compute&& compute) {
+        const std::uint64_t e = epoch();
+        Value v;
+        if (find(key, v)) return v;
+        v = compute();
+        insert(key, v, e);
+        return v;
+    }
+
+private:
+    static constexpr std::size_t kValueWords = (sizeof(Value) + 7) / 8;
+
+    struct Slot {
+        std::atomic<std::uint64_t> seq{0}; // odd while being written
+        std::atomic<std::uint64_t> epoch{0};
+        std::atomic<std::uint64_t> key[CacheKey::kWords];
+        std::atomic<std::uint64_t> value[kValueWords];
+    };
+    struct Shard {
+        std::unique_ptr<Slot[]> slots;
+    };
+
+    // High bits pick the shard, low bits the bucket
+    const Shard& shard(std::uint64_t hash) const { return shards_[(hash >> 48) & (shards_.size() - 1)]; }
+    Slot* bucket(std::uint64_t hash) const { return &shard(hash).slots[(hash & (shard_slots_ / kWays - 1)) * kWays]; }
+
+    static bool holds(const Slot& slot, const CacheKey& key) {
+        for (std::size_t k = 0; k < CacheKey::kWords; ++k)
+            if (slot.key[k].load(std::memory_order_relaxed) != key.words[k]) return false;
+        return true;
+    }
+
+    std::vector<Shard> shards_;
+    std::size_t shard_slots_;
+    std::atomic<std::uint64_t> epoch_{1}; // slots start at 0, which never matches
+};
+
+namespace detail {
+inline std::size_t next_pow2(std::size_t n) {
+    std::size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+}
+
+template <class Value>
+ResultCache<Value>::ResultCache(std::size_t capacity, std::size_t shards)
+    : shards_(detail::next_pow2(std::max<std::size_t>(shards, 1))) {
+    shard_slots_ = detail::next_pow2(std::max(kWays, (capacity + shards_.size() - 1) / shards_.size()));
+    for (Shard& s : shards_) s.slots.reset(new Slot[shard_slots_]());
+}
+
+template <class Value>
+bool ResultCache<Value>::find(const CacheKey& key, Value& out) const {
+    const std::uint64_t h = key.hash();
+    const std::uint64_t e = epoch();
+    const Slot* slots = bucket(h);
+    for (std::size_t w = 0; w < kWays; ++w) {
+        const Slot& s = slots[w];
+        const std::uint64_t seq = s.seq.load(std::memory_order_acquire);
+        if ((seq & 1) || s.epoch.load(std::memory_order_relaxed) != e || !holds(s, key)) continue;
+        std::uint64_t words[kValueWords];
+        for (std::size_t i = 0; i < kValueWords; ++i) words[i] = s.value[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s.seq.load(std::memory_order_relaxed) != seq) continue; // overwritten while read
+        std::memcpy(&out, words, sizeof(Value));
+        add_count(Counter::ResultCacheHits);
+        return true;
+    }
+    add_count(Counter::ResultCacheMisses);
+    return false;
+}
+
+template <class Value>
+void ResultCache<Value>::insert(const CacheKey& key, const Value& value, std::uint64_t epoch) {
+    if (epoch != this->epoch()) return;
+    const std::uint64_t h = key.hash();
+    Slot* slots = bucket(h);
+    Slot* target = &slots[(h >> 32) & (kWays - 1)];
+    for (std::size_t w = 0; w < kWays; ++w) {
+        if (holds(slots[w], key)) {
+            target = &slots[w];
+            break;
+        }
+        if (slots[w].epoch.load(std::memory_order_relaxed) != epoch) target = &slots[w];
+    }
+    std::uint64_t seq = target->seq.load(std::memory_order_relaxed);
+    if ((seq & 1) || !target->seq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire))
+        return;
+    std::atomic_thread_fence(std::memory_order_release);
+    std::uint64_t words[kValueWords] = {};
+    std::memcpy(words, &value, sizeof(Value));
+    target->epoch.store(epoch, std::memory_order_relaxed);
+    for (std::size_t k = 0; k < CacheKey::kWords; ++k) target->key[k].store(key.words[k], std::memory_order_relaxed);
+    for (std::size_t i = 0; i < kValueWords; ++i) target->value[i].store(words[i], std::memory_order_relaxed);
+    target->seq.store(seq + 2, std::memory_order_release);
+}
+
+// BlackScholes::greeks through `cache`. Batch pricing is cheaper than a
+// lookup per contract, so only single requests go through the cache.
+Greeks cached_greeks(ResultCache<Greeks>& cache, const Option& opt, double rate, double volatility,
+                     const CacheQuantum& quantum = CacheQuantum());
+
+// pricer.price(opt, rate, volatility) through `cache`. The key covers the
+// RNG and path builder policies and the McConfig but not the executor,
+// which never changes a result, so pricers on different thread pools share
+// entries.
+template <class Rng, class Executor, class PathBuilder>
+McResult cached_price(ResultCache<McResult>& cache, const MonteCarloPricer<Rng, Executor, PathBuilder>& pricer,
+                      const Option& opt, double rate, double volatility, const CacheQuantum& quantum = CacheQuantum()) {
+    const std::uint64_t policies = static_cast<std::uint64_t>(typeid(Rng).hash_code()) * 31 +
+                                   static_cast<std::uint64_t>(typeid(PathBuilder).hash_code());
+    const CacheKey key = make_cache_key(product_tag(pricer.config(), policies), opt, rate, volatility, quantum);
+    return cache.get_or_compute(key, [&] { return pricer.price(opt, rate, volatility); });
+}
+
+}
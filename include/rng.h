@@ -0,0 +1,111 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include "path_kernels.h"
+
+namespace aemps {
+
+// RNG policies for MonteCarloPricer. The engine builds one policy object per
+// path block, `Rng(seed, first_path)`, and asks it for the standard normals
+// of a run of consecutive paths at one time step:
+//
+//     rng.normals(first_path, count, step, out);
+//
+// Policies are free to ignore the coordinates and simply continue a stream.
+// Policies whose output is a pure function of (seed, path, step) declare
+// `random_access = true`; the engine then replays single paths directly.
+
+// std::mt19937_64 stream per path block, seeded from (seed, first path of
+// the block). Reproducible for a fixed block size, whatever the thread count.
+class Mt19937Rng {
+public:
+    static constexpr bool random_access = false;
+
+    Mt19937Rng(std::uint64_t seed, std::uint64_t first_path) {
+        std::seed_seq seq{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32),
+                          static_cast<std::uint32_t>(first_path), static_cast<std::uint32_t>(first_path >> 32)};
+        engine_.seed(seq);
+    }
+
+    void normals(std::uint64_t, std::size_t count, std::size_t, double* out) {
+        for (std::size_t i = 0; i < count; ++i) out[i] = normal_(engine_);
+    }
+
+private:
+    std::mt19937_64 engine_;
+    std::normal_distribution<double> normal_;
+};
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3")
+// block cipher applied to a counter
+struct Philox4x32 {
+    std::uint32_t v[4];
+};
+
+inline Philox4x32 philox4x32_10(Philox4x32 ctr, std::uint32_t k0, std::uint32_t k1) {
+    for (int round = 0; round < 10; ++round) {
+        const std::uint64_t p0 = 0xD2511F53ULL * ctr.v[0];
+        const std::uint64_t p1 = 0xCD9E8D57ULL * ctr.v[2];
+        ctr = Philox4x32{{static_cast<std::uint32_t>(p1 >> 32) ^ ctr.v[1] ^ k0, static_cast<std::uint32_t>(p1),
+                          static_cast<std::uint32_t>(p0 >> 32) ^ ctr.v[3] ^ k1, static_cast<std::uint32_t>(p0)}};
+        k0 += 0x9E3779B9U;
+        k1 += 0xBB67AE85U;
+    }
+    return ctr;
+}
+
+// Counter-based policy: the normal of (path, step) is the inverse CDF of
+// Philox4x32-10 keyed by the seed, at counter (path, step). Every path sees
+// the same numbers whatever the thread count, block size or scheduling, and
+// any path can be regenerated on its own. Generation runs through the
+// vectorized philox_normals kernel, in single precision when asked to
+// (McConfig::precision).
+class PhiloxRng {
+public:
+    static constexpr bool random_access = true;
+
+    PhiloxRng(std::uint64_t seed, std::uint64_t, Precision precision = Precision::Double)
+        : k0_(static_cast<std::uint32_t>(seed)), k1_(static_cast<std::uint32_t>(seed >> 32)), precision_(precision) {}
+
+    double normal(std::uint64_t path, std::size_t step) const {
+        double z;
+        philox_normals(k0_, k1_, path, 1, step, &z, precision_);
+        return z;
+    }
+
+    void normals(std::uint64_t first_path, std::size_t count, std::size_t step, double* out) const {
+        philox_normals(k0_, k1_, first_path, count, step, out, precision_);
+    }
+
+private:
+    std::uint32_t k0_, k1_;
+    Precision precision_;
+};
+
+// Randomized quasi-Monte Carlo: Sobol' points, path index = point index and
+// step = dimension, each dimension Owen-scrambled with Burley's hash-based
+// nested uniform scramble seeded from (seed, dimension), then mapped to
+// normals by the vectorized inverse CDF. Direction numbers come from the
+// primitive polynomials in degree order with regularity-breaking initial
+// values (Jaeckel), fixed for all runs. Pair with BrownianBridgePath so the
+// coarse path structure uses the leading dimensions.
+//
+// McResult::std_error is the i.i.d. estimate and overstates the QMC error;
+// compare runs over independent seeds for a randomized-QMC error bar.
+class SobolRng {
+public:
+    static constexpr bool random_access = true;
+    static constexpr std::size_t max_dimensions = 1024;
+
+    SobolRng(std::uint64_t seed, std::uint64_t) : seed_(seed) {}
+
+    // Throws std::out_of_range for dim >= max_dimensions or point
+    // indices beyond 2^32
+    void normals(std::uint64_t first_path, std::size_t count, std::size_t dim, double* out) const;
+
+private:
+    std::uint64_t seed_;
+};
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include "utils.h"
+
+namespace aemps {
+
+// Market scenarios as structure-of-arrays shifts applied to every contract
+// of a book: scenario k moves spot to S (1 + spot[k]), spot[k] > -1, and
+// adds vol[k] and rate[k] to the volatility and rate. A historical VaR day is that day's
+// relative spot return and absolute vol and rate changes; a stress grid is
+// the outer product of the shifts to be tried.
+struct ScenarioSet {
+    AlignedVector<double> spot; // relative spot shift
+    AlignedVector<double> vol;  // absolute vol shift; shifted vols floor at 0
+    AlignedVector<double> rate; // absolute rate shift
+
+    std::size_t size() const { return spot.size(); }
+    void reserve(std::size_t n) {
+        spot.reserve(n);
+        vol.reserve(n);
+        rate.reserve(n);
+    }
+    void push_back(double spot_shift, double vol_shift, double rate_shift) {
+        spot.push_back(spot_shift);
+        vol.push_back(vol_shift);
+        rate.push_back(rate_shift);
+    }
+};
+
+}
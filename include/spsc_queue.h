@@ -0,0 +1,98 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+#include "utils.h"
+
+namespace aemps {
+
+// Bounded single-producer single-consumer ring. try_push/try_pop never
+// block or allocate: one acquire load of the other side's index (usually
+// skipped thanks to a cached copy) and one release store of one's own.
+// push/pop wait by spinning, then yielding, then sleeping in growing
+// steps up to 256 us, so an idle pipeline costs next to no CPU while a
+// busy one never enters the kernel. close() ends the stream: pop() drains
+// what is left and then returns false.
+template <class T>
+class SpscQueue {
+public:
+    // Capacity is rounded up to a power of two
+    explicit SpscQueue(std::size_t capacity) {
+        std::size_t n = 2;
+        while (n < capacity) n <<= 1;
+        slots_.resize(n);
+        mask_ = n - 1;
+    }
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    std::size_t capacity() const { return slots_.size(); }
+
+    bool try_push(T& value) {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ == slots_.size()) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ == slots_.size()) return false;
+        }
+        slots_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& out) {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_) return false;
+        }
+        out = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Blocks while the ring is full; this is the backpressure
+    void push(T value) {
+        Backoff wait;
+        while (!try_push(value)) wait();
+    }
+
+    // Blocks until an item arrives; false once closed and drained
+    bool pop(T& out) {
+        Backoff wait;
+        for (;;) {
+            if (try_pop(out)) return true;
+            if (closed_.load(std::memory_order_acquire)) return try_pop(out);
+            wait();
+        }
+    }
+
+    // Producer side: no more pushes will follow
+    void close() { closed_.store(true, std::memory_order_release); }
+
+private:
+    struct Backoff {
+        unsigned rounds = 0;
+        void operator()() {
+            ++rounds;
+            if (rounds < 64) return;
+            if (rounds < 128) {
+                std::this_thread::yield();
+                return;
+            }
+            const unsigned shift = rounds - 128 < 8 ? rounds - 128 : 8;
+            std::this_thread::sleep_for(std::chrono::microseconds(1u << shift));
+        }
+    };
+
+    std::vector<T> slots_;
+    std::size_t mask_ = 0;
+    alignas(kCacheLine) std::atomic<std::size_t> head_{0}; // next slot to pop
+    std::size_t tail_cache_ = 0;                           // consumer's view of tail_
+    alignas(kCacheLine) std::atomic<std::size_t> tail_{0}; // next slot to push
+    std::size_t head_cache_ = 0;                           // producer's view of head_
+    alignas(kCacheLine) std::atomic<bool> closed_{false};
+};
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "option.h"
+
+namespace aemps {
+
+struct StreamConfig {
+    std::size_t workers = 0;       // pricing threads; 0 = hardware threads less the two I/O stages
+    std::size_t batch_size = 1024; // most records per micro-batch
+    std::size_t queue_depth = 4;   // micro-batches in flight per worker
+    bool greeks = true;            // emit delta..rho after the price
+    Precision precision = Precision::Double; // of prices without greeks
+};
+
+struct StreamStats {
+    std::uint64_t records = 0;
+    std::uint64_t errors = 0;
+    std::uint64_t batches = 0;
+    bool write_failed = false;
+};
+
+// Streaming Black-Scholes service loop: reads one option per line from
+// in_fd until end of input, prices in micro-batches, and writes one result
+// line per input line to out_fd, in input order. Records are
+//
+//     id,type,strike,maturity,spot,vol,rate      type C, P, call or put, any case
+//
+// and results `id,price,delta,gamma,vega,theta,rho` (`id,price` without
+// greeks) or `id,ERR,<reason>` for a malformed record. Blank lines and
+// lines starting with '#' are skipped.
+//
+// Three stages run on their own threads: a reader that parses into
+// micro-batches, `workers` pricing threads that also format the output,
+// and a writer. A micro-batch closes when it is full or when no more input
+// is ready, so a trickle of quotes is priced at once and a flood in full
+// batches. Batches go to the workers round-robin over bounded SPSC queues
+// and come back the same way, which keeps them in order without a reorder
+// buffer. They are recycled from a fixed pool, so memory stays flat and a
+// slow consumer stalls the reader. If writing fails (say, the peer hung
+// up) input stops being read, the loop winds down and the stats report
+// write_failed.
+StreamStats run_stream(int in_fd, int out_fd, const StreamConfig& config = StreamConfig());
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace aemps {
+
+// Work-stealing thread pool for fork-join loops. parallel_for hands every
+// worker (and the calling thread) a contiguous slice of the index range;
+// a worker drains its own slice front to back and, once empty, steals the
+// back half of the largest remaining slice of another worker.
+class ThreadPool {
+public:
+    // threads == 0 uses std::thread::hardware_concurrency() - 1 workers,
+    // the caller of parallel_for being the last participant
+    explicit ThreadPool(std::size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Threads taking part in parallel_for: workers plus the caller
+    std::size_t concurrency() const { return workers_.size() + 1; }
+
+    // Runs fn(i) for every i in [0, n) and blocks until all calls return.
+    // The first exception thrown by fn is rethrown here once the loop drains.
+    void parallel_for(std::size_t n, const std::function<void(std::size_t)>& fn);
+
+private:
+    struct Job;
+    struct Range {
+        Job* job;
+        std::size_t begin;
+        std::size_t end;
+    };
+    struct Slot {
+        std::mutex m;
+        std::deque<Range> ranges;
+    };
+
+    bool try_run(std::size_t self);
+    bool claim(std::size_t self, Job*& job, std::size_t& index);
+    void worker_loop(std::size_t self);
+
+    std::vector<std::unique_ptr<Slot>> slots_; // one per worker, last for callers
+    std::vector<std::thread> workers_;
+    std::atomic<std::size_t> pending_{0};      // queued but unclaimed indices
+    std::mutex wake_m_;
+    std::condition_variable wake_cv_;
+    std::condition_variable done_cv_;
+    bool stop_ = false;
+};
+
+// Process-wide pool sized to the machine, created on first use
+ThreadPool& default_thread_pool();
+
+}
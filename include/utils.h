@@ -1 +1,54 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <vector>
 
+namespace aemps {
+
+// Cache line size used for column and scratch alignment
+constexpr std::size_t kCacheLine = 64;
+
+// Standard normal density and cumulative distribution
+inline double norm_pdf(double x) {
+    return 0.398942280401432677939946059934 * std::exp(-0.5 * x * x);
+}
+
+inline double norm_cdf(double x) {
+    return 0.5 * std::erfc(-x * 0.707106781186547524400844362105);
+}
+
+// Inverse standard normal CDF (Wichura AS241, ~1e-16 relative) for p in (0, 1)
+double norm_inv(double p);
+
+// Raw aligned allocation; alignment must be a power of two
+void* aligned_alloc(std::size_t bytes, std::size_t alignment = kCacheLine);
+void aligned_free(void* p);
+
+// Allocator handing out cache-line aligned storage so SoA columns can be
+// streamed with full-width vector loads
+template <class T>
+struct AlignedAllocator {
+    using value_type = T;
+
+    AlignedAllocator() = default;
+    template <class U>
+    AlignedAllocator(const AlignedAllocator<U>&) {}
+
+    T* allocate(std::size_t n) {
+        if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) throw std::bad_alloc();
+        return static_cast<T*>(aligned_alloc(n * sizeof(T)));
+    }
+    void deallocate(T* p, std::size_t) { aligned_free(p); }
+
+    template <class U>
+    bool operator==(const AlignedAllocator<U>&) const { return true; }
+    template <class U>
+    bool operator!=(const AlignedAllocator<U>&) const { return false; }
+};
+
+template <class T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+}
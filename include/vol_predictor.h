@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "volatility_model.h"
+
+namespace aemps {
+
+// Row-major feature matrix borrowed from the caller: rows x cols doubles
+// with consecutive rows `cols` apart
+struct FeatureMatrix {
+    const double* data = nullptr;
+    std::size_t rows = 0;
+    std::size_t cols = 0;
+};
+
+// Batched volatility forecaster: one call maps every row of a feature
+// matrix to a predicted vol. Implementations must be callable from several
+// threads at once.
+class VolPredictor {
+public:
+    virtual ~VolPredictor() = default;
+    // Writes features.rows predictions to out
+    virtual void predict(const FeatureMatrix& features, double* out) const = 0;
+};
+
+// Memoises a VolPredictor per (underlier, snapshot), so repricing against
+// a snapshot that has already been forecast never reaches the model. A
+// miss runs the predictor outside the lock and concurrent requests for
+// the same key wait for that single call. The least recently used key is
+// evicted beyond `capacity`. Predictor exceptions propagate to every
+// waiter and leave the key uncached.
+class VolPredictionCache {
+public:
+    using Predictions = std::shared_ptr<const std::vector<double>>;
+
+    explicit VolPredictionCache(std::shared_ptr<const VolPredictor> predictor, std::size_t capacity = 64);
+
+    // Predictions for the features of (underlier, snapshot); the features
+    // are read only on a miss
+    Predictions predict(const std::string& underlier, std::uint64_t snapshot, const FeatureMatrix& features);
+
+    // Surface over a strike x maturity grid whose feature rows are the
+    // nodes in GridVolSurface order (maturity-major); throws
+    // std::invalid_argument if features.rows does not match the grid
+    std::shared_ptr<const GridVolSurface> surface(const std::string& underlier, std::uint64_t snapshot,
+                                                  const std::vector<double>& strikes,
+                                                  const std::vector<double>& maturities, const FeatureMatrix& features);
+
+    // Drops every snapshot of an underlier
+    void invalidate(const std::string& underlier);
+    void clear();
+
+    std::size_t size() const;
+    std::uint64_t hits() const;
+    std::uint64_t misses() const;
+
+private:
+    using Key = std::pair<std::string, std::uint64_t>;
+    struct Entry {
+        std::shared_future<Predictions> value;
+        std::shared_ptr<const GridVolSurface> surface; // built on first surface() call
+        std::list<Key>::iterator lru;
+        std::uint64_t miss; // which miss created it
+    };
+
+    std::shared_future<Predictions> lookup(const Key& key, const FeatureMatrix& features);
+
+    std::shared_ptr<const VolPredictor> predictor_;
+    std::size_t capacity_;
+    mutable std::mutex mutex_;
+    std::map<Key, Entry> entries_;
+    std::list<Key> lru_; // most recent first
+    std::uint64_t hits_ = 0;
+    std::uint64_t misses_ = 0;
+};
+
+}
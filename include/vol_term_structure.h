@@ -0,0 +1,45 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace aemps {
+
+// Piecewise-constant volatility in time: vols[j] applies on
+// (times[j - 1], times[j]] with times[-1] = 0, and the last bucket extends
+// flat beyond times.back(). These are the nodes bucketed vega is taken
+// against.
+struct VolTermStructure {
+    std::vector<double> times; // bucket end times, strictly increasing
+    std::vector<double> vols;
+
+    VolTermStructure() = default;
+    // Single flat bucket
+    explicit VolTermStructure(double vol) : times{1.0}, vols{vol} {}
+    VolTermStructure(std::vector<double> t, std::vector<double> v) : times(std::move(t)), vols(std::move(v)) {
+        if (times.empty() || times.size() != vols.size())
+            throw std::invalid_argument("VolTermStructure: need one vol per bucket time");
+        for (std::size_t j = 1; j < times.size(); ++j)
+            if (!(times[j] > times[j - 1])) throw std::invalid_argument("VolTermStructure: times must increase");
+    }
+
+    std::size_t buckets() const { return vols.size(); }
+
+    // Length of [t0, t1] that falls in bucket j
+    double overlap(std::size_t j, double t0, double t1) const {
+        const double lo = j == 0 ? 0.0 : times[j - 1];
+        const double hi = j + 1 == times.size() ? std::max(t1, times[j]) : times[j];
+        return std::max(std::min(t1, hi) - std::max(t0, lo), 0.0);
+    }
+
+    // Integrated variance over [t0, t1]
+    double variance(double t0, double t1) const {
+        double v = 0.0;
+        for (std::size_t j = 0; j < vols.size(); ++j) v += vols[j] * vols[j] * overlap(j, t0, t1);
+        return v;
+    }
+};
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace aemps {
+
+// Source of Black volatilities by strike and expiry. Implementations are
+// immutable once built, so one instance (typically a
+// std::shared_ptr<const VolatilityModel>) can be read from any number of
+// pricing threads without locking.
+class VolatilityModel {
+public:
+    virtual ~VolatilityModel() = default;
+
+    // Implied volatility for options struck at `strike` expiring at
+    // `maturity` (years)
+    virtual double volatility(double strike, double maturity) const = 0;
+
+    // out[i] = volatility(strike[i], maturity[i]); one virtual call per
+    // batch rather than per option
+    virtual void volatility(const double* strike, const double* maturity, std::size_t n, double* out) const;
+
+    // Total implied variance sigma^2 T
+    virtual double total_variance(double strike, double maturity) const;
+};
+
+// Same volatility everywhere
+class FlatVolatility : public VolatilityModel {
+public:
+    explicit FlatVolatility(double vol) : vol_(vol) {}
+
+    double volatility(double, double) const override { return vol_; }
+    void volatility(const double* strike, const double* maturity, std::size_t n, double* out) const override;
+    double total_variance(double, double maturity) const override { return vol_ * vol_ * maturity; }
+
+private:
+    double vol_;
+};
+
+// Implied vols sampled on a strike x maturity grid (vols[m * strikes + k]
+// at maturities[m], strikes[k]). Total variance is interpolated linearly
+// in strike and in maturity, which keeps a calendar-arbitrage-free grid
+// free of it in between. Strikes are extrapolated flat, and so are vols
+// before the first and after the last maturity. Each axis carries a
+// uniform bucket table over its nodes, so a lookup is one multiply, one
+// table read and at most a step or two, not a binary search.
+class GridVolSurface : public VolatilityModel {
+public:
+    // Axes must be strictly increasing with at least one node; maturities
+    // must be positive. Throws std::invalid_argument otherwise.
+    GridVolSurface(std::vector<double> strikes, std::vector<double> maturities, std::vector<double> vols);
+
+    double volatility(double strike, double maturity) const override;
+    void volatility(const double* strike, const double* maturity, std::size_t n, double* out) const override;
+    double total_variance(double strike, double maturity) const override;
+
+    // Grid nodes (m * strikes().size() + k) that volatility(strike,
+    // maturity) reads: at most two strikes on each of at most two
+    // maturities. Writes them to `nodes` and returns how many. `weights`,
+    // when given, receives d total_variance(strike, maturity) / d w for
+    // each node's total variance w = vol^2 T (all 0 for maturity <= 0).
+    std::size_t stencil(double strike, double maturity, std::size_t nodes[4], double weights[4] = nullptr) const;
+
+    const std::vector<double>& strikes() const { return strikes_.nodes; }
+    const std::vector<double>& maturities() const { return maturities_.nodes; }
+
+private:
+    // Sorted nodes plus a table mapping equal-width cells of
+    // [front, back] to the node interval that contains the cell start
+    struct Axis {
+        std::vector<double> nodes;
+        std::vector<double> inv_gap; // 1 / (nodes[i + 1] - nodes[i])
+        std::vector<std::uint32_t> bucket;
+        double origin = 0.0;
+        double inv_width = 0.0;
+
+        void build(const char* name);
+        // Largest i with nodes[i] <= x, clamped to [0, size - 2]
+        std::size_t locate(double x) const;
+    };
+
+    double variance(double strike, double maturity) const;
+
+    Axis strikes_;
+    Axis maturities_;
+    std::vector<double> w_; // total variance at each node, same layout as vols
+};
+
+}
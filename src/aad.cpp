@@ -0,0 +1,15 @@
+#include "aad.h"
+
+namespace aemps {
+
+void Tape::propagate(std::size_t from, std::size_t stop) {
+    for (std::size_t i = from + 1; i-- > stop;) {
+        const double a = adjoints_[i];
+        if (a == 0.0) continue;
+        const Node& node = nodes_[i];
+        adjoints_[node.arg[0]] += node.partial[0] * a;
+        adjoints_[node.arg[1]] += node.partial[1] * a;
+    }
+}
+
+}
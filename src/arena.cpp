@@ -0,0 +1,73 @@
+#include "arena.h"
+#include "instrumentation.h"
+
+namespace aemps {
+
+Arena::~Arena() {
+    for (const Chunk& c : chunks_) aligned_free(c.data);
+}
+
+void* Arena::allocate(std::size_t bytes, std::size_t alignment) {
+    if (bytes == 0) bytes = 1;
+    for (;;) {
+        if (current_ < chunks_.size()) {
+            const Chunk& c = chunks_[current_];
+            const std::size_t begin = (offset_ + alignment - 1) & ~(alignment - 1);
+            if (begin <= c.size && bytes <= c.size - begin) {
+                offset_ = begin + bytes;
+                const std::size_t u = used();
+                if (u > high_water_) high_water_ = u;
+                return c.data + begin;
+            }
+            // Move on to the next chunk if it is big enough, else drop the
+            // unused chunks past this one and grow
+            if (current_ + 1 < chunks_.size() && chunks_[current_ + 1].size >= bytes) {
+                ++current_;
+                offset_ = 0;
+                continue;
+            }
+            for (std::size_t i = current_ + 1; i < chunks_.size(); ++i) aligned_free(chunks_[i].data);
+            chunks_.resize(current_ + 1);
+        }
+        const std::size_t size = bytes > chunk_bytes_ ? bytes : chunk_bytes_;
+        chunks_.push_back({static_cast<char*>(aligned_alloc(size, kCacheLine)), size});
+        add_count(Counter::ArenaChunks);
+        current_ = chunks_.size() - 1;
+        offset_ = 0;
+    }
+}
+
+void Arena::rewind(const Marker& m) {
+    current_ = m.chunk;
+    offset_ = m.offset;
+}
+
+void Arena::reset() {
+    current_ = 0;
+    offset_ = 0;
+    if (chunks_.size() <= 1) return;
+    const std::size_t size = capacity();
+    for (const Chunk& c : chunks_) aligned_free(c.data);
+    chunks_.clear();
+    chunks_.push_back({static_cast<char*>(aligned_alloc(size, kCacheLine)), size});
+    add_count(Counter::ArenaChunks);
+}
+
+std::size_t Arena::capacity() const {
+    std::size_t total = 0;
+    for (const Chunk& c : chunks_) total += c.size;
+    return total;
+}
+
+std::size_t Arena::used() const {
+    std::size_t total = offset_;
+    for (std::size_t i = 0; i < current_ && i < chunks_.size(); ++i) total += chunks_[i].size;
+    return total;
+}
+
+Arena& thread_arena() {
+    thread_local Arena arena;
+    return arena;
+}
+
+}
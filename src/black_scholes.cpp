@@ -0,0 +1,187 @@
+#include "black_scholes.h"
+#include "kernels.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "volatility_model.h"
+
+namespace aemps {
+
+namespace {
+
+// phi is +1 for calls and -1 for puts so both legs share one formula:
+// phi * (S N(phi d1) - K exp(-rT) N(phi d2))
+inline double bs_price(double phi, double S, double K, double T, double r, double sigma) {
+    const double t = T > 0.0 ? T : 0.0;
+    const double df = std::exp(-r * t);
+    const double sd = sigma * std::sqrt(t);
+    if (!(sd > 0.0)) return std::max(phi * (S - K * df), 0.0);
+    const double d1 = std::log(S / (K * df)) / sd + 0.5 * sd;
+    const double d2 = d1 - sd;
+    return phi * (S * norm_cdf(phi * d1) - K * df * norm_cdf(phi * d2));
+}
+
+inline Greeks bs_greeks(double phi, double S, double K, double T, double r, double sigma) {
+    const double t = T > 0.0 ? T : 0.0;
+    const double df = std::exp(-r * t);
+    const double sd = sigma * std::sqrt(t);
+    Greeks g;
+    if (!(sd > 0.0)) {
+        const bool itm = phi * (S - K * df) > 0.0;
+        g.price = itm ? phi * (S - K * df) : 0.0;
+        g.delta = itm ? phi : 0.0;
+        g.gamma = 0.0;
+        g.vega = 0.0;
+        g.theta = itm ? -phi * r * K * df : 0.0;
+        g.rho = itm ? phi * K * t * df : 0.0;
+        return g;
+    }
+    const double d1 = std::log(S / (K * df)) / sd + 0.5 * sd;
+    const double d2 = d1 - sd;
+    const double n1 = norm_cdf(phi * d1);
+    const double n2 = norm_cdf(phi * d2);
+    const double pdf1 = norm_pdf(d1);
+    g.price = phi * (S * n1 - K * df * n2);
+    g.delta = phi * n1;
+    g.gamma = pdf1 / (S * sd);
+    g.vega = S * pdf1 * std::sqrt(t);
+    g.theta = -g.vega * sigma / (2.0 * t) - phi * r * K * df * n2;
+    g.rho = phi * K * t * df * n2;
+    return g;
+}
+
+inline double sign_of(OptionType t) {
+    return t == OptionType::Call ? 1.0 : -1.0;
+}
+
+// Contracts per surface query; the vols stay in L1 between the model and
+// the kernel
+constexpr std::size_t kVolChunk = 256;
+
+OptionBatch slice(const OptionBatch& b, std::size_t first, std::size_t n, const double* vols) {
+    OptionBatch s;
+    s.size = n;
+    s.type = b.type + first;
+    s.strike = b.strike + first;
+    s.maturity = b.maturity + first;
+    s.spot = b.spot + first;
+    s.volatility = vols;
+    s.rate = b.rate + first;
+    return s;
+}
+
+// Contracts per tile of book_values(); a tile's price rows stay in cache
+// while they are summed
+constexpr std::size_t kScenarioTile = 32;
+
+// Spot scales and their logs, shared by every contract
+void spot_scales(const ScenarioSet& s, AlignedVector<double>& scale, AlignedVector<double>& log_scale) {
+    if (s.vol.size() != s.size() || s.rate.size() != s.size())
+        throw std::invalid_argument("BlackScholes: scenario columns differ in length");
+    scale.resize(s.size());
+    log_scale.resize(s.size());
+    for (std::size_t k = 0; k < s.size(); ++k) {
+        if (!(s.spot[k] > -1.0)) throw std::invalid_argument("BlackScholes: spot shift must be above -1");
+        scale[k] = 1.0 + s.spot[k];
+        log_scale[k] = std::log1p(s.spot[k]);
+    }
+}
+
+double* offset(double* column, std::size_t first) {
+    return column ? column + first : nullptr;
+}
+
+}
+
+double BlackScholes::price(const Option& opt, double rate, double volatility) {
+    return bs_price(sign_of(opt.type), opt.spot, opt.strike, opt.maturity, rate, volatility);
+}
+
+void BlackScholes::price(const OptionBatch& batch, double* prices, Precision precision) {
+    const detail::KernelTable& k = detail::kernels();
+    if (precision == Precision::Single)
+        k.bs_price_f32(batch, prices);
+    else
+        k.bs_price(batch, prices);
+}
+
+void BlackScholes::price(const OptionBatch& batch, const VolatilityModel& vol, double* prices) {
+    const detail::KernelTable& k = detail::kernels();
+    alignas(kCacheLine) double vols[kVolChunk];
+    for (std::size_t i = 0; i < batch.size; i += kVolChunk) {
+        const std::size_t n = std::min(kVolChunk, batch.size - i);
+        vol.volatility(batch.strike + i, batch.maturity + i, n, vols);
+        k.bs_price(slice(batch, i, n, vols), prices + i);
+    }
+}
+
+void BlackScholes::price(const OptionBatch& batch, const ScenarioSet& scenarios, double* prices) {
+    AlignedVector<double> scale, log_scale;
+    spot_scales(scenarios, scale, log_scale);
+    detail::kernels().bs_scenarios(batch, scale.data(), log_scale.data(), scenarios.vol.data(),
+                                   scenarios.rate.data(), scenarios.size(), prices);
+}
+
+void BlackScholes::book_values(const OptionBatch& batch, const double* quantity, const ScenarioSet& scenarios,
+                               double* values) {
+    AlignedVector<double> scale, log_scale;
+    spot_scales(scenarios, scale, log_scale);
+    const std::size_t m = scenarios.size();
+    std::fill(values, values + m, 0.0);
+    const detail::KernelTable& k = detail::kernels();
+    AlignedVector<double> tile(kScenarioTile * m);
+    for (std::size_t i = 0; i < batch.size; i += kScenarioTile) {
+        const std::size_t n = std::min(kScenarioTile, batch.size - i);
+        k.bs_scenarios(slice(batch, i, n, batch.volatility + i), scale.data(), log_scale.data(), scenarios.vol.data(),
+                       scenarios.rate.data(), m, tile.data());
+        for (std::size_t j = 0; j < n; ++j) {
+            const double q = quantity ? quantity[i + j] : 1.0;
+            const double* row = &tile[j * m];
+            for (std::size_t s = 0; s < m; ++s) values[s] += q * row[s];
+        }
+    }
+}
+
+Greeks BlackScholes::greeks(const Option& opt, double rate, double volatility) {
+    return bs_greeks(sign_of(opt.type), opt.spot, opt.strike, opt.maturity, rate, volatility);
+}
+
+void BlackScholes::greeks(const OptionBatch& batch, const GreeksOutput& out) {
+    detail::kernels().bs_greeks(batch, out);
+}
+
+void BlackScholes::greeks(const OptionBatch& batch, const VolatilityModel& vol, const GreeksOutput& out) {
+    const detail::KernelTable& k = detail::kernels();
+    alignas(kCacheLine) double vols[kVolChunk];
+    for (std::size_t i = 0; i < batch.size; i += kVolChunk) {
+        const std::size_t n = std::min(kVolChunk, batch.size - i);
+        vol.volatility(batch.strike + i, batch.maturity + i, n, vols);
+        GreeksOutput o;
+        o.price = offset(out.price, i);
+        o.delta = offset(out.delta, i);
+        o.gamma = offset(out.gamma, i);
+        o.vega = offset(out.vega, i);
+        o.theta = offset(out.theta, i);
+        o.rho = offset(out.rho, i);
+        k.bs_greeks(slice(batch, i, n, vols), o);
+    }
+}
+
+double BlackScholes::implied_vol(const Option& opt, double rate, double price) {
+    OptionBatch batch;
+    batch.size = 1;
+    batch.type = &opt.type;
+    batch.strike = &opt.strike;
+    batch.maturity = &opt.maturity;
+    batch.spot = &opt.spot;
+    batch.rate = &rate;
+    double vol;
+    detail::kernels().implied_vol(batch, &price, &vol);
+    return vol;
+}
+
+void BlackScholes::implied_vol(const OptionBatch& batch, const double* prices, double* vols) {
+    detail::kernels().implied_vol(batch, prices, vols);
+}
+
+}
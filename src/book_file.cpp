@@ -0,0 +1,209 @@
+#include "book_file.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "utils.h"
+
+namespace aemps {
+
+namespace {
+
+static_assert(sizeof(BookFileHeader) == 64, "BookFileHeader must stay 64 bytes");
+static_assert(sizeof(BookFileColumn) == 24, "BookFileColumn must stay 24 bytes");
+static_assert(sizeof(OptionType) == 4, "book files store OptionType as 32 bits");
+
+constexpr char kMagic[8] = {'A', 'E', 'M', 'P', 'S', 'B', 'K', '\0'};
+constexpr std::uint32_t kVersion = 1;
+constexpr std::uint32_t kByteOrder = 0x01020304;
+
+[[noreturn]] void fail(const std::string& what, const std::string& path) {
+    throw std::runtime_error("book file " + path + ": " + what + (errno ? std::string(": ") + std::strerror(errno) : ""));
+}
+
+[[noreturn]] void malformed(const std::string& what, const std::string& path) {
+    errno = 0;
+    fail(what, path);
+}
+
+void write_all(int fd, const void* data, std::size_t bytes, const std::string& path) {
+    const char* p = static_cast<const char*>(data);
+    while (bytes > 0) {
+        const ssize_t n = ::write(fd, p, bytes);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) fail("write failed", path);
+        p += n;
+        bytes -= static_cast<std::size_t>(n);
+    }
+}
+
+std::uint64_t round_up(std::uint64_t x) {
+    return (x + kCacheLine - 1) / kCacheLine * kCacheLine;
+}
+
+std::uint32_t expected_size(BookColumn id) {
+    switch (id) {
+    case BookColumn::Type: return sizeof(OptionType);
+    case BookColumn::TradeId: return sizeof(std::uint64_t);
+    case BookColumn::Strike:
+    case BookColumn::Maturity:
+    case BookColumn::Spot:
+    case BookColumn::Volatility:
+    case BookColumn::Rate: return sizeof(double);
+    }
+    return 0;
+}
+
+}
+
+void write_book_file(const std::string& path, const OptionBatch& batch, const std::uint64_t* trade_ids) {
+    struct Source {
+        BookColumn id;
+        const void* data;
+    };
+    std::vector<Source> sources = {{BookColumn::Type, batch.type},
+                                   {BookColumn::Strike, batch.strike},
+                                   {BookColumn::Maturity, batch.maturity},
+                                   {BookColumn::Spot, batch.spot}};
+    if (batch.volatility) sources.push_back({BookColumn::Volatility, batch.volatility});
+    if (batch.rate) sources.push_back({BookColumn::Rate, batch.rate});
+    if (trade_ids) sources.push_back({BookColumn::TradeId, trade_ids});
+    for (const Source& s : sources)
+        if (!s.data && batch.size > 0) throw std::invalid_argument("write_book_file: missing required column");
+
+    BookFileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof kMagic);
+    header.version = kVersion;
+    header.byte_order = kByteOrder;
+    header.rows = batch.size;
+    header.column_count = static_cast<std::uint32_t>(sources.size());
+
+    std::vector<BookFileColumn> columns;
+    std::uint64_t offset = round_up(sizeof header + sources.size() * sizeof(BookFileColumn));
+    for (const Source& s : sources) {
+        const std::uint32_t size = expected_size(s.id);
+        columns.push_back({s.id, size, offset, batch.size * size});
+        offset = round_up(offset + batch.size * size);
+    }
+
+    const std::string tmp = path + ".tmp." + std::to_string(::getpid());
+    const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) fail("cannot create", tmp);
+    try {
+        const char zeros[kCacheLine] = {};
+        std::uint64_t at = 0;
+        auto pad_to = [&](std::uint64_t target) {
+            write_all(fd, zeros, static_cast<std::size_t>(target - at), tmp);
+            at = target;
+        };
+        write_all(fd, &header, sizeof header, tmp);
+        write_all(fd, columns.data(), columns.size() * sizeof(BookFileColumn), tmp);
+        at = sizeof header + columns.size() * sizeof(BookFileColumn);
+        for (std::size_t c = 0; c < columns.size(); ++c) {
+            pad_to(columns[c].offset);
+            write_all(fd, sources[c].data, static_cast<std::size_t>(columns[c].bytes), tmp);
+            at += columns[c].bytes;
+        }
+        pad_to(offset);
+        if (::fsync(fd) != 0) fail("fsync failed", tmp);
+    } catch (...) {
+        ::close(fd);
+        ::unlink(tmp.c_str());
+        throw;
+    }
+    if (::close(fd) != 0) {
+        ::unlink(tmp.c_str());
+        fail("close failed", tmp);
+    }
+    if (::rename(tmp.c_str(), path.c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        fail("cannot rename over", path);
+    }
+}
+
+MappedBook::MappedBook(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) fail("cannot open", path);
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        fail("cannot stat", path);
+    }
+    length_ = static_cast<std::size_t>(st.st_size);
+    if (length_ < sizeof(BookFileHeader)) {
+        ::close(fd);
+        malformed("too short for a header", path);
+    }
+    base_ = ::mmap(nullptr, length_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base_ == MAP_FAILED) {
+        base_ = nullptr;
+        fail("mmap failed", path);
+    }
+
+    try {
+        const char* bytes = static_cast<const char*>(base_);
+        BookFileHeader header;
+        std::memcpy(&header, bytes, sizeof header);
+        if (std::memcmp(header.magic, kMagic, sizeof kMagic) != 0) malformed("not a book file", path);
+        if (header.byte_order != kByteOrder) malformed("written with the other byte order", path);
+        if (header.version != kVersion) malformed("unsupported version " + std::to_string(header.version), path);
+        const std::uint64_t table_end = sizeof header + std::uint64_t(header.column_count) * sizeof(BookFileColumn);
+        if (table_end > length_) malformed("truncated column table", path);
+
+        view_.size = static_cast<std::size_t>(header.rows);
+        for (std::uint32_t c = 0; c < header.column_count; ++c) {
+            BookFileColumn col;
+            std::memcpy(&col, bytes + sizeof header + c * sizeof col, sizeof col);
+            const std::uint32_t size = expected_size(col.id);
+            if (size == 0) continue; // a later minor revision's column
+            if (col.element_size != size || col.offset % kCacheLine != 0 || col.bytes / size != header.rows ||
+                col.bytes % size != 0 || col.offset > length_ || col.bytes > length_ - col.offset)
+                malformed("bad column " + std::to_string(static_cast<std::uint32_t>(col.id)), path);
+            const void* data = bytes + col.offset;
+            switch (col.id) {
+            case BookColumn::Type: view_.type = static_cast<const OptionType*>(data); break;
+            case BookColumn::Strike: view_.strike = static_cast<const double*>(data); break;
+            case BookColumn::Maturity: view_.maturity = static_cast<const double*>(data); break;
+            case BookColumn::Spot: view_.spot = static_cast<const double*>(data); break;
+            case BookColumn::Volatility: view_.volatility = static_cast<const double*>(data); break;
+            case BookColumn::Rate: view_.rate = static_cast<const double*>(data); break;
+            case BookColumn::TradeId: trade_ids_ = static_cast<const std::uint64_t*>(data); break;
+            }
+        }
+        if (!view_.type || !view_.strike || !view_.maturity || !view_.spot) malformed("missing required column", path);
+    } catch (...) {
+        ::munmap(base_, length_);
+        throw;
+    }
+}
+
+MappedBook::~MappedBook() {
+    if (base_) ::munmap(base_, length_);
+}
+
+MappedBook::MappedBook(MappedBook&& other) noexcept
+    : base_(other.base_), length_(other.length_), view_(other.view_), trade_ids_(other.trade_ids_) {
+    other.base_ = nullptr;
+    other.length_ = 0;
+    other.view_ = OptionBatch{};
+    other.trade_ids_ = nullptr;
+}
+
+MappedBook& MappedBook::operator=(MappedBook&& other) noexcept {
+    if (this != &other) {
+        if (base_) ::munmap(base_, length_);
+        base_ = std::exchange(other.base_, nullptr);
+        length_ = std::exchange(other.length_, 0);
+        view_ = std::exchange(other.view_, OptionBatch{});
+        trade_ids_ = std::exchange(other.trade_ids_, nullptr);
+    }
+    return *this;
+}
+
+}
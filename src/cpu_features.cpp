@@ -0,0 +1,68 @@
+#include "cpu_features.h"
+#include "kernels.h"
+#include <cstdlib>
+#include <cstring>
+
+namespace aemps {
+
+namespace {
+
+int rank(SimdIsa isa) {
+    switch (isa) {
+    case SimdIsa::Avx512: return 3;
+    case SimdIsa::Avx2: return 2;
+    default: return 1;
+    }
+}
+
+// Highest ISA allowed by AEMPS_SIMD; unknown values are ignored
+int env_cap() {
+    const char* v = std::getenv("AEMPS_SIMD");
+    if (!v) return 3;
+    if (!std::strcmp(v, "avx512")) return 3;
+    if (!std::strcmp(v, "avx2")) return 2;
+    if (!std::strcmp(v, "sse2") || !std::strcmp(v, "neon") || !std::strcmp(v, "portable")) return 1;
+    return 3;
+}
+
+const detail::KernelTable& select_kernels() {
+    const int cap = env_cap();
+#if defined(AEMPS_HAVE_X86_KERNELS)
+    __builtin_cpu_init();
+    if (cap >= rank(SimdIsa::Avx512) && __builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512dq"))
+        return detail::avx512::kernel_table;
+    if (cap >= rank(SimdIsa::Avx2) && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return detail::avx2::kernel_table;
+#else
+    (void)cap;
+#endif
+    return detail::portable::kernel_table;
+}
+
+}
+
+namespace detail {
+
+const KernelTable& kernels() {
+    static const KernelTable& table = select_kernels();
+    return table;
+}
+
+}
+
+SimdIsa active_simd_isa() {
+    return detail::kernels().isa;
+}
+
+const char* to_string(SimdIsa isa) {
+    switch (isa) {
+    case SimdIsa::Sse2: return "sse2";
+    case SimdIsa::Neon: return "neon";
+    case SimdIsa::Avx2: return "avx2";
+    case SimdIsa::Avx512: return "avx512";
+    default: return "portable";
+    }
+}
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+
+// Host/device math for the CUDA backend. Written so the same source also
+// compiles as plain C++, which keeps it checkable against the CPU kernels.
+#if defined(__CUDACC__)
+#define AEMPS_HD __host__ __device__ __forceinline__
+#else
+#define AEMPS_HD inline
+#endif
+
+namespace aemps {
+namespace cuda {
+
+// Philox4x32-10, as philox4x32_10 in rng.h
+AEMPS_HD void philox4x32_10(std::uint32_t c[4], std::uint32_t k0, std::uint32_t k1) {
+    for (int round = 0; round < 10; ++round) {
+        const std::uint64_t p0 = 0xD2511F53ULL * c[0];
+        const std::uint64_t p1 = 0xCD9E8D57ULL * c[2];
+        const std::uint32_t c1 = c[1], c3 = c[3];
+        c[0] = static_cast<std::uint32_t>(p1 >> 32) ^ c1 ^ k0;
+        c[1] = static_cast<std::uint32_t>(p1);
+        c[2] = static_cast<std::uint32_t>(p0 >> 32) ^ c3 ^ k1;
+        c[3] = static_cast<std::uint32_t>(p0);
+        k0 += 0x9E3779B9U;
+        k1 += 0xBB67AE85U;
+    }
+}
+
+// norm_inv (utils.cpp), Wichura AS241
+AEMPS_HD double norm_inv(double p) {
+    const double q = p - 0.5;
+    if (std::fabs(q) <= 0.425) {
+        const double r = 0.180625 - q * q;
+        const double num = ((((((2509.0809287301226727 * r + 33430.575583588128105) * r + 67265.770927008700853) * r +
+                               45921.953931549871457) * r + 13731.693765509461125) * r + 1971.5909503065514427) * r +
+                            133.14166789178437745) * r + 3.387132872796366608;
+        const double den = ((((((5226.495278852545925 * r + 28729.085735721942674) * r + 39307.89580009271061) * r +
+                               21213.794301586595867) * r + 5394.1960214247511077) * r + 687.1870074920579083) * r +
+                            42.313330701600911252) * r + 1.0;
+        return q * num / den;
+    }
+    double r = std::sqrt(-std::log(q < 0.0 ? p : 1.0 - p));
+    double val;
+    if (r <= 5.0) {
+        r -= 1.6;
+        const double num = ((((((7.7454501427834140764e-4 * r + 0.0227238449892691845833) * r + 0.24178072517745061177) * r +
+                               1.27045825245236838258) * r + 3.64784832476320460504) * r + 5.7694972214606914055) * r +
+                            4.6303378461565452959) * r + 1.42343711074968357734;
+        const double den = ((((((1.05075007164441684324e-9 * r + 5.475938084995344946e-4) * r + 0.0151986665636164571966) * r +
+                               0.14810397642748007459) * r + 0.68976733498510000455) * r + 1.6763848301838038494) * r +
+                            2.05319162663775882187) * r + 1.0;
+        val = num / den;
+    } else {
+        r -= 5.0;
+        const double num = ((((((2.01033439929228813265e-7 * r + 2.71155556874348757815e-5) * r + 0.0012426609473880784386) * r +
+                               0.026532189526576123093) * r + 0.29656057182850489123) * r + 1.7848265399172913358) * r +
+                            5.4637849111641143699) * r + 6.6579046435011037772;
+        const double den = ((((((2.04426310338993978564e-15 * r + 1.4215117583164458887e-7) * r + 1.8463183175100546818e-5) * r +
+                               7.868691311456132591e-4) * r + 0.0148753612908506148525) * r + 0.13692988092273580531) * r +
+                            0.59983220655588793769) * r + 1.0;
+        val = num / den;
+    }
+    return q < 0.0 ? -val : val;
+}
+
+// Normal of (path, step) under key (k0, k1), the PhiloxRng mapping: top 52
+// bits of the first two words as (m + 1/2) 2^-52
+AEMPS_HD double philox_normal(std::uint32_t k0, std::uint32_t k1, std::uint64_t path, std::uint64_t step) {
+    std::uint32_t c[4] = {static_cast<std::uint32_t>(path), static_cast<std::uint32_t>(path >> 32),
+                          static_cast<std::uint32_t>(step), static_cast<std::uint32_t>(step >> 32)};
+    philox4x32_10(c, k0, k1);
+    const std::uint64_t bits = (static_cast<std::uint64_t>(c[1]) << 32) | c[0];
+    return norm_inv(static_cast<double>(bits >> 12) * 0x1.0p-52 + 0x1.0p-53);
+}
+
+// One trade as the kernel sees it
+struct Trade {
+    double log_spot;
+    double strike;
+    double phi; // +1 call, -1 put
+    double drift;     // per step, log space
+    double diffusion; // per step
+};
+
+// Undiscounted payoff of the path driven by draw `draw`, mirrored (-z) when
+// sign < 0
+AEMPS_HD double simulate_path(const Trade& t, std::uint32_t k0, std::uint32_t k1, std::uint64_t draw,
+                              std::uint64_t steps, double sign) {
+    double x = t.log_spot;
+    for (std::uint64_t s = 0; s < steps; ++s) x += t.drift + t.diffusion * (sign * philox_normal(k0, k1, draw, s));
+    const double v = t.phi * (std::exp(x) - t.strike);
+    return v > 0.0 ? v : 0.0;
+}
+
+}
+}
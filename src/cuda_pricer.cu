@@ -0,0 +1,180 @@
+#include "cuda_pricer.h"
+#include <cuda_runtime.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "black_scholes.h"
+#include "cuda_device.h"
+
+namespace aemps {
+
+namespace {
+
+// Welford moments of one thread, then of one block
+struct Partial {
+    unsigned long long n;
+    double mean;
+    double m2;
+};
+
+__device__ __forceinline__ void add(Partial& p, double x) {
+    ++p.n;
+    const double d = x - p.mean;
+    p.mean += d / static_cast<double>(p.n);
+    p.m2 += d * (x - p.mean);
+}
+
+__device__ __forceinline__ void combine(Partial& a, const Partial& b) {
+    if (b.n == 0) return;
+    const double na = static_cast<double>(a.n), nb = static_cast<double>(b.n);
+    const double w = nb / (na + nb);
+    const double d = b.mean - a.mean;
+    a.m2 += b.m2 + d * d * na * w;
+    a.mean += d * w;
+    a.n += b.n;
+}
+
+// Grid: x = path blocks of one trade, y = trades (strided past 65535).
+// Draws are dealt to threads round-robin and the shared-memory tree reduces
+// in a fixed order, so partials depend only on the launch shape.
+__global__ void price_kernel(const cuda::Trade* trades, std::size_t trade_count, std::uint32_t k0, std::uint32_t k1,
+                             std::uint64_t draws, std::uint64_t steps, bool antithetic, Partial* partials) {
+    extern __shared__ Partial shared[];
+    const std::uint64_t stride = static_cast<std::uint64_t>(gridDim.x) * blockDim.x;
+    for (std::size_t trade = blockIdx.y; trade < trade_count; trade += gridDim.y) {
+        const cuda::Trade t = trades[trade];
+        Partial p{0, 0.0, 0.0};
+        for (std::uint64_t d = static_cast<std::uint64_t>(blockIdx.x) * blockDim.x + threadIdx.x; d < draws;
+             d += stride) {
+            double v = cuda::simulate_path(t, k0, k1, d, steps, 1.0);
+            if (antithetic) v = 0.5 * (v + cuda::simulate_path(t, k0, k1, d, steps, -1.0));
+            add(p, v);
+        }
+        shared[threadIdx.x] = p;
+        __syncthreads();
+        for (unsigned s = blockDim.x / 2; s > 0; s >>= 1) {
+            if (threadIdx.x < s) combine(shared[threadIdx.x], shared[threadIdx.x + s]);
+            __syncthreads();
+        }
+        if (threadIdx.x == 0) partials[trade * gridDim.x + blockIdx.x] = shared[0];
+        __syncthreads();
+    }
+}
+
+void check(cudaError_t err, const char* what) {
+    if (err != cudaSuccess)
+        throw std::runtime_error(std::string("CudaMonteCarloPricer: ") + what + ": " + cudaGetErrorString(err));
+}
+
+template <class T>
+class DeviceBuffer {
+public:
+    explicit DeviceBuffer(std::size_t n) { check(cudaMalloc(reinterpret_cast<void**>(&p_), n * sizeof(T)), "cudaMalloc"); }
+    ~DeviceBuffer() { cudaFree(p_); }
+    DeviceBuffer(const DeviceBuffer&) = delete;
+    DeviceBuffer& operator=(const DeviceBuffer&) = delete;
+    T* get() const { return p_; }
+
+private:
+    T* p_ = nullptr;
+};
+
+}
+
+bool cuda_available() {
+    int devices = 0;
+    return cudaGetDeviceCount(&devices) == cudaSuccess && devices > 0;
+}
+
+MonteCarloPricer<PhiloxRng, CudaExecutor, IncrementalPath>::MonteCarloPricer(const McConfig& config,
+                                                                             CudaExecutor executor)
+    : config_(config), executor_(executor) {
+    if (config_.greeks) throw std::invalid_argument("CudaMonteCarloPricer: in-pass Greeks are CPU-only");
+    if (config_.target_std_error > 0.0) throw std::invalid_argument("CudaMonteCarloPricer: adaptive mode is CPU-only");
+    if (config_.precision == Precision::Single)
+        throw std::invalid_argument("CudaMonteCarloPricer: Precision::Single is CPU-only");
+    const unsigned t = executor_.threads_per_block;
+    if (t == 0 || (t & (t - 1)) != 0 || t > 1024)
+        throw std::invalid_argument("CudaMonteCarloPricer: threads_per_block must be a power of two <= 1024");
+    if (executor_.blocks_per_trade == 0) throw std::invalid_argument("CudaMonteCarloPricer: blocks_per_trade must be > 0");
+}
+
+McResult MonteCarloPricer<PhiloxRng, CudaExecutor, IncrementalPath>::price(const Option& opt, double rate,
+                                                                           double volatility) const {
+    OptionBatch batch;
+    batch.size = 1;
+    batch.type = &opt.type;
+    batch.strike = &opt.strike;
+    batch.maturity = &opt.maturity;
+    batch.spot = &opt.spot;
+    batch.volatility = &volatility;
+    batch.rate = &rate;
+    McResult r;
+    price(batch, &r);
+    return r;
+}
+
+void MonteCarloPricer<PhiloxRng, CudaExecutor, IncrementalPath>::price(const OptionBatch& batch, McResult* out) const {
+    if (batch.size == 0) return;
+    // Unlike BlackScholes there is no VolatilityModel overload to fall back on
+    if (!batch.volatility || !batch.rate)
+        throw std::invalid_argument("CudaMonteCarloPricer: batch needs volatility and rate columns");
+    const std::size_t n = batch.size;
+    const std::uint64_t steps = std::max<std::size_t>(config_.steps, 1);
+    const bool antithetic = uses_antithetic(config_.variance_reduction);
+    const std::uint64_t draws = antithetic ? (config_.paths + 1) / 2 : config_.paths;
+
+    std::vector<cuda::Trade> trades(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        const double dt = std::max(batch.maturity[i], 0.0) / static_cast<double>(steps);
+        const double vol = batch.volatility[i];
+        trades[i] = {std::log(batch.spot[i]), batch.strike[i], batch.type[i] == OptionType::Call ? 1.0 : -1.0,
+                     (batch.rate[i] - 0.5 * vol * vol) * dt, vol * std::sqrt(dt)};
+    }
+
+    check(cudaSetDevice(executor_.device), "cudaSetDevice");
+    const unsigned blocks = executor_.blocks_per_trade;
+    const unsigned threads = executor_.threads_per_block;
+    DeviceBuffer<cuda::Trade> d_trades(n);
+    DeviceBuffer<Partial> d_partials(n * blocks);
+    check(cudaMemcpy(d_trades.get(), trades.data(), n * sizeof(cuda::Trade), cudaMemcpyHostToDevice), "cudaMemcpy");
+    const dim3 grid(blocks, static_cast<unsigned>(std::min<std::size_t>(n, 65535)));
+    price_kernel<<<grid, threads, threads * sizeof(Partial)>>>(d_trades.get(), n, static_cast<std::uint32_t>(config_.seed),
+                                                               static_cast<std::uint32_t>(config_.seed >> 32), draws,
+                                                               steps, antithetic, d_partials.get());
+    check(cudaGetLastError(), "kernel launch");
+    std::vector<Partial> partials(n * blocks);
+    check(cudaMemcpy(partials.data(), d_partials.get(), partials.size() * sizeof(Partial), cudaMemcpyDeviceToHost),
+          "cudaMemcpy");
+
+    for (std::size_t i = 0; i < n; ++i) {
+        PathStats total;
+        for (unsigned b = 0; b < blocks; ++b) {
+            const Partial& p = partials[i * blocks + b];
+            PathStats s;
+            s.n = p.n;
+            s.mean = p.mean;
+            s.m2 = p.m2;
+            total.merge(s);
+        }
+        const double discount = std::exp(-batch.rate[i] * std::max(batch.maturity[i], 0.0));
+        McResult r;
+        if (uses_control_variate(config_.variance_reduction)) {
+            // The vanilla control is the payoff itself
+            total.mean_c = total.mean;
+            total.m2_c = total.m2;
+            total.c_xc = total.m2;
+            const Option opt(batch.type[i], batch.strike[i], batch.maturity[i], batch.spot[i]);
+            r = total.result(discount, BlackScholes::price(opt, batch.rate[i], batch.volatility[i]) / discount);
+        } else {
+            r = total.result(discount);
+        }
+        if (antithetic) r.paths *= 2;
+        out[i] = r;
+    }
+}
+
+}
@@ -0,0 +1,336 @@
+#include "distributed.h"
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "cpu_features.h"
+#include "rng.h"
+
+namespace aemps {
+
+namespace {
+
+constexpr char kMagic[4] = {'A', 'E', 'M', 'C'};
+constexpr std::uint16_t kVersion = 3;
+constexpr std::uint32_t kByteOrder = 0x01020304;
+constexpr std::uint32_t kMaxFrame = std::uint32_t(1) << 28;
+
+// Rejected: the worker dispatches another kernel ISA than the coordinator
+enum class Kind : std::uint16_t { Task = 1, Result = 2, Error = 3, Rejected = 4 };
+
+struct FrameHeader {
+    char magic[4];
+    std::uint16_t version;
+    std::uint16_t kind;
+    std::uint32_t byte_order;
+    std::uint32_t bytes; // payload that follows
+    // Sender's active_simd_isa(): the ISAs differ in FMA contraction, so
+    // only ranks dispatching the same one produce the same bits
+    std::uint32_t isa;
+    std::uint32_t reserved;
+};
+
+// One contract's block range and everything its McConfig needs
+struct TaskWire {
+    std::uint64_t paths, steps, seed, block_size;
+    std::uint64_t first_block, block_count;
+    double strike, maturity, spot, rate, volatility;
+    std::uint32_t type, variance_reduction, greeks, greek_method;
+    std::uint32_t precision, reserved;
+};
+
+// Followed by block_count PathStats
+struct ResultHead {
+    std::uint64_t first_block, block_count;
+};
+
+static_assert(sizeof(FrameHeader) == 24, "FrameHeader must stay 24 bytes");
+static_assert(sizeof(TaskWire) == 112, "TaskWire must stay 112 bytes");
+static_assert(std::is_trivially_copyable<PathStats>::value && sizeof(PathStats) == 104,
+              "PathStats travels as raw bytes");
+
+// Whole blocks per result frame
+constexpr std::size_t kMaxTaskBlocks = (kMaxFrame - sizeof(ResultHead)) / sizeof(PathStats);
+
+#if defined(MSG_NOSIGNAL)
+constexpr int kSendFlags = MSG_NOSIGNAL; // a dead peer is an error return, not SIGPIPE
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+bool read_all(int fd, void* data, std::size_t bytes) {
+    char* p = static_cast<char*>(data);
+    while (bytes > 0) {
+        const ssize_t n = ::read(fd, p, bytes);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        bytes -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool write_all(int fd, const void* data, std::size_t bytes) {
+    const char* p = static_cast<const char*>(data);
+    while (bytes > 0) {
+        const ssize_t n = ::send(fd, p, bytes, kSendFlags);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        bytes -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool send_frame(int fd, Kind kind, const void* head, std::size_t head_bytes, const void* body, std::size_t body_bytes) {
+    FrameHeader h;
+    std::memcpy(h.magic, kMagic, sizeof kMagic);
+    h.version = kVersion;
+    h.kind = static_cast<std::uint16_t>(kind);
+    h.byte_order = kByteOrder;
+    h.bytes = static_cast<std::uint32_t>(head_bytes + body_bytes);
+    h.isa = static_cast<std::uint32_t>(active_simd_isa());
+    h.reserved = 0;
+    return write_all(fd, &h, sizeof h) && write_all(fd, head, head_bytes) && write_all(fd, body, body_bytes);
+}
+
+// False at end of stream or on a frame from another protocol or build;
+// `isa` is the sender's kernel ISA
+bool recv_frame(int fd, Kind& kind, SimdIsa& isa, std::vector<char>& payload) {
+    FrameHeader h;
+    if (!read_all(fd, &h, sizeof h)) return false;
+    if (std::memcmp(h.magic, kMagic, sizeof kMagic) != 0 || h.version != kVersion || h.byte_order != kByteOrder ||
+        h.bytes > kMaxFrame || h.isa > static_cast<std::uint32_t>(SimdIsa::Avx512))
+        return false;
+    kind = static_cast<Kind>(h.kind);
+    isa = static_cast<SimdIsa>(h.isa);
+    payload.resize(h.bytes);
+    return read_all(fd, payload.data(), payload.size());
+}
+
+int connect_to(const std::string& endpoint) {
+    const std::size_t colon = endpoint.rfind(':');
+    if (colon == std::string::npos) return -1;
+    std::string host = endpoint.substr(0, colon);
+    const std::string port = endpoint.substr(colon + 1);
+    if (host.size() >= 2 && host.front() == '[' && host.back() == ']') host = host.substr(1, host.size() - 2);
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = nullptr;
+    if (::getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0) return -1;
+    int fd = -1;
+    for (addrinfo* a = found; a && fd < 0; a = a->ai_next) {
+        fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd >= 0 && ::connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    ::freeaddrinfo(found);
+    if (fd >= 0) {
+        const int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+    }
+    return fd;
+}
+
+struct Task {
+    std::size_t contract;
+    std::size_t first;
+    std::size_t count;
+};
+
+TaskWire wire_task(const OptionBatch& book, const McConfig& config, const Task& task) {
+    TaskWire t{};
+    t.paths = config.paths;
+    t.steps = config.steps;
+    t.seed = config.seed;
+    t.block_size = config.block_size;
+    t.first_block = task.first;
+    t.block_count = task.count;
+    t.strike = book.strike[task.contract];
+    t.maturity = book.maturity[task.contract];
+    t.spot = book.spot[task.contract];
+    t.rate = book.rate[task.contract];
+    t.volatility = book.volatility[task.contract];
+    t.type = static_cast<std::uint32_t>(book.type[task.contract]);
+    t.variance_reduction = static_cast<std::uint32_t>(config.variance_reduction);
+    t.greeks = config.greeks ? 1 : 0;
+    t.greek_method = static_cast<std::uint32_t>(config.greek_method);
+    t.precision = static_cast<std::uint32_t>(config.precision);
+    return t;
+}
+
+// Tasks dealt to the worker connections and the partials they return
+struct Run {
+    std::mutex m;
+    std::condition_variable cv;
+    std::deque<Task> queue;
+    std::size_t in_flight = 0;
+    std::string error;    // first error reported by a worker
+    std::string rejected; // last worker that turned the run down, and why
+    std::vector<std::vector<PathStats>> partials;
+};
+
+// One coordinator thread per worker. A connection that fails hands its
+// task back, so the others pick it up; a worker's own error stops the run.
+void drive(const std::string& endpoint, const OptionBatch& book, const McConfig& config, Run& run) {
+    const int fd = connect_to(endpoint);
+    if (fd < 0) return;
+    std::vector<char> payload;
+    for (;;) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(run.m);
+            run.cv.wait(lock, [&] { return !run.error.empty() || !run.queue.empty() || run.in_flight == 0; });
+            if (!run.error.empty() || run.queue.empty()) break;
+            task = run.queue.front();
+            run.queue.pop_front();
+            ++run.in_flight;
+        }
+        const TaskWire t = wire_task(book, config, task);
+        Kind kind = Kind::Task;
+        SimdIsa isa;
+        bool ok = send_frame(fd, Kind::Task, &t, sizeof t, nullptr, 0) && recv_frame(fd, kind, isa, payload);
+        std::string error, rejected;
+        if (ok && kind == Kind::Rejected) {
+            rejected.assign(payload.begin(), payload.end());
+            ok = false;
+        } else if (ok && kind == Kind::Error) {
+            error.assign(payload.begin(), payload.end());
+        } else if (ok) {
+            ResultHead head;
+            ok = kind == Kind::Result && payload.size() == sizeof head + task.count * sizeof(PathStats);
+            if (ok) {
+                std::memcpy(&head, payload.data(), sizeof head);
+                ok = head.first_block == task.first && head.block_count == task.count;
+            }
+            if (ok)
+                std::memcpy(&run.partials[task.contract][task.first], payload.data() + sizeof head,
+                            task.count * sizeof(PathStats));
+        }
+        {
+            std::lock_guard<std::mutex> lock(run.m);
+            --run.in_flight;
+            if (!error.empty() && run.error.empty()) run.error = endpoint + ": " + error;
+            if (!rejected.empty()) run.rejected = endpoint + ": " + rejected;
+            if (!ok) run.queue.push_front(task);
+        }
+        run.cv.notify_all();
+        if (!ok || !error.empty()) break;
+    }
+    ::close(fd);
+}
+
+McConfig task_config(const TaskWire& t) {
+    if (t.type > 1 || t.variance_reduction > 3 || t.greek_method > 2 || t.precision > 1 ||
+        t.block_count > kMaxTaskBlocks)
+        throw std::invalid_argument("serve_mc_worker: malformed task");
+    McConfig c;
+    c.paths = t.paths;
+    c.steps = t.steps;
+    c.seed = t.seed;
+    c.block_size = t.block_size;
+    c.variance_reduction = static_cast<VarianceReduction>(t.variance_reduction);
+    c.greeks = t.greeks != 0;
+    c.greek_method = static_cast<GreekMethod>(t.greek_method);
+    c.precision = static_cast<Precision>(t.precision);
+    return c;
+}
+
+}
+
+DistributedMc::DistributedMc(std::vector<std::string> endpoints, std::size_t blocks_per_task)
+    : endpoints_(std::move(endpoints)), blocks_per_task_(blocks_per_task) {
+    if (endpoints_.empty()) throw std::invalid_argument("DistributedMc: no worker endpoints");
+}
+
+McResult DistributedMc::price(const Option& opt, double rate, double volatility, const McConfig& config) const {
+    OptionBatch book;
+    book.size = 1;
+    book.type = &opt.type;
+    book.strike = &opt.strike;
+    book.maturity = &opt.maturity;
+    book.spot = &opt.spot;
+    book.volatility = &volatility;
+    book.rate = &rate;
+    return price(book, config).front();
+}
+
+std::vector<McResult> DistributedMc::price(const OptionBatch& book, const McConfig& config) const {
+    const MonteCarloPricer<PhiloxRng, SerialExecutor> local(config);
+    const std::size_t blocks = local.blocks();
+    std::size_t per_task = blocks_per_task_;
+    if (per_task == 0) {
+        const std::size_t tasks = 4 * endpoints_.size();
+        per_task = (blocks * book.size + tasks - 1) / tasks;
+    }
+    per_task = std::min(std::max<std::size_t>(per_task, 1), kMaxTaskBlocks);
+
+    Run run;
+    run.partials.assign(book.size, std::vector<PathStats>(blocks));
+    for (std::size_t i = 0; i < book.size; ++i)
+        for (std::size_t first = 0; first < blocks; first += per_task)
+            run.queue.push_back({i, first, std::min(per_task, blocks - first)});
+
+    std::vector<std::thread> threads;
+    for (const std::string& endpoint : endpoints_)
+        threads.emplace_back([&, endpoint] { drive(endpoint, book, config, run); });
+    for (std::thread& t : threads) t.join();
+    if (!run.error.empty()) throw std::runtime_error("DistributedMc: worker " + run.error);
+    if (!run.queue.empty() && !run.rejected.empty())
+        throw std::runtime_error("DistributedMc: no compatible worker to finish the run (" + run.rejected +
+                                 "); cap every rank to one ISA with AEMPS_SIMD");
+    if (!run.queue.empty()) throw std::runtime_error("DistributedMc: no worker reachable to finish the run");
+
+    std::vector<McResult> out(book.size);
+    for (std::size_t i = 0; i < book.size; ++i) {
+        const Option opt(book.type[i], book.strike[i], book.maturity[i], book.spot[i]);
+        out[i] = local.combine(opt, book.rate[i], book.volatility[i], run.partials[i]);
+    }
+    return out;
+}
+
+void serve_mc_worker(int fd) {
+    std::vector<char> payload;
+    Kind kind;
+    SimdIsa isa;
+    while (recv_frame(fd, kind, isa, payload)) {
+        TaskWire t;
+        if (kind != Kind::Task || payload.size() != sizeof t) return;
+        if (isa != active_simd_isa()) {
+            const std::string why = std::string("worker kernels are ") + to_string(active_simd_isa()) +
+                                    ", coordinator's " + to_string(isa);
+            send_frame(fd, Kind::Rejected, why.data(), why.size(), nullptr, 0);
+            return;
+        }
+        std::memcpy(&t, payload.data(), sizeof t);
+        bool sent;
+        try {
+            const MonteCarloPricer<PhiloxRng> pricer(task_config(t));
+            const Option opt(static_cast<OptionType>(t.type), t.strike, t.maturity, t.spot);
+            const std::vector<PathStats> partial = pricer.simulate_blocks(
+                opt, t.rate, t.volatility, static_cast<std::size_t>(t.first_block), static_cast<std::size_t>(t.block_count));
+            const ResultHead head{t.first_block, t.block_count};
+            sent = send_frame(fd, Kind::Result, &head, sizeof head, partial.data(), partial.size() * sizeof(PathStats));
+        } catch (const std::exception& e) {
+            sent = send_frame(fd, Kind::Error, e.what(), std::strlen(e.what()), nullptr, 0);
+        }
+        if (!sent) return;
+    }
+}
+
+}
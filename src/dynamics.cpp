@@ -0,0 +1,133 @@
+#include "dynamics.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace aemps {
+
+LocalVolSurface::LocalVolSurface(double max_time, std::size_t time_nodes, double y_min, double y_max,
+                                 std::size_t space_nodes, std::vector<double> vols)
+    : max_time_(max_time), time_nodes_(time_nodes), y_min_(y_min), space_nodes_(space_nodes), vols_(std::move(vols)) {
+    if (time_nodes < 2 || space_nodes < 2) throw std::invalid_argument("LocalVolSurface: need two nodes per axis");
+    if (!(max_time > 0.0) || !(y_max > y_min)) throw std::invalid_argument("LocalVolSurface: empty grid");
+    if (vols_.size() != time_nodes * space_nodes) throw std::invalid_argument("LocalVolSurface: need one vol per node");
+    dt_ = max_time / static_cast<double>(time_nodes - 1);
+    dy_ = (y_max - y_min) / static_cast<double>(space_nodes - 1);
+}
+
+LocalVolSurface LocalVolSurface::from_implied(const VolatilityModel& implied, double spot, double rate,
+                                              double max_time, std::size_t time_nodes, std::size_t space_nodes,
+                                              double width) {
+    if (!(max_time > 0.0) || time_nodes < 2 || space_nodes < 2)
+        throw std::invalid_argument("LocalVolSurface: empty grid");
+    const double forward_T = spot * std::exp(rate * max_time);
+    const double half = width * implied.volatility(forward_T, max_time) * std::sqrt(max_time);
+    const double dt = max_time / static_cast<double>(time_nodes - 1);
+    const double dy = 2.0 * half / static_cast<double>(space_nodes - 1);
+    // Strike differences span two cells, which also smooths over the node
+    // kinks of piecewise-linear surfaces such as GridVolSurface
+    const double hy = 2.0 * dy;
+
+    std::vector<double> vols(time_nodes * space_nodes);
+    for (std::size_t i = 0; i < time_nodes; ++i) {
+        // Dupire is singular at T = 0; the first row uses the nearest
+        // expiry the differences can resolve
+        const double T = std::max(static_cast<double>(i) * dt, 0.5 * dt);
+        const double ht = 0.25 * dt;
+        const double f0 = spot * std::exp(rate * T);
+        const double f_dn = spot * std::exp(rate * (T - ht));
+        const double f_up = spot * std::exp(rate * (T + ht));
+        for (std::size_t j = 0; j < space_nodes; ++j) {
+            const double y = -half + static_cast<double>(j) * dy;
+            const double w = implied.total_variance(f0 * std::exp(y), T);
+            const double w_dn = implied.total_variance(f0 * std::exp(y - hy), T);
+            const double w_up = implied.total_variance(f0 * std::exp(y + hy), T);
+            const double w_T =
+                (implied.total_variance(f_up * std::exp(y), T + ht) - implied.total_variance(f_dn * std::exp(y), T - ht)) /
+                (2.0 * ht);
+            const double w_y = (w_up - w_dn) / (2.0 * hy);
+            const double w_yy = (w_up - 2.0 * w + w_dn) / (hy * hy);
+            const double den = 1.0 - y * w_y / w + 0.25 * (-0.25 - 1.0 / w + y * y / (w * w)) * w_y * w_y + 0.5 * w_yy;
+            double var = w_T / den;
+            if (!(den > 0.0) || !(var == var)) var = w / T;
+            vols[i * space_nodes + j] = std::sqrt(std::min(std::max(var, 1e-8), 25.0));
+        }
+    }
+    return LocalVolSurface(max_time, time_nodes, -half, half, space_nodes, std::move(vols));
+}
+
+double LocalVolSurface::local_vol(double t, double y) const {
+    const double u = std::min(std::max(t / dt_, 0.0), static_cast<double>(time_nodes_ - 1));
+    const double v = std::min(std::max((y - y_min_) / dy_, 0.0), static_cast<double>(space_nodes_ - 1));
+    const std::size_t i = std::min(static_cast<std::size_t>(u), time_nodes_ - 2);
+    const std::size_t j = std::min(static_cast<std::size_t>(v), space_nodes_ - 2);
+    const double a = u - static_cast<double>(i), b = v - static_cast<double>(j);
+    const double* r0 = &vols_[i * space_nodes_ + j];
+    const double* r1 = r0 + space_nodes_;
+    return (1.0 - a) * (r0[0] + b * (r0[1] - r0[0])) + a * (r1[0] + b * (r1[1] - r1[0]));
+}
+
+void LocalVolSurface::slice(double t, double* out) const {
+    const double u = std::min(std::max(t / dt_, 0.0), static_cast<double>(time_nodes_ - 1));
+    const std::size_t i = std::min(static_cast<std::size_t>(u), time_nodes_ - 2);
+    const double a = u - static_cast<double>(i);
+    const double* r0 = &vols_[i * space_nodes_];
+    const double* r1 = r0 + space_nodes_;
+    for (std::size_t j = 0; j < space_nodes_; ++j) out[j] = r0[j] + a * (r1[j] - r0[j]);
+}
+
+LocalVolModel::LocalVolModel(std::shared_ptr<const LocalVolSurface> surface) : surface_(std::move(surface)) {
+    if (!surface_) throw std::invalid_argument("LocalVolModel: null surface");
+}
+
+LocalVolModel::Evolution LocalVolModel::evolution(double spot, double maturity, double rate, std::size_t steps) const {
+    Evolution e;
+    e.steps = std::max<std::size_t>(steps, 1);
+    e.maturity = std::max(maturity, 0.0);
+    const double dt = e.maturity / static_cast<double>(e.steps);
+    const std::size_t nodes = surface_->space_nodes();
+    e.slices_.resize(e.steps * nodes);
+    for (std::size_t s = 0; s < e.steps; ++s) surface_->slice(static_cast<double>(s) * dt, &e.slices_[s * nodes]);
+    e.step_.vol = nullptr;
+    e.step_.nodes = nodes;
+    e.step_.y0 = surface_->y_min();
+    e.step_.inv_dy = 1.0 / surface_->dy();
+    e.step_.shift = 0.0;
+    e.step_.rate_dt = rate * dt;
+    e.step_.dt = dt;
+    e.step_.sqrt_dt = std::sqrt(dt);
+    e.shift_ = std::log(spot);
+    return e;
+}
+
+HestonModel::HestonModel(const HestonParams& params) : params_(params) {
+    const HestonParams& p = params_;
+    if (!(p.v0 >= 0.0) || !(p.kappa > 0.0) || !(p.theta > 0.0) || !(p.xi > 0.0) || !(std::fabs(p.rho) <= 1.0))
+        throw std::invalid_argument("HestonModel: need v0 >= 0, kappa, theta, xi > 0 and |rho| <= 1");
+}
+
+HestonModel::Evolution HestonModel::evolution(double, double maturity, double rate, std::size_t steps) const {
+    const HestonParams& p = params_;
+    Evolution e;
+    e.steps = std::max<std::size_t>(steps, 1);
+    e.maturity = std::max(maturity, 0.0);
+    e.v0_ = p.v0;
+    const double dt = e.maturity / static_cast<double>(e.steps);
+    const double decay = std::exp(-p.kappa * dt);
+    const double one_minus = -std::expm1(-p.kappa * dt);
+    HestonStep& h = e.step_;
+    h.theta = p.theta;
+    h.decay = decay;
+    h.var_v = p.xi * p.xi * decay * one_minus / p.kappa;
+    h.var_c = p.theta * p.xi * p.xi * one_minus * one_minus / (2.0 * p.kappa);
+    h.rate_dt = rate * dt;
+    h.k0 = -p.rho * p.kappa * p.theta * dt / p.xi;
+    const double drift = 0.5 * dt * (p.kappa * p.rho / p.xi - 0.5);
+    h.k1 = drift - p.rho / p.xi;
+    h.k2 = drift + p.rho / p.xi;
+    h.k3 = 0.5 * dt * (1.0 - p.rho * p.rho);
+    h.k4 = h.k3;
+    return e;
+}
+
+}
@@ -0,0 +1,187 @@
+#include "heston.h"
+#include "kernels.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+namespace aemps {
+
+namespace {
+
+using cplx = std::complex<double>;
+
+constexpr double kPi = 3.141592653589793238;
+
+// Bounds on the cosine terms of one strip, evaluated kChunk at a time
+constexpr std::size_t kChunk = 64;
+constexpr std::size_t kMinTerms = 32;
+constexpr std::size_t kMaxTerms = std::size_t(1) << 14;
+
+// E[exp(i u ln(S_T / S_0))] in the "little trap" form of Albrecher et al.,
+// which stays on the principal branch of the log for any maturity. The
+// series runs on the vectorized real-u kernel; this complex-u form is only
+// needed at u = -i s, the moment generating function E[(S_T / S_0)^s].
+cplx characteristic(const HestonParams& p, cplx u, double T, double rate) {
+    const cplx iu = cplx(0.0, 1.0) * u;
+    const double xi2 = p.xi * p.xi;
+    const cplx beta = p.kappa - p.rho * p.xi * iu;
+    const cplx d = std::sqrt(beta * beta + xi2 * (u * u + iu));
+    const cplx g = (beta - d) / (beta + d);
+    const cplx e = std::exp(-d * T);
+    const cplx C = iu * (rate * T) +
+                   (p.kappa * p.theta / xi2) * ((beta - d) * T - 2.0 * std::log((1.0 - g * e) / (1.0 - g)));
+    const cplx D = (beta - d) / xi2 * ((1.0 - e) / (1.0 - g * e));
+    return std::exp(C + D * p.v0);
+}
+
+// Centre c1 and spread sqrt(c2 + sqrt(c4)) of ln(S_T / S_0) from its first,
+// second and fourth cumulants. c1 and c2 are closed form (Fang & Oosterlee,
+// Table 11); c4, which carries the fat tails of large xi and |rho|, is a
+// finite difference of the cumulant generating function, dropped where
+// those moments explode.
+void truncation(const HestonParams& p, double T, double rate, double& centre, double& spread) {
+    const double k = p.kappa, th = p.theta, v0 = p.v0, xi = p.xi, rho = p.rho;
+    const double e1 = std::exp(-k * T), e2 = e1 * e1;
+    const double c1 = rate * T + (1.0 - e1) * (th - v0) / (2.0 * k) - 0.5 * th * T;
+    const double c2 =
+        std::fabs(xi * T * k * e1 * (v0 - th) * (8.0 * k * rho - 4.0 * xi) +
+                  k * rho * xi * (1.0 - e1) * (16.0 * th - 8.0 * v0) +
+                  2.0 * th * k * T * (-4.0 * k * rho * xi + xi * xi + 4.0 * k * k) +
+                  xi * xi * ((th - 2.0 * v0) * e2 + th * (6.0 * e1 - 7.0) + 2.0 * v0) +
+                  8.0 * k * k * (v0 - th) * (1.0 - e1)) /
+        (8.0 * k * k * k);
+    const double sd = std::sqrt(std::max(c2, 1e-12));
+    const double h = 0.1 / sd;
+    auto K = [&](double s) { return std::log(characteristic(p, cplx(0.0, -s), T, rate).real()); };
+    const double c4 = (K(2.0 * h) - 4.0 * K(h) + 6.0 * 0.0 - 4.0 * K(-h) + K(-2.0 * h)) / (h * h * h * h);
+    centre = c1;
+    spread = std::sqrt(c2 + (c4 > 0.0 ? std::sqrt(c4) : 0.0));
+    if (!(spread > 1e-6)) spread = std::max(sd, 1e-6);
+}
+}
+
+HestonAnalytic::HestonAnalytic(const HestonParams& params, double width, double tolerance)
+    : params_(params), width_(width), tolerance_(tolerance) {
+    const HestonParams& p = params_;
+    if (!(p.v0 >= 0.0) || !(p.kappa > 0.0) || !(p.theta > 0.0) || !(p.xi > 0.0) || !(std::fabs(p.rho) <= 1.0))
+        throw std::invalid_argument("HestonAnalytic: need v0 >= 0, kappa, theta, xi > 0 and |rho| <= 1");
+    if (!(width > 0.0) || !(tolerance > 0.0))
+        throw std::invalid_argument("HestonAnalytic: width and tolerance must be positive");
+}
+
+double HestonAnalytic::price(const Option& opt, double rate) const {
+    double out;
+    price_strip(opt.spot, opt.maturity, rate, &opt.type, &opt.strike, 1, &out);
+    return out;
+}
+
+void HestonAnalytic::price_strip(double spot, double maturity, double rate, const OptionType* type,
+                                 const double* strike, std::size_t n, double* prices) const {
+    if (n == 0) return;
+    const double T = maturity > 0.0 ? maturity : 0.0;
+    const double df = std::exp(-rate * T);
+    if (!(T > 0.0)) {
+        for (std::size_t j = 0; j < n; ++j) {
+            const double phi = type[j] == OptionType::Call ? 1.0 : -1.0;
+            prices[j] = std::max(phi * (spot - strike[j] * df), 0.0);
+        }
+        return;
+    }
+
+    // Range of y = ln(S_T / K) covering every strike of the strip
+    double c1, sd;
+    truncation(params_, T, rate, c1, sd);
+    std::vector<double> x(n);
+    double x_lo = 0.0, x_hi = 0.0;
+    for (std::size_t j = 0; j < n; ++j) {
+        x[j] = std::log(spot / strike[j]);
+        x_lo = j ? std::min(x_lo, x[j]) : x[j];
+        x_hi = j ? std::max(x_hi, x[j]) : x[j];
+    }
+    const double a = x_lo + c1 - width_ * sd;
+    const double b = x_hi + c1 + width_ * sd;
+    const double span = b - a;
+
+    // Put payoff coefficients on [a, min(b, 0)] times the characteristic
+    // function, g_k = phi(w_k) U_k halved for k = 0, a chunk of terms at a
+    // time until |phi| has decayed below the tolerance. A strip that is
+    // all deep in-the-money calls has no put payoff on the range at all.
+    const detail::KernelTable& kern = detail::kernels();
+    std::vector<double> re, im;
+    const double top = std::min(b, 0.0);
+    const double e_top = std::exp(top), e_a = std::exp(a);
+    const double turn = kPi * (top - a) / span; // w_k (top - a) = k turn
+    const double cos_turn = std::cos(turn), sin_turn = std::sin(turn);
+    double u[kChunk], cf_re[kChunk], cf_im[kChunk];
+    bool converged = !(top > a);
+    for (std::size_t first = 0; first < kMaxTerms && !converged; first += kChunk) {
+        for (std::size_t j = 0; j < kChunk; ++j) u[j] = static_cast<double>(first + j) * kPi / span;
+        kern.heston_cf(params_, T, rate, u, kChunk, cf_re, cf_im);
+        // cos and sin of k turn by rotation, reseeded once per chunk
+        double cs = std::cos(static_cast<double>(first) * turn), sn = std::sin(static_cast<double>(first) * turn);
+        for (std::size_t j = 0; j < kChunk; ++j) {
+            const std::size_t k = first + j;
+            if (k >= kMinTerms && std::hypot(cf_re[j], cf_im[j]) < tolerance_) {
+                converged = true;
+                break;
+            }
+            const double w = u[j];
+            const double chi = (cs * e_top - e_a + w * sn * e_top) / (1.0 + w * w);
+            const double psi = k ? sn / w : top - a;
+            const double U = (k ? 2.0 : 1.0) / span * (psi - chi);
+            re.push_back(cf_re[j] * U);
+            im.push_back(cf_im[j] * U);
+            const double cs_next = cs * cos_turn - sn * sin_turn;
+            sn = sn * cos_turn + cs * sin_turn;
+            cs = cs_next;
+        }
+    }
+
+    std::vector<double> cos_t(n), sin_t(n), sums(n);
+    for (std::size_t j = 0; j < n; ++j) {
+        const double theta = kPi * (x[j] - a) / span;
+        cos_t[j] = std::cos(theta);
+        sin_t[j] = std::sin(theta);
+    }
+    kern.cos_series(re.data(), im.data(), re.size(), cos_t.data(), sin_t.data(), n, sums.data());
+
+    for (std::size_t j = 0; j < n; ++j) {
+        const double K = strike[j];
+        const double put = std::max(K * df * sums[j], std::max(K * df - spot, 0.0));
+        prices[j] = type[j] == OptionType::Call ? std::max(put + spot - K * df, std::max(spot - K * df, 0.0)) : put;
+    }
+}
+
+void HestonAnalytic::price(const OptionBatch& batch, double* prices) const {
+    const std::size_t n = batch.size;
+    if (n == 0) return;
+    auto group = [&](std::size_t i) { return std::make_tuple(batch.maturity[i], batch.spot[i], batch.rate[i]); };
+    std::vector<std::size_t> order(n);
+    std::iota(order.begin(), order.end(), std::size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t l, std::size_t r) { return group(l) < group(r); });
+
+    std::vector<OptionType> type;
+    std::vector<double> strike, out;
+    for (std::size_t first = 0; first < n;) {
+        std::size_t last = first + 1;
+        while (last < n && group(order[last]) == group(order[first])) ++last;
+        type.clear();
+        strike.clear();
+        for (std::size_t j = first; j < last; ++j) {
+            type.push_back(batch.type[order[j]]);
+            strike.push_back(batch.strike[order[j]]);
+        }
+        out.resize(last - first);
+        const std::size_t i = order[first];
+        price_strip(batch.spot[i], batch.maturity[i], batch.rate[i], type.data(), strike.data(), last - first,
+                    out.data());
+        for (std::size_t j = first; j < last; ++j) prices[order[j]] = out[j - first];
+        first = last;
+    }
+}
+
+}
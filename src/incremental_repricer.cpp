@@ -0,0 +1,203 @@
+#include "incremental_repricer.h"
+#include <stdexcept>
+#include <utility>
+
+namespace aemps {
+
+void IncrementalRepricer::Columns::resize(std::size_t n) {
+    price.resize(n);
+    delta.resize(n);
+    gamma.resize(n);
+    vega.resize(n);
+    theta.resize(n);
+    rho.resize(n);
+}
+
+GreeksOutput IncrementalRepricer::Columns::output() {
+    GreeksOutput out;
+    out.price = price.data();
+    out.delta = delta.data();
+    out.gamma = gamma.data();
+    out.vega = vega.data();
+    out.theta = theta.data();
+    out.rho = rho.data();
+    return out;
+}
+
+std::size_t IncrementalRepricer::add_underlier(double spot, double rate, std::vector<double> strikes,
+                                               std::vector<double> maturities, std::vector<double> vols) {
+    Underlier u;
+    u.spot = spot;
+    u.rate = rate;
+    u.surface = std::make_shared<const GridVolSurface>(std::move(strikes), std::move(maturities), vols);
+    u.node_positions.resize(vols.size());
+    u.vols = std::move(vols);
+    underliers_.push_back(std::move(u));
+    return underliers_.size() - 1;
+}
+
+std::size_t IncrementalRepricer::add_position(std::size_t underlier, OptionType type, double strike,
+                                              double maturity, double quantity) {
+    if (underlier >= underliers_.size()) throw std::out_of_range("IncrementalRepricer: unknown underlier");
+    Underlier& u = underliers_[underlier];
+    const std::uint32_t id = static_cast<std::uint32_t>(book_.size());
+    book_.push_back(Option(type, strike, maturity, u.spot), u.surface->volatility(strike, maturity), u.rate);
+    underlier_of_.push_back(static_cast<std::uint32_t>(underlier));
+    quantity_.push_back(quantity);
+    greeks_.resize(book_.size());
+    stamp_.push_back(0);
+    vol_stamp_.push_back(0);
+
+    u.positions.push_back(id);
+    std::size_t nodes[4];
+    const std::size_t count = u.surface->stencil(strike, maturity, nodes);
+    for (std::size_t i = 0; i < count; ++i) u.node_positions[nodes[i]].push_back(id);
+
+    ++epoch_;
+    dirty_.clear();
+    mark(id, false);
+    revalue();
+    return id;
+}
+
+void IncrementalRepricer::mark(std::uint32_t position, bool revol) {
+    if (stamp_[position] != epoch_) {
+        stamp_[position] = epoch_;
+        dirty_.push_back(position);
+    }
+    if (revol) vol_stamp_[position] = epoch_;
+}
+
+std::size_t IncrementalRepricer::apply(const MarketUpdate* updates, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        const MarketUpdate& m = updates[i];
+        if (m.underlier >= underliers_.size()) throw std::out_of_range("IncrementalRepricer: unknown underlier");
+        if (m.field == MarketUpdate::Field::Vol && m.node >= underliers_[m.underlier].vols.size())
+            throw std::out_of_range("IncrementalRepricer: unknown vol node");
+    }
+
+    ++epoch_;
+    dirty_.clear();
+    resurface_.clear();
+    for (std::size_t i = 0; i < n; ++i) {
+        const MarketUpdate& m = updates[i];
+        Underlier& u = underliers_[m.underlier];
+        switch (m.field) {
+        case MarketUpdate::Field::Spot:
+            u.spot = m.value;
+            for (std::uint32_t p : u.positions) mark(p, false);
+            break;
+        case MarketUpdate::Field::Rate:
+            u.rate = m.value;
+            for (std::uint32_t p : u.positions) mark(p, false);
+            break;
+        case MarketUpdate::Field::Vol:
+            u.vols[m.node] = m.value;
+            if (u.stamp != epoch_) {
+                u.stamp = epoch_;
+                resurface_.push_back(m.underlier);
+            }
+            for (std::uint32_t p : u.node_positions[m.node]) mark(p, true);
+            break;
+        }
+    }
+
+    // One rebuild per moved surface, then fresh vols for the positions
+    // reading a moved node
+    for (std::uint32_t id : resurface_) {
+        Underlier& u = underliers_[id];
+        u.surface = std::make_shared<const GridVolSurface>(u.surface->strikes(), u.surface->maturities(), u.vols);
+    }
+    for (std::uint32_t p : dirty_) {
+        if (vol_stamp_[p] != epoch_) continue;
+        book_.volatility[p] = underliers_[underlier_of_[p]].surface->volatility(book_.strike[p], book_.maturity[p]);
+    }
+    revalue();
+    return dirty_.size();
+}
+
+// Gathers the dirty positions into one batch, prices it, and folds the
+// changes into the cached columns and the per-underlier totals
+void IncrementalRepricer::revalue() {
+    const std::size_t n = dirty_.size();
+    if (n == 0) return;
+    scratch_.type.resize(n);
+    scratch_.strike.resize(n);
+    scratch_.maturity.resize(n);
+    scratch_.spot.resize(n);
+    scratch_.volatility.resize(n);
+    scratch_.rate.resize(n);
+    for (std::size_t j = 0; j < n; ++j) {
+        const std::uint32_t p = dirty_[j];
+        const Underlier& u = underliers_[underlier_of_[p]];
+        book_.spot[p] = u.spot;
+        book_.rate[p] = u.rate;
+        scratch_.type[j] = book_.type[p];
+        scratch_.strike[j] = book_.strike[p];
+        scratch_.maturity[j] = book_.maturity[p];
+        scratch_.spot[j] = u.spot;
+        scratch_.volatility[j] = book_.volatility[p];
+        scratch_.rate[j] = u.rate;
+    }
+    fresh_.resize(n);
+    BlackScholes::greeks(scratch_.view(), fresh_.output());
+
+    for (std::size_t j = 0; j < n; ++j) {
+        const std::uint32_t p = dirty_[j];
+        const double q = quantity_[p];
+        Greeks& t = underliers_[underlier_of_[p]].totals;
+        t.price += q * (fresh_.price[j] - greeks_.price[p]);
+        t.delta += q * (fresh_.delta[j] - greeks_.delta[p]);
+        t.gamma += q * (fresh_.gamma[j] - greeks_.gamma[p]);
+        t.vega += q * (fresh_.vega[j] - greeks_.vega[p]);
+        t.theta += q * (fresh_.theta[j] - greeks_.theta[p]);
+        t.rho += q * (fresh_.rho[j] - greeks_.rho[p]);
+        greeks_.price[p] = fresh_.price[j];
+        greeks_.delta[p] = fresh_.delta[j];
+        greeks_.gamma[p] = fresh_.gamma[j];
+        greeks_.vega[p] = fresh_.vega[j];
+        greeks_.theta[p] = fresh_.theta[j];
+        greeks_.rho[p] = fresh_.rho[j];
+    }
+}
+
+void IncrementalRepricer::reprice_all() {
+    ++epoch_;
+    dirty_.clear();
+    for (std::size_t p = 0; p < book_.size(); ++p) {
+        mark(static_cast<std::uint32_t>(p), false);
+        book_.volatility[p] = underliers_[underlier_of_[p]].surface->volatility(book_.strike[p], book_.maturity[p]);
+    }
+    revalue();
+
+    // Running totals accumulate rounding; start them afresh
+    for (Underlier& u : underliers_) u.totals = Greeks{};
+    for (std::size_t p = 0; p < book_.size(); ++p) {
+        const double q = quantity_[p];
+        Greeks& t = underliers_[underlier_of_[p]].totals;
+        t.price += q * greeks_.price[p];
+        t.delta += q * greeks_.delta[p];
+        t.gamma += q * greeks_.gamma[p];
+        t.vega += q * greeks_.vega[p];
+        t.theta += q * greeks_.theta[p];
+        t.rho += q * greeks_.rho[p];
+    }
+}
+
+Greeks IncrementalRepricer::position(std::size_t i) const {
+    if (i >= book_.size()) throw std::out_of_range("IncrementalRepricer: unknown position");
+    return Greeks{greeks_.price[i], greeks_.delta[i], greeks_.gamma[i],
+                  greeks_.vega[i], greeks_.theta[i], greeks_.rho[i]};
+}
+
+const Greeks& IncrementalRepricer::totals(std::size_t underlier) const {
+    if (underlier >= underliers_.size()) throw std::out_of_range("IncrementalRepricer: unknown underlier");
+    return underliers_[underlier].totals;
+}
+
+const GridVolSurface& IncrementalRepricer::surface(std::size_t underlier) const {
+    if (underlier >= underliers_.size()) throw std::out_of_range("IncrementalRepricer: unknown underlier");
+    return *underliers_[underlier].surface;
+}
+
+}
@@ -0,0 +1,171 @@
+#include "instrumentation.h"
+#include <cstdarg>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+namespace aemps {
+
+namespace {
+
+constexpr const char* kStageNames[kStageCount] = {"rng", "path_evolution", "payoff", "reduction"};
+constexpr const char* kCounterNames[kCounterCount] = {"paths_simulated", "cache_hits",         "cache_misses",
+                                                      "allocations",     "arena_chunks",       "result_cache_hits",
+                                                      "result_cache_misses"};
+constexpr const char* kCounterHelp[kCounterCount] = {
+    "Monte Carlo paths simulated, antithetic pairs counting twice.",
+    "Vol prediction cache lookups that hit.",
+    "Vol prediction cache lookups that missed.",
+    "Aligned heap allocations, including arena chunks.",
+    "Arena chunks allocated.",
+    "Result cache lookups that hit.",
+    "Result cache lookups that missed."};
+
+double hit_rate(std::uint64_t hits, std::uint64_t misses) {
+    return hits + misses ? static_cast<double>(hits) / static_cast<double>(hits + misses) : 0.0;
+}
+
+#if AEMPS_INSTRUMENTATION
+using detail::ThreadCounters;
+
+// Live threads' counters plus the totals of those that have exited.
+// Leaked, so threads that outlive static destruction can still report.
+struct Registry {
+    std::mutex m;
+    std::vector<const ThreadCounters*> live;
+    InstrumentationSnapshot retired;
+};
+
+Registry& registry() {
+    static Registry* r = new Registry;
+    return *r;
+}
+
+void add(InstrumentationSnapshot& to, const ThreadCounters& from) {
+    for (std::size_t s = 0; s < kStageCount; ++s) {
+        to.stage_ns[s] += from.stage_ns[s].load(std::memory_order_relaxed);
+        to.stage_calls[s] += from.stage_calls[s].load(std::memory_order_relaxed);
+    }
+    for (std::size_t c = 0; c < kCounterCount; ++c) to.counters[c] += from.counters[c].load(std::memory_order_relaxed);
+}
+
+// Trivially destructible, so recording stays safe during thread teardown;
+// anything recorded after the registration has folded it in is dropped
+thread_local ThreadCounters tls_counters;
+
+struct Registration {
+    Registration() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.m);
+        r.live.push_back(&tls_counters);
+    }
+    ~Registration() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.m);
+        add(r.retired, tls_counters);
+        ++r.retired.threads;
+        for (std::size_t i = 0; i < r.live.size(); ++i) {
+            if (r.live[i] == &tls_counters) {
+                r.live[i] = r.live.back();
+                r.live.pop_back();
+                break;
+            }
+        }
+    }
+};
+#endif
+
+void metric(std::string& out, const char* name, const char* type, const char* help) {
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+void sample(std::string& out, const char* name, const char* label, const char* format, ...) {
+    char buf[64];
+    va_list args;
+    va_start(args, format);
+    std::vsnprintf(buf, sizeof buf, format, args);
+    va_end(args);
+    out += name;
+    if (label) out += label;
+    out += ' ';
+    out += buf;
+    out += '\n';
+}
+
+}
+
+#if AEMPS_INSTRUMENTATION
+namespace detail {
+
+ThreadCounters& thread_counters() {
+    thread_local Registration registration;
+    return tls_counters;
+}
+
+}
+#endif
+
+const char* to_string(Stage stage) {
+    return kStageNames[static_cast<std::size_t>(stage)];
+}
+
+const char* to_string(Counter counter) {
+    return kCounterNames[static_cast<std::size_t>(counter)];
+}
+
+double InstrumentationSnapshot::cache_hit_rate() const {
+    return hit_rate((*this)[Counter::CacheHits], (*this)[Counter::CacheMisses]);
+}
+
+double InstrumentationSnapshot::result_cache_hit_rate() const {
+    return hit_rate((*this)[Counter::ResultCacheHits], (*this)[Counter::ResultCacheMisses]);
+}
+
+InstrumentationSnapshot instrumentation_snapshot() {
+    InstrumentationSnapshot s;
+#if AEMPS_INSTRUMENTATION
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.m);
+    s = r.retired;
+    for (const ThreadCounters* t : r.live) add(s, *t);
+    s.threads += r.live.size();
+#endif
+    return s;
+}
+
+std::string to_prometheus(const InstrumentationSnapshot& s) {
+    std::string out;
+    std::string label;
+    metric(out, "aemps_stage_seconds_total", "counter", "Time spent in each Monte Carlo engine stage.");
+    for (std::size_t i = 0; i < kStageCount; ++i) {
+        label = std::string("{stage=\"") + kStageNames[i] + "\"}";
+        sample(out, "aemps_stage_seconds_total", label.c_str(), "%.9f", 1e-9 * static_cast<double>(s.stage_ns[i]));
+    }
+    metric(out, "aemps_stage_calls_total", "counter", "Timed sections per Monte Carlo engine stage.");
+    for (std::size_t i = 0; i < kStageCount; ++i) {
+        label = std::string("{stage=\"") + kStageNames[i] + "\"}";
+        sample(out, "aemps_stage_calls_total", label.c_str(), "%llu", static_cast<unsigned long long>(s.stage_calls[i]));
+    }
+    for (std::size_t i = 0; i < kCounterCount; ++i) {
+        const std::string name = std::string("aemps_") + kCounterNames[i] + "_total";
+        metric(out, name.c_str(), "counter", kCounterHelp[i]);
+        sample(out, name.c_str(), nullptr, "%llu", static_cast<unsigned long long>(s.counters[i]));
+    }
+    metric(out, "aemps_cache_hit_ratio", "gauge", "Vol prediction cache hits over lookups.");
+    sample(out, "aemps_cache_hit_ratio", nullptr, "%.6f", s.cache_hit_rate());
+    metric(out, "aemps_result_cache_hit_ratio", "gauge", "Result cache hits over lookups.");
+    sample(out, "aemps_result_cache_hit_ratio", nullptr, "%.6f", s.result_cache_hit_rate());
+    metric(out, "aemps_instrumented_threads", "gauge", "Threads that have recorded instrumentation.");
+    sample(out, "aemps_instrumented_threads", nullptr, "%zu", s.threads);
+    return out;
+}
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+// Private dispatch table for the vectorized kernels. One table is compiled
+// per ISA (kernels_*.cpp, all generated from kernels_impl.h) and kernels()
+// returns the widest one the running CPU supports.
+#include "cpu_features.h"
+#include <cstddef>
+#include <cstdint>
+#include "black_scholes.h"
+#include "heston.h"
+#include "path_kernels.h"
+
+namespace aemps {
+namespace detail {
+
+struct KernelTable {
+    SimdIsa isa;
+    int width; // doubles per vector
+    void (*bs_price)(const OptionBatch& batch, double* prices);
+    void (*bs_price_f32)(const OptionBatch& batch, double* prices); // Precision::Single
+    void (*bs_greeks)(const OptionBatch& batch, const GreeksOutput& out);
+    void (*bs_scenarios)(const OptionBatch& batch, const double* spot_scale, const double* log_spot_scale,
+                         const double* vol_shift, const double* rate_shift, std::size_t scenarios, double* prices);
+    void (*implied_vol)(const OptionBatch& batch, const double* prices, double* vols);
+    void (*philox_normals)(std::uint32_t k0, std::uint32_t k1, std::uint64_t first_path, std::size_t count,
+                           std::uint64_t step, double* out);
+    void (*philox_normals_f32)(std::uint32_t k0, std::uint32_t k1, std::uint64_t first_path, std::size_t count,
+                               std::uint64_t step, double* out);
+    void (*norm_inv_array)(const double* u, double* out, std::size_t n);
+    void (*gbm_advance)(double* x, const double* z, std::size_t n, double drift, double diffusion);
+    void (*exp_array)(const double* x, double* out, std::size_t n);
+    void (*local_vol_advance)(double* x, const double* z, std::size_t n, const LocalVolStep& step);
+    void (*heston_qe_advance)(double* x, double* v, const double* zv, const double* zx, std::size_t n,
+                              const HestonStep& step);
+    void (*heston_cf)(const HestonParams& p, double maturity, double rate, const double* u, std::size_t n,
+                      double* re, double* im);
+    void (*cos_series)(const double* re, const double* im, std::size_t terms, const double* cos_theta,
+                       const double* sin_theta, std::size_t n, double* out);
+};
+
+const KernelTable& kernels();
+
+namespace portable { extern const KernelTable kernel_table; }
+#if defined(AEMPS_HAVE_X86_KERNELS)
+namespace avx2 { extern const KernelTable kernel_table; }
+namespace avx512 { extern const KernelTable kernel_table; }
+#endif
+
+}
+}
@@ -0,0 +1,5 @@
+// AVX2 + FMA kernels, built with -mavx2 -mfma
+#define AEMPS_SIMD_NS avx2
+#define AEMPS_SIMD_WIDTH 4
+#define AEMPS_SIMD_ISA SimdIsa::Avx2
+#include "kernels_impl.h"
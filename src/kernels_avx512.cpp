@@ -0,0 +1,5 @@
+// AVX-512 kernels, built with -mavx512f -mavx512dq
+#define AEMPS_SIMD_NS avx512
+#define AEMPS_SIMD_WIDTH 8
+#define AEMPS_SIMD_ISA SimdIsa::Avx512
+#include "kernels_impl.h"
@@ -0,0 +1,748 @@
+#pragma once
+// Kernel bodies, instantiated once per ISA; see simd_math.h for the rules
+// that keep the per-TU instantiations apart.
+#include "kernels.h"
+#include "simd_math.h"
+
+namespace aemps {
+namespace detail {
+namespace AEMPS_SIMD_NS {
+
+AEMPS_SIMD_INLINE vd load_sign(const OptionType* type, std::size_t n) {
+    vd phi = splat(1.0);
+    for (std::size_t j = 0; j < n; ++j) phi[j] = type[j] == OptionType::Call ? 1.0 : -1.0;
+    return phi;
+}
+
+// phi * (S N(phi d1) - K exp(-rT) N(phi d2)), discounted intrinsic value
+// when the total volatility is zero
+AEMPS_SIMD_INLINE vd bs_price_lanes(vd phi, vd S, vd K, vd T, vd vol, vd r) {
+    const vd t = vmax(T, splat(0.0));
+    const vd df = vexp(-r * t);
+    const vd sd = vol * vsqrt(t);
+    const vi live = sd > 0.0;
+    const vd sd_safe = live ? sd : splat(1.0);
+    const vd fwd_strike = K * df;
+    const vd d1 = (vlog(S / K) + r * t) / sd_safe + 0.5 * sd_safe;
+    const vd d2 = d1 - sd_safe;
+    const vd price = phi * (S * vnorm_cdf(phi * d1) - fwd_strike * vnorm_cdf(phi * d2));
+    const vd intrinsic = vmax(phi * (S - fwd_strike), splat(0.0));
+    return live ? price : intrinsic;
+}
+
+void bs_price(const OptionBatch& b, double* prices) {
+    const std::size_t n = b.size;
+    std::size_t i = 0;
+    for (; i + W <= n; i += W) {
+        const vd v = bs_price_lanes(load_sign(b.type + i, W), load(b.spot + i), load(b.strike + i),
+                                    load(b.maturity + i), load(b.volatility + i), load(b.rate + i));
+        store(prices + i, v);
+    }
+    if (i < n) {
+        const std::size_t m = n - i;
+        const vd v = bs_price_lanes(load_sign(b.type + i, m), load_n(b.spot + i, m, 1.0),
+                                    load_n(b.strike + i, m, 1.0), load_n(b.maturity + i, m, 1.0),
+                                    load_n(b.volatility + i, m, 1.0), load_n(b.rate + i, m, 0.0));
+        store_n(prices + i, v, m);
+    }
+}
+
+AEMPS_SIMD_INLINE vf load_sign_f(const OptionType* type, std::size_t n) {
+    vf phi = splat_f(1.0f);
+    for (std::size_t j = 0; j < n; ++j) phi[j] = type[j] == OptionType::Call ? 1.0f : -1.0f;
+    return phi;
+}
+
+// Out of the money the float price is the difference of two terms and
+// carries a few ulp of their size; below this fraction of it, or near the
+// bottom of the float range, it misses 1e-6 relative and bs_price_f32
+// prices the lane again in double
+constexpr float kSingleMinRatio = 0.4f;
+constexpr float kSingleMinPrice = 1e-30f;
+
+// S - K in double, then narrowed: near the money the difference keeps
+// the digits a float subtraction would cancel
+AEMPS_SIMD_INLINE vf load_gap_f(const double* S, const double* K) {
+    vdw s, k;
+    __builtin_memcpy(&s, S, sizeof s);
+    __builtin_memcpy(&k, K, sizeof k);
+    return __builtin_convertvector(s - k, vf);
+}
+
+AEMPS_SIMD_INLINE vf load_gap_f_n(const double* S, const double* K, std::size_t n) {
+    vf v = splat_f(0.0f);
+    for (std::size_t j = 0; j < n; ++j) v[j] = static_cast<float>(S[j] - K[j]);
+    return v;
+}
+
+// bs_price_lanes in single precision, rearranged so that nothing cancels
+// in or near the money: the price is phi (S - K df) N(phi d2) plus the
+// time value S (N(d1) - N(d2)). S - K df is built from the double S - K
+// (`gap`) and a series for 1 - df. The CDF difference is taken on the side
+// of the smaller tails, or, where that would cancel (d1 and d2 close and
+// near the middle), is the Taylor series of the integral of the density
+// over [d2, d1] about its midpoint. `coarse` flags the live lanes left to
+// the caller: out of the money, where the two terms of the price have
+// opposite signs, and prices near the bottom of the float range.
+AEMPS_SIMD_INLINE vf bs_price_lanes(vf phi, vf S, vf K, vf gap, vf T, vf vol, vf r, vfi& coarse) {
+    const vf t = vmax(T, splat_f(0.0f));
+    const vf rt = r * t;
+    vf one_minus_df = rt * (1.0f - rt * (0.5f - rt * (1.0f / 6 - rt * (1.0f / 24 - rt * (1.0f / 120 - rt / 720)))));
+    const vfi long_rate = vabs(rt) >= 0.25f;
+    if (any(long_rate)) one_minus_df = long_rate ? 1.0f - vexpf(-rt) : one_minus_df;
+    const vf carry = K * one_minus_df;
+    const vf moneyness = phi * (gap + carry);
+    const vf sd = vol * vsqrt(t);
+    const vfi live = sd > 0.0f;
+    const vf sd_safe = live ? sd : splat_f(1.0f);
+    const vf h = 0.5f * sd_safe;
+    const vf d1 = (vlogf(S / K) + rt) / sd_safe + h;
+    const vf d2 = d1 - sd_safe;
+    const vf m = d1 - h;
+
+    const vf side = m < 0.0f ? splat_f(1.0f) : splat_f(-1.0f);
+    const vf c2 = vnorm_cdf(side * d2);
+    const vf n2 = phi == side ? c2 : 1.0f - c2;
+    vf spread = side * (vnorm_cdf(side * d1) - c2);
+    const vfi narrow = (h <= 0.5f) & (vabs(m) * h <= 1.0f);
+    if (any(narrow)) {
+        // 2 h phi(m) sum_k He_2k(m) h^2k / (2k + 1)! to k = 5, the Hermite
+        // polynomials by He_n+1 = m He_n - n He_n-1
+        const vf h2 = h * h;
+        vf he_even = splat_f(1.0f), he_odd = m, term = splat_f(1.0f), sum = splat_f(1.0f);
+        for (int k = 1; k <= 5; ++k) {
+            he_even = m * he_odd - float(2 * k - 1) * he_even;
+            he_odd = m * he_even - float(2 * k) * he_odd;
+            term = term * h2 * (1.0f / float(2 * k * (2 * k + 1)));
+            sum = sum + he_even * term;
+        }
+        const vf taylor = sd_safe * 0.398942280f * vexpf(-0.5f * m * m) * sum;
+        spread = narrow ? taylor : spread;
+    }
+
+    const vf time_value = S * spread;
+    const vf price = time_value + moneyness * n2;
+    const vf scale = time_value + (vabs(gap) + vabs(carry)) * n2;
+    coarse = live & ((price <= kSingleMinRatio * scale) | (price <= kSingleMinPrice));
+    return live ? price : vmax(moneyness, splat_f(0.0f));
+}
+
+// Contracts queued for the double kernel, priced in batches so the
+// fallback runs at full vector width
+class DoubleFallback {
+public:
+    explicit DoubleFallback(double* prices) : prices_(prices) {}
+    ~DoubleFallback() { flush(); }
+
+    void add(const OptionBatch& b, std::size_t first, std::size_t count, vfi redo) {
+        for (std::size_t j = 0; j < count; ++j) {
+            if (!redo[j]) continue;
+            const std::size_t k = first + j;
+            index_[n_] = k;
+            type_[n_] = b.type[k];
+            strike_[n_] = b.strike[k];
+            maturity_[n_] = b.maturity[k];
+            spot_[n_] = b.spot[k];
+            vol_[n_] = b.volatility[k];
+            rate_[n_] = b.rate[k];
+            if (++n_ == kSize) flush();
+        }
+    }
+
+    void flush() {
+        if (n_ == 0) return;
+        bs_price(OptionBatch{n_, type_, strike_, maturity_, spot_, vol_, rate_}, out_);
+        for (std::size_t j = 0; j < n_; ++j) prices_[index_[j]] = out_[j];
+        n_ = 0;
+    }
+
+private:
+    static constexpr std::size_t kSize = 256;
+    double* prices_;
+    std::size_t n_ = 0;
+    std::size_t index_[kSize];
+    OptionType type_[kSize];
+    double strike_[kSize], maturity_[kSize], spot_[kSize], vol_[kSize], rate_[kSize], out_[kSize];
+};
+
+void bs_price_f32(const OptionBatch& b, double* prices) {
+    const std::size_t n = b.size;
+    std::size_t i = 0;
+    DoubleFallback fallback(prices);
+    vfi redo;
+    for (; i + WF <= n; i += WF) {
+        const vf v = bs_price_lanes(load_sign_f(b.type + i, WF), load_f(b.spot + i), load_f(b.strike + i),
+                                    load_gap_f(b.spot + i, b.strike + i), load_f(b.maturity + i),
+                                    load_f(b.volatility + i), load_f(b.rate + i), redo);
+        store_f(prices + i, v);
+        if (any(redo)) fallback.add(b, i, WF, redo);
+    }
+    if (i < n) {
+        const std::size_t m = n - i;
+        const vf v = bs_price_lanes(load_sign_f(b.type + i, m), load_f_n(b.spot + i, m, 1.0f),
+                                    load_f_n(b.strike + i, m, 1.0f), load_gap_f_n(b.spot + i, b.strike + i, m),
+                                    load_f_n(b.maturity + i, m, 1.0f), load_f_n(b.volatility + i, m, 1.0f),
+                                    load_f_n(b.rate + i, m, 0.0f), redo);
+        store_f_n(prices + i, v, m);
+        if (any(redo)) fallback.add(b, i, m, redo);
+    }
+}
+
+// Scenario lanes of one contract: spot scaled by `scale` (log_scale its
+// log), vol and rate shifted. The contract's log-moneyness, maturity and
+// sqrt(T) are the same in every lane, so only the discount, d1, d2 and the
+// normal CDFs are evaluated per scenario.
+AEMPS_SIMD_INLINE vd bs_scenario_lanes(double phi, double S, double K, double t, double sqrt_t, double log_moneyness,
+                                       double vol, double r, vd scale, vd log_scale, vd vol_shift, vd rate_shift) {
+    const vd rs = r + rate_shift;
+    const vd df = vexp(-rs * t);
+    const vd sd = vmax(vol + vol_shift, splat(0.0)) * sqrt_t;
+    const vi live = sd > 0.0;
+    const vd sd_safe = live ? sd : splat(1.0);
+    const vd spot = S * scale;
+    const vd fwd_strike = K * df;
+    const vd d1 = (log_moneyness + log_scale + rs * t) / sd_safe + 0.5 * sd_safe;
+    const vd d2 = d1 - sd_safe;
+    const vd price = phi * (spot * vnorm_cdf(phi * d1) - fwd_strike * vnorm_cdf(phi * d2));
+    const vd intrinsic = vmax(phi * (spot - fwd_strike), splat(0.0));
+    return live ? price : intrinsic;
+}
+
+void bs_scenarios(const OptionBatch& b, const double* scale, const double* log_scale, const double* vol_shift,
+                  const double* rate_shift, std::size_t m, double* prices) {
+    for (std::size_t i0 = 0; i0 < b.size; i0 += W) {
+        // Per-contract invariants, one vector of contracts at a time
+        const std::size_t k = b.size - i0 < static_cast<std::size_t>(W) ? b.size - i0 : W;
+        const vd t = vmax(load_n(b.maturity + i0, k, 1.0), splat(0.0));
+        const vd sqrt_t = vsqrt(t);
+        const vd log_moneyness = vlog(load_n(b.spot + i0, k, 1.0) / load_n(b.strike + i0, k, 1.0));
+        for (std::size_t j = 0; j < k; ++j) {
+            const std::size_t i = i0 + j;
+            const double phi = b.type[i] == OptionType::Call ? 1.0 : -1.0;
+            const auto lanes = [&](vd sc, vd lsc, vd dv, vd dr) {
+                return bs_scenario_lanes(phi, b.spot[i], b.strike[i], t[j], sqrt_t[j], log_moneyness[j],
+                                         b.volatility[i], b.rate[i], sc, lsc, dv, dr);
+            };
+            double* row = prices + i * m;
+            std::size_t s = 0;
+            for (; s + W <= m; s += W)
+                store(row + s, lanes(load(scale + s), load(log_scale + s), load(vol_shift + s), load(rate_shift + s)));
+            if (s < m) {
+                const std::size_t n = m - s;
+                store_n(row + s,
+                        lanes(load_n(scale + s, n, 1.0), load_n(log_scale + s, n, 0.0), load_n(vol_shift + s, n, 0.0),
+                              load_n(rate_shift + s, n, 0.0)),
+                        n);
+            }
+        }
+    }
+}
+
+struct GreeksLanes {
+    vd price, delta, gamma, vega, theta, rho;
+};
+
+// Shares d1/d2, N(phi d1), N(phi d2), n(d1) and the discount factor across
+// all outputs; terms only some columns need are skipped when those are null
+AEMPS_SIMD_INLINE GreeksLanes bs_greeks_lanes(const GreeksOutput& want, vd phi, vd S, vd K, vd T, vd vol,
+                                              vd r) {
+    const vd zero = splat(0.0);
+    const vd t = vmax(T, zero);
+    const vd df = vexp(-r * t);
+    const vd sqrt_t = vsqrt(t);
+    const vd sd = vol * sqrt_t;
+    const vi live = sd > 0.0;
+    const vd sd_safe = live ? sd : splat(1.0);
+    const vd t_safe = live ? t : splat(1.0);
+    const vd fwd_strike = K * df;
+    const vd d1 = (vlog(S / K) + r * t) / sd_safe + 0.5 * sd_safe;
+    const vd d2 = d1 - sd_safe;
+    const vi itm = phi * (S - fwd_strike) > 0.0;
+
+    GreeksLanes g;
+    vd gauss1 = zero;
+    const vd n1 = vnorm_cdf(phi * d1, &gauss1);
+    const vd pdf1 = gauss1 * 0.398942280401432677939946059934;
+    const bool need_n2 = want.price || want.theta || want.rho;
+    const vd n2 = need_n2 ? vnorm_cdf(phi * d2) : zero;
+    const vd vega = S * pdf1 * sqrt_t;
+    if (want.price) g.price = live ? phi * (S * n1 - fwd_strike * n2) : (itm ? phi * (S - fwd_strike) : zero);
+    if (want.delta) g.delta = live ? phi * n1 : (itm ? phi : zero);
+    if (want.gamma) g.gamma = live ? pdf1 / (S * sd_safe) : zero;
+    if (want.vega) g.vega = live ? vega : zero;
+    if (want.theta) {
+        const vd carry = -phi * r * fwd_strike;
+        g.theta = live ? -vega * vol / (2.0 * t_safe) + carry * n2 : (itm ? carry : zero);
+    }
+    if (want.rho) {
+        const vd rho = phi * t * fwd_strike;
+        g.rho = live ? rho * n2 : (itm ? rho : zero);
+    }
+    return g;
+}
+
+AEMPS_SIMD_INLINE void store_greeks(const GreeksOutput& out, std::size_t i, const GreeksLanes& g, std::size_t m) {
+    if (m == static_cast<std::size_t>(W)) {
+        if (out.price) store(out.price + i, g.price);
+        if (out.delta) store(out.delta + i, g.delta);
+        if (out.gamma) store(out.gamma + i, g.gamma);
+        if (out.vega) store(out.vega + i, g.vega);
+        if (out.theta) store(out.theta + i, g.theta);
+        if (out.rho) store(out.rho + i, g.rho);
+        return;
+    }
+    if (out.price) store_n(out.price + i, g.price, m);
+    if (out.delta) store_n(out.delta + i, g.delta, m);
+    if (out.gamma) store_n(out.gamma + i, g.gamma, m);
+    if (out.vega) store_n(out.vega + i, g.vega, m);
+    if (out.theta) store_n(out.theta + i, g.theta, m);
+    if (out.rho) store_n(out.rho + i, g.rho, m);
+}
+
+void bs_greeks(const OptionBatch& b, const GreeksOutput& out) {
+    const std::size_t n = b.size;
+    std::size_t i = 0;
+    for (; i + W <= n; i += W) {
+        const GreeksLanes g = bs_greeks_lanes(out, load_sign(b.type + i, W), load(b.spot + i), load(b.strike + i),
+                                              load(b.maturity + i), load(b.volatility + i), load(b.rate + i));
+        store_greeks(out, i, g, W);
+    }
+    if (i < n) {
+        const std::size_t m = n - i;
+        const GreeksLanes g = bs_greeks_lanes(out, load_sign(b.type + i, m), load_n(b.spot + i, m, 1.0),
+                                              load_n(b.strike + i, m, 1.0), load_n(b.maturity + i, m, 1.0),
+                                              load_n(b.volatility + i, m, 1.0), load_n(b.rate + i, m, 0.0));
+        store_greeks(out, i, g, m);
+    }
+}
+
+// Normalised Black call b(x, s) = e^{x/2} N(x/s + s/2) - e^{-x/2} N(x/s - s/2)
+// for x <= 0 (out of the money) and total volatility s > 0
+AEMPS_SIMD_INLINE vd normalised_call(vd x, vd s, vd e, vd ei) {
+    const vd d1 = x / s + 0.5 * s;
+    return e * vnorm_cdf(d1) - ei * vnorm_cdf(d1 - s);
+}
+
+// db/ds = e^{x/2} n(d1)
+AEMPS_SIMD_INLINE vd normalised_vega(vd x, vd s) {
+    return 0.398942280401432677939946059934 * vexp(-0.5 * (x * x / (s * s) + 0.25 * s * s));
+}
+
+// Inverse of the lower-tail map f(s) = 2 pi |x| / (3 sqrt 3) N(-|x| / (sqrt 3 s))^3,
+// which matches b(x, s) asymptotically as s -> 0
+AEMPS_SIMD_INLINE vd lower_map_inverse(vd ax, vd f) {
+    const vd p = vexp(vlog(f * (5.196152422706631880 / 6.283185307179586477) / ax) * (1.0 / 3.0));
+    return ax / (-1.732050807568877294 * vnorm_inv(p));
+}
+
+// Implied total volatility s of an out-of-the-money normalised price
+// beta in (0, e^{x/2}), x <= 0, after Jaeckel ("Let's be rational", 2015):
+// the point of inflection s_c = sqrt(2|x|) and the tangent intercepts s_l,
+// s_u split the price axis into four branches, each with its own initial
+// guess and objective (1/ln b, b, b, ln(b_max - b)) on which third-order
+// Householder steps converge in a fixed four iterations to ~1e-13,
+// safeguarded by the branch bracket.
+AEMPS_SIMD_INLINE vd normalised_implied_vol(vd x, vd beta) {
+    const vd zero = splat(0.0);
+    const vd ax = vabs(x);
+    const vd ax_safe = vmax(ax, splat(1e-300));
+    const vd e = vexp(0.5 * x); // b_max
+    const vd ei = 1.0 / e;
+    const vd sc = vmax(vsqrt(2.0 * ax), splat(1e-10));
+    const vd bc = normalised_call(x, sc, e, ei);
+    const vd vc = normalised_vega(x, sc);
+    const vd sl = sc - bc / vc;
+    const vd su = sc + (e - bc) / vc;
+    const vi has_l = sl > 0.0;
+    const vd sl_safe = has_l ? sl : sc;
+    const vd bl = has_l ? normalised_call(x, sl_safe, e, ei) : zero;
+    const vd bu = normalised_call(x, su, e, ei);
+
+    const vi lowest = beta < bl;
+    const vi highest = beta > bu;
+    const vi lower = ~lowest & (beta < bc);
+    const vd beta_safe = vmax(beta, splat(1e-300));
+    const vd ln_beta = vlog(beta_safe);
+    const vd ln_upper = vlog(vmax(e - beta, splat(1e-300)));
+
+    // Initial guesses: the lower map pinned to b_l, linear interpolation on
+    // the two middle branches, the upper map N(-s/2) scaled to b_max - b_u
+    vd s = sc + (su - sc) * (beta - bc) / (bu - bc);
+    s = lower ? sl_safe + (sc - sl_safe) * (beta - bl) / (bc - bl) : s;
+    if (any(lowest)) {
+        const vd r_l = vnorm_cdf(-ax / (1.732050807568877294 * sl_safe));
+        const vd f_l = (6.283185307179586477 / 5.196152422706631880) * ax * r_l * r_l * r_l;
+        const vd bl_safe = lowest ? bl : splat(1.0);
+        const vd w = vlog(bl_safe) / (lowest ? ln_beta : splat(-1.0));
+        const vd f = beta_safe * vexp(w * vlog((lowest ? f_l : splat(1.0)) / bl_safe));
+        s = lowest ? lower_map_inverse(ax_safe, lowest ? f : splat(0.5)) : s;
+    }
+    if (any(highest)) {
+        const vd f_u = vnorm_cdf(-0.5 * su) * (e - beta) / (e - bu);
+        s = highest ? -2.0 * vnorm_inv(highest ? f_u : splat(0.5)) : s;
+    }
+    const vd lo = lowest ? zero : (lower ? vmax(sl, zero) : (highest ? su : sc));
+    const vd hi = lowest ? sl_safe : (lower ? sc : (highest ? splat(__builtin_inf()) : su));
+    // Roots can sit on a branch edge, so only a zero lower bound is nudged
+    s = s > lo ? s : (lo > 0.0 ? lo : 1e-3 * hi);
+    s = highest ? s : vmin(s, hi);
+
+    for (int it = 0; it < 4; ++it) {
+        const vd xs = x / s;
+        const vd d1 = xs + 0.5 * s;
+        const vd d2 = d1 - s;
+        // Upper branch works on b_max - b = e N(-d1) + ei N(d2), free of cancellation
+        vd gauss = zero;
+        const vd n1 = vnorm_cdf(highest ? -d1 : d1, &gauss);
+        const vd n2 = vnorm_cdf(d2);
+        const vd b = vmax(e * n1 - ei * n2, splat(1e-300));
+        const vd q = e * n1 + ei * n2;
+        const vd bp = e * gauss * 0.398942280401432677939946059934;
+        const vd x2s3 = xs * xs / s;
+        const vd h2 = x2s3 - 0.25 * s;
+        const vd h3 = h2 * h2 - 3.0 * x2s3 / s - 0.25;
+
+        // Price objective on the middle branches
+        vd nu = (b - beta) / bp;
+        vd H2 = h2;
+        vd H3 = h3;
+        if (any(lowest | highest)) {
+            const vd ln_b = vlog(highest ? q : b);
+            // g = 1/ln b - 1/ln beta
+            const vd r = bp / b;
+            const vd l1 = r;
+            const vd l2 = r * h2 - r * r;
+            const vd l3 = r * h3 - 3.0 * r * r * h2 + 2.0 * r * r * r;
+            const vd il = 1.0 / ln_b;
+            const vd g = il - 1.0 / (lowest ? ln_beta : splat(-1.0));
+            const vd g1 = -l1 * il * il;
+            const vd g2 = (-l2 + 2.0 * l1 * l1 * il) * il * il;
+            const vd g3 = (-l3 + (6.0 * l1 * l2 - 6.0 * l1 * l1 * l1 * il) * il) * il * il;
+            // u = ln(b_max - beta) - ln(b_max - b)
+            const vd ru = bp / q;
+            const vd u1 = ru;
+            const vd u2 = ru * h2 + ru * ru;
+            const vd u3 = ru * h3 + 3.0 * ru * ru * h2 + 2.0 * ru * ru * ru;
+            const vd u = ln_upper - ln_b;
+            nu = lowest ? g / g1 : (highest ? u / u1 : nu);
+            H2 = lowest ? g2 / g1 : (highest ? u2 / u1 : H2);
+            H3 = lowest ? g3 / g1 : (highest ? u3 / u1 : H3);
+        }
+        const vd den = 1.0 + H2 * nu + H3 * nu * nu * (1.0 / 6.0);
+        const vd householder = -nu * (1.0 + 0.5 * H2 * nu) / den;
+        const vi newton = ~(den > 0.5) | (householder * nu > 0.0);
+        const vd next = s + (newton ? -nu : householder);
+        vd bounded = next > lo ? next : 0.5 * (s + lo);
+        bounded = next < hi ? bounded : (highest ? 2.0 * s : 0.5 * (s + hi));
+        s = bounded == bounded ? bounded : s;
+    }
+    return s;
+}
+
+// Black-Scholes implied volatility: reduce to the out-of-the-money
+// normalised price on the forward, invert, rescale. NaN outside the
+// no-arbitrage bounds or for T <= 0; 0 at exactly intrinsic value.
+AEMPS_SIMD_INLINE vd implied_vol_lanes(vd phi, vd S, vd K, vd T, vd r, vd price) {
+    const vd df = vexp(-r * T);
+    const vd fwd = S / df;
+    const vd x = vlog(fwd / K);
+    const vd beta = price / (df * vsqrt(fwd * K));
+    const vd e = vexp(0.5 * x);
+    const vd intrinsic = vmax(phi * (e - 1.0 / e), splat(0.0));
+    const vd xo = -vabs(x);
+    const vd bmax = vexp(0.5 * xo);
+    // Quotes within rounding of intrinsic carry no time value
+    const vd otm_raw = beta - intrinsic;
+    const vi zero_vol = vabs(otm_raw) <= 0x1.0p-50 * vmax(beta, bmax);
+    const vd otm = zero_vol ? splat(0.0) : otm_raw;
+    const vi valid = (T > 0.0) & (otm >= 0.0) & (otm < bmax);
+    const vd s = normalised_implied_vol(xo, (valid & ~zero_vol) ? otm : 0.5 * bmax);
+    const vd vol = zero_vol ? splat(0.0) : s / vsqrt(valid ? T : splat(1.0));
+    return valid ? vol : splat(__builtin_nan(""));
+}
+
+void implied_vol(const OptionBatch& b, const double* prices, double* vols) {
+    const std::size_t n = b.size;
+    std::size_t i = 0;
+    for (; i + W <= n; i += W) {
+        const vd v = implied_vol_lanes(load_sign(b.type + i, W), load(b.spot + i), load(b.strike + i),
+                                       load(b.maturity + i), load(b.rate + i), load(prices + i));
+        store(vols + i, v);
+    }
+    if (i < n) {
+        const std::size_t m = n - i;
+        const vd v = implied_vol_lanes(load_sign(b.type + i, m), load_n(b.spot + i, m, 1.0),
+                                       load_n(b.strike + i, m, 1.0), load_n(b.maturity + i, m, 1.0),
+                                       load_n(b.rate + i, m, 0.0), load_n(prices + i, m, 0.1));
+        store_n(vols + i, v, m);
+    }
+}
+
+// Philox4x32-10 over W counters at once; each 32-bit word sits in a 64-bit
+// lane so the 32x32->64 products map onto a single widening multiply
+AEMPS_SIMD_INLINE void philox_lanes(vu c[4], std::uint32_t k0, std::uint32_t k1) {
+    for (int round = 0; round < 10; ++round) {
+        const vu p0 = vmul32(c[0], 0xD2511F53U);
+        const vu p1 = vmul32(c[2], 0xCD9E8D57U);
+        c[0] = (p1 >> 32) ^ c[1] ^ static_cast<unsigned long long>(k0);
+        c[1] = p1 & 0xFFFFFFFFULL;
+        c[2] = (p0 >> 32) ^ c[3] ^ static_cast<unsigned long long>(k1);
+        c[3] = p0 & 0xFFFFFFFFULL;
+        k0 += 0x9E3779B9U;
+        k1 += 0xBB67AE85U;
+    }
+}
+
+// Normal of (path, step): inverse CDF of the top 52 bits of the first two
+// Philox words, mapped to the open interval (0, 1)
+AEMPS_SIMD_INLINE vd philox_normal_lanes(std::uint32_t k0, std::uint32_t k1, std::uint64_t first_path,
+                                         std::uint64_t step) {
+    const vu path = splat_u(first_path) + iota_u();
+    vu c[4] = {path & 0xFFFFFFFFULL, path >> 32, splat_u(step & 0xFFFFFFFFULL), splat_u(step >> 32)};
+    philox_lanes(c, k0, k1);
+    const vu bits = (c[1] << 32) | c[0];
+    const vd u = as_d((bits >> 12) | 0x3FF0000000000000ULL) - (1.0 - 0x1.0p-53);
+    return vnorm_inv(u);
+}
+
+void philox_normals(std::uint32_t k0, std::uint32_t k1, std::uint64_t first_path, std::size_t count,
+                    std::uint64_t step, double* out) {
+    std::size_t i = 0;
+    for (; i + W <= count; i += W) store(out + i, philox_normal_lanes(k0, k1, first_path + i, step));
+    if (i < count) store_n(out + i, philox_normal_lanes(k0, k1, first_path + i, step), count - i);
+}
+
+// Single-precision normals of paths [first_path, first_path + WF): two
+// Philox passes, the top 23 bits of each first word centred on a 2^-23
+// grid in (0, 1), and the float inverse CDF
+AEMPS_SIMD_INLINE vf philox_normal_lanes_f(std::uint32_t k0, std::uint32_t k1, std::uint64_t first_path,
+                                           std::uint64_t step) {
+    typedef unsigned vhu __attribute__((vector_size(W * sizeof(unsigned))));
+    vhu words[2];
+    for (int h = 0; h < 2; ++h) {
+        const vu path = splat_u(first_path + static_cast<std::uint64_t>(h * W)) + iota_u();
+        vu c[4] = {path & 0xFFFFFFFFULL, path >> 32, splat_u(step & 0xFFFFFFFFULL), splat_u(step >> 32)};
+        philox_lanes(c, k0, k1);
+        words[h] = __builtin_convertvector(c[0], vhu);
+    }
+    vfu bits;
+    __builtin_memcpy(&bits, words, sizeof bits);
+    const vf u = (__builtin_convertvector((vfi)(bits >> 9), vf) + 0.5f) * 0x1.0p-23f;
+    return vnorm_inv(u);
+}
+
+void philox_normals_f32(std::uint32_t k0, std::uint32_t k1, std::uint64_t first_path, std::size_t count,
+                        std::uint64_t step, double* out) {
+    std::size_t i = 0;
+    for (; i + WF <= count; i += WF) store_f(out + i, philox_normal_lanes_f(k0, k1, first_path + i, step));
+    if (i < count) store_f_n(out + i, philox_normal_lanes_f(k0, k1, first_path + i, step), count - i);
+}
+
+void norm_inv_array(const double* u, double* out, std::size_t n) {
+    std::size_t i = 0;
+    for (; i + W <= n; i += W) store(out + i, vnorm_inv(load(u + i)));
+    if (i < n) store_n(out + i, vnorm_inv(load_n(u + i, n - i, 0.5)), n - i);
+}
+
+void gbm_advance(double* x, const double* z, std::size_t n, double drift, double diffusion) {
+    std::size_t i = 0;
+    for (; i + W <= n; i += W) store(x + i, load(x + i) + (drift + diffusion * load(z + i)));
+    if (i < n) store_n(x + i, load_n(x + i, n - i, 0.0) + (drift + diffusion * load_n(z + i, n - i, 0.0)), n - i);
+}
+
+void exp_array(const double* x, double* out, std::size_t n) {
+    std::size_t i = 0;
+    for (; i + W <= n; i += W) store(out + i, vexp(load(x + i)));
+    if (i < n) store_n(out + i, vexp(load_n(x + i, n - i, 0.0)), n - i);
+}
+
+// sigma(y) of each lane: cell index by truncation, then the two node
+// values gathered lane by lane
+AEMPS_SIMD_INLINE vd local_vol_lanes(vd x, vd z, const LocalVolStep& st) {
+    const vd u = vmin(vmax((x - (st.shift + st.y0)) * st.inv_dy, splat(0.0)), splat(static_cast<double>(st.nodes - 1)));
+    const vi cell = __builtin_convertvector(u, vi);
+    vd lo, hi, f;
+    for (int j = 0; j < W; ++j) {
+        std::size_t c = static_cast<std::size_t>(cell[j]);
+        c = c < st.nodes - 2 ? c : st.nodes - 2;
+        lo[j] = st.vol[c];
+        hi[j] = st.vol[c + 1];
+        f[j] = u[j] - static_cast<double>(c);
+    }
+    const vd sigma = lo + f * (hi - lo);
+    return x + (st.rate_dt - (0.5 * st.dt) * sigma * sigma) + st.sqrt_dt * sigma * z;
+}
+
+void local_vol_advance(double* x, const double* z, std::size_t n, const LocalVolStep& step) {
+    std::size_t i = 0;
+    for (; i + W <= n; i += W) store(x + i, local_vol_lanes(load(x + i), load(z + i), step));
+    if (i < n) store_n(x + i, local_vol_lanes(load_n(x + i, n - i, 0.0), load_n(z + i, n - i, 0.0), step), n - i);
+}
+
+// Both QE branches run on every lane and are blended on psi <= 1.5, as are
+// the martingale-corrected drift and, where its moment condition fails,
+// the plain one
+AEMPS_SIMD_INLINE void heston_lanes(vd& x, vd& v, vd zv, vd zx, const HestonStep& h) {
+    const vd tiny = splat(1e-300);
+    const vd m = h.theta + (v - h.theta) * h.decay;
+    const vd s2 = v * h.var_v + h.var_c;
+    const vd psi = vmax(s2 / (m * m), tiny);
+    const vi quadratic = psi <= 1.5;
+
+    const vd ip = 2.0 / psi;
+    const vd b2 = ip - 1.0 + vsqrt(ip) * vsqrt(vmax(ip - 1.0, splat(0.0)));
+    const vd a = m / (1.0 + b2);
+    const vd b = vsqrt(b2);
+    const vd v_quadratic = a * (b + zv) * (b + zv);
+
+    const vd p = (psi - 1.0) / (psi + 1.0);
+    const vd beta = (1.0 - p) / m;
+    vd vn = v_quadratic;
+    if (!all(quadratic)) {
+        const vd survival = vmax(vnorm_cdf(-zv), tiny); // 1 - U
+        const vd v_exponential = 1.0 - survival <= p ? splat(0.0) : vlog(vmax((1.0 - p) / survival, tiny)) / beta;
+        vn = quadratic ? v_quadratic : v_exponential;
+    }
+
+    // k0 that makes E[exp(x_{t+dt}) | x_t, v_t] = exp(x_t + r dt) exactly;
+    // both branches share one log
+    const double A = h.k2 + 0.5 * h.k4;
+    const vd one_2aa = 1.0 - 2.0 * A * a;
+    const vd moment = quadratic ? one_2aa : p + beta * (1.0 - p) / (beta - A);
+    const vd log_moment = vlog(vmax(moment, tiny));
+    const vd k0_corrected = (quadratic ? -A * b2 * a / one_2aa + 0.5 * log_moment : -log_moment) - (h.k1 + 0.5 * h.k3) * v;
+    const vi corrected = quadratic ? one_2aa > 0.0 : beta > A;
+    const vd k0 = corrected ? k0_corrected : splat(h.k0);
+
+    x = x + (h.rate_dt + k0 + h.k1 * v + h.k2 * vn) + vsqrt(vmax(h.k3 * v + h.k4 * vn, splat(0.0))) * zx;
+    v = vn;
+}
+
+void heston_qe_advance(double* x, double* v, const double* zv, const double* zx, std::size_t n,
+                       const HestonStep& step) {
+    std::size_t i = 0;
+    for (; i + W <= n; i += W) {
+        vd xv = load(x + i), vv = load(v + i);
+        heston_lanes(xv, vv, load(zv + i), load(zx + i), step);
+        store(x + i, xv);
+        store(v + i, vv);
+    }
+    if (i < n) {
+        const std::size_t m = n - i;
+        vd xv = load_n(x + i, m, 0.0), vv = load_n(v + i, m, step.theta);
+        heston_lanes(xv, vv, load_n(zv + i, m, 0.0), load_n(zx + i, m, 0.0), step);
+        store_n(x + i, xv, m);
+        store_n(v + i, vv, m);
+    }
+}
+
+// Complex lanes for the Heston characteristic function
+struct cvd {
+    vd re, im;
+};
+
+AEMPS_SIMD_INLINE cvd cmul(cvd a, cvd b) { return {a.re * b.re - a.im * b.im, a.re * b.im + a.im * b.re}; }
+
+AEMPS_SIMD_INLINE cvd cdiv(cvd a, cvd b) {
+    const vd inv = 1.0 / (b.re * b.re + b.im * b.im);
+    return {(a.re * b.re + a.im * b.im) * inv, (a.im * b.re - a.re * b.im) * inv};
+}
+
+AEMPS_SIMD_INLINE cvd cexp(cvd z) {
+    vd s, c;
+    vsincos(z.im, &s, &c);
+    const vd m = vexp(z.re);
+    return {m * c, m * s};
+}
+
+// Principal log; z must be non-zero
+AEMPS_SIMD_INLINE cvd clog(cvd z) { return {0.5 * vlog(z.re * z.re + z.im * z.im), vatan2(z.im, z.re)}; }
+
+// E[exp(i u ln(S_T / S_0))] at real u, little trap form as in heston.cpp.
+// d^2 = (kappa - i rho xi u)^2 + xi^2 (u^2 + i u) has a positive real part
+// for real u, so its principal root needs no branch fix-up.
+AEMPS_SIMD_INLINE cvd heston_cf_lanes(vd u, const HestonParams& p, double T, double rate) {
+    const double xi2 = p.xi * p.xi;
+    const cvd beta{splat(p.kappa), (-p.rho * p.xi) * u};
+    const cvd d2{p.kappa * p.kappa + ((1.0 - p.rho * p.rho) * xi2) * u * u,
+                 (xi2 - 2.0 * p.kappa * p.rho * p.xi) * u};
+    const vd mod = vsqrt(d2.re * d2.re + d2.im * d2.im);
+    const vd dr = vsqrt(0.5 * (mod + d2.re));
+    const cvd d{dr, d2.im / (2.0 * dr)};
+    const cvd minus{beta.re - d.re, beta.im - d.im};
+    const cvd g = cdiv(minus, cvd{beta.re + d.re, beta.im + d.im});
+    const cvd e = cexp(cvd{-T * d.re, -T * d.im});
+    const cvd ge = cmul(g, e);
+    const cvd one_ge{1.0 - ge.re, -ge.im};
+    const cvd ratio = clog(cdiv(one_ge, cvd{1.0 - g.re, -g.im}));
+    const double kt = p.kappa * p.theta / xi2;
+    const cvd D = cdiv(cmul(minus, cvd{1.0 - e.re, -e.im}), one_ge);
+    const cvd expo{kt * (T * minus.re - 2.0 * ratio.re) + (p.v0 / xi2) * D.re,
+                   (rate * T) * u + kt * (T * minus.im - 2.0 * ratio.im) + (p.v0 / xi2) * D.im};
+    return cexp(expo);
+}
+
+void heston_cf(const HestonParams& p, double maturity, double rate, const double* u, std::size_t n, double* re,
+               double* im) {
+    std::size_t i = 0;
+    for (; i + W <= n; i += W) {
+        const cvd f = heston_cf_lanes(load(u + i), p, maturity, rate);
+        store(re + i, f.re);
+        store(im + i, f.im);
+    }
+    if (i < n) {
+        const cvd f = heston_cf_lanes(load_n(u + i, n - i, 0.0), p, maturity, rate);
+        store_n(re + i, f.re, n - i);
+        store_n(im + i, f.im, n - i);
+    }
+}
+
+// sum_k re[k] cos(k theta) - im[k] sin(k theta) on each lane; exp(i k theta)
+// advances by one complex rotation per term instead of a sin/cos pair
+AEMPS_SIMD_INLINE vd cos_series_lanes(const double* re, const double* im, std::size_t terms, vd c1, vd s1) {
+    vd c = splat(1.0), s = splat(0.0), acc = splat(0.0);
+    for (std::size_t k = 0; k < terms; ++k) {
+        acc += re[k] * c - im[k] * s;
+        const vd c_next = c * c1 - s * s1;
+        s = s * c1 + c * s1;
+        c = c_next;
+    }
+    return acc;
+}
+
+void cos_series(const double* re, const double* im, std::size_t terms, const double* cos_theta,
+                const double* sin_theta, std::size_t n, double* out) {
+    std::size_t i = 0;
+    for (; i + W <= n; i += W) store(out + i, cos_series_lanes(re, im, terms, load(cos_theta + i), load(sin_theta + i)));
+    if (i < n) {
+        const std::size_t m = n - i;
+        store_n(out + i, cos_series_lanes(re, im, terms, load_n(cos_theta + i, m, 1.0), load_n(sin_theta + i, m, 0.0)),
+                m);
+    }
+}
+
+// Constant-initialized, in KernelTable's member order: no code of this
+// ISA may run before select_kernels() has checked the CPU supports it
+extern const KernelTable kernel_table;
+constexpr KernelTable kernel_table = {
+    AEMPS_SIMD_ISA,
+    W,
+    &bs_price,
+    &bs_price_f32,
+    &bs_greeks,
+    &bs_scenarios,
+    &implied_vol,
+    &philox_normals,
+    &philox_normals_f32,
+    &norm_inv_array,
+    &gbm_advance,
+    &exp_array,
+    &local_vol_advance,
+    &heston_qe_advance,
+    &heston_cf,
+    &cos_series,
+};
+
+}
+}
+}
@@ -0,0 +1,11 @@
+// Baseline kernels, built with the default target flags
+#define AEMPS_SIMD_NS portable
+#define AEMPS_SIMD_WIDTH 2
+#if defined(__aarch64__)
+#define AEMPS_SIMD_ISA SimdIsa::Neon
+#elif defined(__SSE2__)
+#define AEMPS_SIMD_ISA SimdIsa::Sse2
+#else
+#define AEMPS_SIMD_ISA SimdIsa::Portable
+#endif
+#include "kernels_impl.h"
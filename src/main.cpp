@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "black_scholes.h"
+#include "distributed.h"
+#include "instrumentation.h"
+#include "monte_carlo_pricer.h"
+#include "option.h"
+#include "stream_pricer.h"
+
+using namespace aemps;
+
+namespace {
+
+void usage(const char* argv0) {
+    std::fprintf(stderr,
+                 "usage: %s                       one-shot demo\n"
+                 "       %s --stream [options]    price records from stdin to stdout\n"
+                 "       %s --listen PORT [--bind ADDR] [options]\n"
+                 "                                  serve records over TCP, one connection at a time\n"
+                 "       %s --mc-worker PORT [--bind ADDR]\n"
+                 "                                  serve distributed Monte Carlo tasks\n"
+                 "       %s --distribute HOST:PORT[,HOST:PORT...]\n"
+                 "                                  run the demo simulation on those workers\n"
+                 "options: --workers N  --batch N  --price-only  --single (float32 prices, with --price-only)\n"
+                 "         --metrics          print Prometheus metrics to stderr on exit\n"
+                 "         --metrics-port P   serve them over HTTP on --bind ADDR:P\n"
+                 "records: id,type,strike,maturity,spot,vol,rate\n",
+                 argv0, argv0, argv0, argv0, argv0);
+}
+
+bool parse_count(const char* s, std::size_t& out) {
+    char* end = nullptr;
+    errno = 0;
+    const unsigned long long v = std::strtoull(s, &end, 10);
+    if (errno || !*s || *end) return false;
+    out = static_cast<std::size_t>(v);
+    return true;
+}
+
+void report(const StreamStats& stats) {
+    std::fprintf(stderr, "pricer_demo: %llu records (%llu malformed) in %llu batches%s\n",
+                 static_cast<unsigned long long>(stats.records), static_cast<unsigned long long>(stats.errors),
+                 static_cast<unsigned long long>(stats.batches), stats.write_failed ? ", output closed early" : "");
+}
+
+int demo() {
+    const Option opt(OptionType::Call, 100.0, 1.0, 100.0);
+    const double rate = 0.05, vol = 0.2;
+    const Greeks g = BlackScholes::greeks(opt, rate, vol);
+    std::printf("Black-Scholes call S=100 K=100 T=1 r=5%% vol=20%%\n");
+    std::printf("  price %.6f  delta %.6f  gamma %.6f  vega %.6f  theta %.6f  rho %.6f\n", g.price, g.delta,
+                g.gamma, g.vega, g.theta, g.rho);
+
+    McConfig config;
+    config.variance_reduction = VarianceReduction::Antithetic;
+    const McResult mc = MonteCarloPricer<>(config).price(opt, rate, vol);
+    std::printf("Monte Carlo (%zu paths, antithetic)\n", mc.paths);
+    std::printf("  price %.6f  std error %.6f\n", mc.price, mc.std_error);
+    return 0;
+}
+
+// Accepts connections on bind_addr:port forever; `concurrent` serves each
+// on its own thread, otherwise one at a time
+int serve(const char* bind_addr, std::size_t port, bool concurrent, const std::function<void(int)>& handle) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<std::uint16_t>(port));
+    if (port == 0 || port > 65535 || ::inet_pton(AF_INET, bind_addr, &addr.sin_addr) != 1) {
+        std::fprintf(stderr, "pricer_demo: bad listen address %s:%zu\n", bind_addr, port);
+        return 2;
+    }
+    const int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    const int on = 1;
+    if (listener < 0 || ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on) != 0 ||
+        ::bind(listener, reinterpret_cast<const sockaddr*>(&addr), sizeof addr) != 0 || ::listen(listener, 16) != 0) {
+        std::fprintf(stderr, "pricer_demo: cannot listen on %s:%zu: %s\n", bind_addr, port, std::strerror(errno));
+        return 1;
+    }
+    std::fprintf(stderr, "pricer_demo: listening on %s:%zu\n", bind_addr, port);
+    for (;;) {
+        const int fd = ::accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            std::fprintf(stderr, "pricer_demo: accept failed: %s\n", std::strerror(errno));
+            ::close(listener);
+            return 1;
+        }
+        auto session = [fd, handle] {
+            handle(fd);
+            ::close(fd);
+        };
+        if (concurrent)
+            std::thread(session).detach();
+        else
+            session();
+    }
+}
+
+// Minimal HTTP/1.0 reply for a Prometheus scrape; the request is not parsed
+void serve_metrics(int fd) {
+    char request[1024];
+    while (::read(fd, request, sizeof request) < 0 && errno == EINTR) {
+    }
+    const std::string body = to_prometheus(instrumentation_snapshot());
+    const std::string reply = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                              std::to_string(body.size()) + "\r\n\r\n" + body;
+    for (std::size_t at = 0; at < reply.size();) {
+        const ssize_t n = ::write(fd, reply.data() + at, reply.size() - at);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        at += static_cast<std::size_t>(n);
+    }
+}
+
+// The demo simulation on remote workers, next to the same run in process
+int distribute(const std::string& list) {
+    std::vector<std::string> endpoints;
+    for (std::size_t at = 0; at <= list.size();) {
+        const std::size_t comma = std::min(list.find(',', at), list.size());
+        if (comma > at) endpoints.push_back(list.substr(at, comma - at));
+        at = comma + 1;
+    }
+    const Option opt(OptionType::Call, 100.0, 1.0, 100.0);
+    const double rate = 0.05, vol = 0.2;
+    McConfig config;
+    config.paths = 4000000;
+    config.variance_reduction = VarianceReduction::Antithetic;
+    config.greeks = true;
+    try {
+        const McResult remote = DistributedMc(endpoints).price(opt, rate, vol, config);
+        const McResult local = MonteCarloPricer<PhiloxRng>(config).price(opt, rate, vol);
+        std::printf("Monte Carlo on %zu workers (%zu paths, antithetic, Philox)\n", endpoints.size(), remote.paths);
+        std::printf("  price %.10f  std error %.6f  delta %.6f  vega %.6f\n", remote.price, remote.std_error,
+                    remote.delta, remote.vega);
+        std::printf("  in-process run %s\n", remote.price == local.price && remote.std_error == local.std_error &&
+                                                      remote.delta == local.delta && remote.vega == local.vega
+                                                  ? "identical"
+                                                  : "DIFFERS");
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "pricer_demo: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+// Everything but the metrics endpoint, by command line flags
+int run_mode(const char* argv0, bool stream, const char* listen_port, const char* worker_port, const char* peers,
+             const char* bind_addr, const StreamConfig& config) {
+    if (listen_port || worker_port) {
+        std::size_t port = 0;
+        if (!parse_count(listen_port ? listen_port : worker_port, port)) {
+            usage(argv0);
+            return 2;
+        }
+        if (worker_port) return serve(bind_addr, port, true, serve_mc_worker);
+        return serve(bind_addr, port, false, [&](int fd) { report(run_stream(fd, fd, config)); });
+    }
+    if (peers) return distribute(peers);
+    if (stream) {
+        const StreamStats stats = run_stream(STDIN_FILENO, STDOUT_FILENO, config);
+        report(stats);
+        return stats.write_failed ? 1 : 0;
+    }
+    return demo();
+}
+
+}
+
+int main(int argc, char** argv) {
+    bool stream = false;
+    const char* listen_port = nullptr;
+    const char* worker_port = nullptr;
+    const char* peers = nullptr;
+    const char* bind_addr = "127.0.0.1";
+    const char* metrics_port = nullptr;
+    bool metrics = false;
+    StreamConfig config;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--stream") {
+            stream = true;
+        } else if (arg == "--listen" && has_value) {
+            listen_port = argv[++i];
+        } else if (arg == "--mc-worker" && has_value) {
+            worker_port = argv[++i];
+        } else if (arg == "--distribute" && has_value) {
+            peers = argv[++i];
+        } else if (arg == "--bind" && has_value) {
+            bind_addr = argv[++i];
+        } else if (arg == "--workers" && has_value && parse_count(argv[i + 1], config.workers)) {
+            ++i;
+        } else if (arg == "--batch" && has_value && parse_count(argv[i + 1], config.batch_size) && config.batch_size) {
+            ++i;
+        } else if (arg == "--price-only") {
+            config.greeks = false;
+        } else if (arg == "--single") {
+            config.precision = Precision::Single;
+        } else if (arg == "--metrics") {
+            metrics = true;
+        } else if (arg == "--metrics-port" && has_value) {
+            metrics_port = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    // A client that hangs up must end its stream, not the process
+    std::signal(SIGPIPE, SIG_IGN);
+
+    if ((metrics || metrics_port) && !kInstrumentation)
+        std::fprintf(stderr, "pricer_demo: built without PRICER_ENABLE_INSTRUMENTATION, metrics stay zero\n");
+    if (metrics_port) {
+        std::size_t port = 0;
+        if (!parse_count(metrics_port, port)) {
+            usage(argv[0]);
+            return 2;
+        }
+        std::thread([bind_addr, port] { serve(bind_addr, port, false, serve_metrics); }).detach();
+    }
+    const int status = run_mode(argv[0], stream, listen_port, worker_port, peers, bind_addr, config);
+    if (metrics) std::fputs(to_prometheus(instrumentation_snapshot()).c_str(), stderr);
+    return status;
+}
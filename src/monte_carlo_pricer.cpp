@@ -0,0 +1,107 @@
+#include "monte_carlo_pricer.h"
+
+namespace aemps {
+
+void PathStats::merge(const PathStats& other) {
+    if (other.n > 0) {
+        const double na = static_cast<double>(n), nb = static_cast<double>(other.n);
+        const double w = nb / (na + nb);
+        const double dx = other.mean - mean;
+        const double dc = other.mean_c - mean_c;
+        m2 += other.m2 + dx * dx * na * w;
+        m2_c += other.m2_c + dc * dc * na * w;
+        c_xc += other.c_xc + dx * dc * na * w;
+        mean += dx * w;
+        mean_c += dc * w;
+        n += other.n;
+    }
+    if (other.greek_n > 0) {
+        const double na = static_cast<double>(greek_n), nb = static_cast<double>(other.greek_n);
+        const double w = nb / (na + nb);
+        for (int k = 0; k < 3; ++k) {
+            const double d = other.greek_mean[k] - greek_mean[k];
+            greek_m2[k] += other.greek_m2[k] + d * d * na * w;
+            greek_mean[k] += d * w;
+        }
+        greek_n += other.greek_n;
+    }
+}
+
+McResult PathStats::result(double discount) const {
+    McResult r;
+    r.paths = n;
+    if (n == 0) return r;
+    const double var = n > 1 ? m2 / static_cast<double>(n - 1) : 0.0;
+    r.price = discount * mean;
+    r.std_error = discount * std::sqrt(var / static_cast<double>(n));
+    return r;
+}
+
+McResult PathStats::result(double discount, double control_mean) const {
+    McResult r;
+    r.paths = n;
+    if (n == 0) return r;
+    const double nd = static_cast<double>(n);
+    const double beta = m2_c > 0.0 ? c_xc / m2_c : 0.0;
+    const double resid = std::max(m2 - 2.0 * beta * c_xc + beta * beta * m2_c, 0.0);
+    r.price = discount * (mean - beta * (mean_c - control_mean));
+    r.std_error = n > 1 ? discount * std::sqrt(resid / (nd - 1.0) / nd) : 0.0;
+    r.beta = beta;
+    return r;
+}
+
+void PathStats::greeks(double discount, McResult& r) const {
+    if (greek_n == 0) return;
+    const double nd = static_cast<double>(greek_n);
+    double err[3];
+    for (int k = 0; k < 3; ++k) {
+        const double var = greek_n > 1 ? greek_m2[k] / (nd - 1.0) : 0.0;
+        err[k] = discount * std::sqrt(var / nd);
+    }
+    r.delta = discount * greek_mean[0];
+    r.delta_error = err[0];
+    r.gamma = discount * greek_mean[1];
+    r.gamma_error = err[1];
+    r.vega = discount * greek_mean[2];
+    r.vega_error = err[2];
+}
+
+void ExerciseMoments::merge(const ExerciseMoments& other) {
+    n += other.n;
+    for (std::size_t j = 0; j < 2 * ExerciseConfig::kMaxBasis - 1; ++j) power[j] += other.power[j];
+    for (std::size_t j = 0; j < ExerciseConfig::kMaxBasis; ++j) cross[j] += other.cross[j];
+}
+
+bool ExerciseMoments::solve(std::size_t basis, double* beta) const {
+    constexpr std::size_t K = ExerciseConfig::kMaxBasis;
+    if (basis == 0 || basis > K || n < basis) return false;
+    // Lower Cholesky factor of the Gram matrix G[i][j] = power[i + j]
+    double L[K][K] = {};
+    for (std::size_t i = 0; i < basis; ++i) {
+        for (std::size_t j = 0; j <= i; ++j) {
+            double sum = power[i + j];
+            for (std::size_t k = 0; k < j; ++k) sum -= L[i][k] * L[j][k];
+            if (i == j) {
+                // Relative to the diagonal, as the powers span many scales
+                if (!(sum > 1e-12 * power[2 * i])) return false;
+                L[i][i] = std::sqrt(sum);
+            } else {
+                L[i][j] = sum / L[j][j];
+            }
+        }
+    }
+    double y[K];
+    for (std::size_t i = 0; i < basis; ++i) {
+        double sum = cross[i];
+        for (std::size_t k = 0; k < i; ++k) sum -= L[i][k] * y[k];
+        y[i] = sum / L[i][i];
+    }
+    for (std::size_t i = basis; i-- > 0;) {
+        double sum = y[i];
+        for (std::size_t k = i + 1; k < basis; ++k) sum -= L[k][i] * beta[k];
+        beta[i] = sum / L[i][i];
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,44 @@
+#include "option.h"
+
+namespace aemps {
+
+void OptionBook::reserve(std::size_t n) {
+    type.reserve(n);
+    strike.reserve(n);
+    maturity.reserve(n);
+    spot.reserve(n);
+    volatility.reserve(n);
+    rate.reserve(n);
+}
+
+void OptionBook::clear() {
+    type.clear();
+    strike.clear();
+    maturity.clear();
+    spot.clear();
+    volatility.clear();
+    rate.clear();
+}
+
+void OptionBook::push_back(const Option& opt, double vol, double r) {
+    type.push_back(opt.type);
+    strike.push_back(opt.strike);
+    maturity.push_back(opt.maturity);
+    spot.push_back(opt.spot);
+    volatility.push_back(vol);
+    rate.push_back(r);
+}
+
+OptionBatch OptionBook::view() const {
+    OptionBatch b;
+    b.size = size();
+    b.type = type.data();
+    b.strike = strike.data();
+    b.maturity = maturity.data();
+    b.spot = spot.data();
+    b.volatility = volatility.data();
+    b.rate = rate.data();
+    return b;
+}
+
+}
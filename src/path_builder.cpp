@@ -0,0 +1,60 @@
+#include "path_builder.h"
+#include <cmath>
+
+namespace aemps {
+
+BrownianBridge::BrownianBridge(std::size_t steps)
+    : bridge_(steps), left_(steps), right_(steps), left_weight_(steps), right_weight_(steps), std_dev_(steps) {
+    if (steps == 0) return;
+    // Time measured in steps: t_i = i + 1
+    const auto t = [](std::size_t i) { return static_cast<double>(i + 1); };
+    std::vector<std::size_t> map(steps, 0);
+    map[steps - 1] = 1;
+    bridge_[0] = steps - 1;
+    std_dev_[0] = std::sqrt(t(steps - 1));
+    for (std::size_t i = 1, j = 0; i < steps; ++i) {
+        while (map[j]) ++j;
+        std::size_t k = j;
+        while (!map[k]) ++k;
+        // points j..k-1 are free, k is known; fill the midpoint l
+        const std::size_t l = j + ((k - 1 - j) >> 1);
+        map[l] = i;
+        bridge_[i] = l;
+        left_[i] = j;
+        right_[i] = k;
+        const double tl = t(l), tk = t(k), tj = j ? t(j - 1) : 0.0;
+        left_weight_[i] = (tk - tl) / (tk - tj);
+        right_weight_[i] = (tl - tj) / (tk - tj);
+        std_dev_[i] = std::sqrt((tl - tj) * (tk - tl) / (tk - tj));
+        j = k + 1;
+        if (j >= steps) j = 0;
+    }
+}
+
+void BrownianBridge::build(const double* z, std::size_t lanes, double* dz) const {
+    const std::size_t steps = bridge_.size();
+    if (steps == 0) return;
+    // Brownian values at each grid point go to dz first, then get differenced
+    double* w_end = dz + bridge_[0] * lanes;
+    for (std::size_t n = 0; n < lanes; ++n) w_end[n] = std_dev_[0] * z[n];
+    for (std::size_t i = 1; i < steps; ++i) {
+        const double* zi = z + i * lanes;
+        double* wl = dz + bridge_[i] * lanes;
+        const double* wr = dz + right_[i] * lanes;
+        const double rw = right_weight_[i], sd = std_dev_[i];
+        if (left_[i]) {
+            const double* wj = dz + (left_[i] - 1) * lanes;
+            const double lw = left_weight_[i];
+            for (std::size_t n = 0; n < lanes; ++n) wl[n] = lw * wj[n] + rw * wr[n] + sd * zi[n];
+        } else {
+            for (std::size_t n = 0; n < lanes; ++n) wl[n] = rw * wr[n] + sd * zi[n];
+        }
+    }
+    for (std::size_t s = steps - 1; s > 0; --s) {
+        double* cur = dz + s * lanes;
+        const double* prev = dz + (s - 1) * lanes;
+        for (std::size_t n = 0; n < lanes; ++n) cur[n] -= prev[n];
+    }
+}
+
+}
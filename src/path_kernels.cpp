@@ -0,0 +1,36 @@
+#include "path_kernels.h"
+#include "kernels.h"
+
+namespace aemps {
+
+void philox_normals(std::uint32_t k0, std::uint32_t k1, std::uint64_t first_path, std::size_t count,
+                    std::uint64_t step, double* out, Precision precision) {
+    const detail::KernelTable& k = detail::kernels();
+    if (precision == Precision::Single)
+        k.philox_normals_f32(k0, k1, first_path, count, step, out);
+    else
+        k.philox_normals(k0, k1, first_path, count, step, out);
+}
+
+void norm_inv_array(const double* u, double* out, std::size_t n) {
+    detail::kernels().norm_inv_array(u, out, n);
+}
+
+void gbm_advance(double* x, const double* z, std::size_t n, double drift, double diffusion) {
+    detail::kernels().gbm_advance(x, z, n, drift, diffusion);
+}
+
+void exp_array(const double* x, double* out, std::size_t n) {
+    detail::kernels().exp_array(x, out, n);
+}
+
+void local_vol_advance(double* x, const double* z, std::size_t n, const LocalVolStep& step) {
+    detail::kernels().local_vol_advance(x, z, n, step);
+}
+
+void heston_qe_advance(double* x, double* v, const double* zv, const double* zx, std::size_t n,
+                       const HestonStep& step) {
+    detail::kernels().heston_qe_advance(x, v, zv, zx, n, step);
+}
+
+}
@@ -0,0 +1,248 @@
+// Hot-path benchmarks. Run with --benchmark_format=json (or
+// --benchmark_out=FILE --benchmark_out_format=json) to keep a record that
+// later releases can be compared against, e.g. with Google Benchmark's
+// tools/compare.py. The context block names the kernel ISA in use.
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "black_scholes.h"
+#include "cpu_features.h"
+#include "instrumentation.h"
+#include "monte_carlo_pricer.h"
+#include "option.h"
+#include "payoff.h"
+#include "result_cache.h"
+#include "rng.h"
+#include "thread_pool.h"
+
+using namespace aemps;
+
+namespace {
+
+// Random chain around spot 100: strikes 60-140, maturities up to 3 years
+OptionBook make_book(std::size_t n) {
+    std::mt19937_64 gen(7);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    OptionBook book;
+    book.reserve(n);
+    for (std::size_t i = 0; i < n; ++i)
+        book.push_back(Option(i % 2 ? OptionType::Put : OptionType::Call, 60.0 + 80.0 * u(gen), 0.05 + 3.0 * u(gen),
+                              100.0),
+                       0.1 + 0.5 * u(gen), 0.03);
+    return book;
+}
+
+void BM_BsPriceScalar(benchmark::State& state) {
+    const OptionBook book = make_book(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < book.size(); ++i) {
+            const Option opt(book.type[i], book.strike[i], book.maturity[i], book.spot[i]);
+            benchmark::DoNotOptimize(BlackScholes::price(opt, book.rate[i], book.volatility[i]));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BsPriceScalar)->Arg(64)->Arg(1024)->Arg(65536);
+
+void BM_BsPriceBatch(benchmark::State& state, Precision precision) {
+    const OptionBook book = make_book(static_cast<std::size_t>(state.range(0)));
+    AlignedVector<double> prices(book.size());
+    for (auto _ : state) {
+        BlackScholes::price(book.view(), prices.data(), precision);
+        benchmark::DoNotOptimize(prices.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_CAPTURE(BM_BsPriceBatch, double, Precision::Double)->Arg(64)->Arg(1024)->Arg(65536);
+BENCHMARK_CAPTURE(BM_BsPriceBatch, single, Precision::Single)->Arg(64)->Arg(1024)->Arg(65536);
+
+void BM_BsGreeksScalar(benchmark::State& state) {
+    const OptionBook book = make_book(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < book.size(); ++i) {
+            const Option opt(book.type[i], book.strike[i], book.maturity[i], book.spot[i]);
+            benchmark::DoNotOptimize(BlackScholes::greeks(opt, book.rate[i], book.volatility[i]));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BsGreeksScalar)->Arg(1024)->Arg(65536);
+
+void BM_BsGreeksBatch(benchmark::State& state) {
+    const OptionBook book = make_book(static_cast<std::size_t>(state.range(0)));
+    const std::size_t n = book.size();
+    AlignedVector<double> price(n), delta(n), gamma(n), vega(n), theta(n), rho(n);
+    GreeksOutput out;
+    out.price = price.data();
+    out.delta = delta.data();
+    out.gamma = gamma.data();
+    out.vega = vega.data();
+    out.theta = theta.data();
+    out.rho = rho.data();
+    for (auto _ : state) {
+        BlackScholes::greeks(book.view(), out);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BsGreeksBatch)->Arg(1024)->Arg(65536);
+
+void BM_ImpliedVolScalar(benchmark::State& state) {
+    const OptionBook book = make_book(static_cast<std::size_t>(state.range(0)));
+    AlignedVector<double> quotes(book.size());
+    BlackScholes::price(book.view(), quotes.data());
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < book.size(); ++i) {
+            const Option opt(book.type[i], book.strike[i], book.maturity[i], book.spot[i]);
+            benchmark::DoNotOptimize(BlackScholes::implied_vol(opt, book.rate[i], quotes[i]));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ImpliedVolScalar)->Arg(1024);
+
+void BM_ImpliedVolBatch(benchmark::State& state) {
+    const OptionBook book = make_book(static_cast<std::size_t>(state.range(0)));
+    AlignedVector<double> quotes(book.size()), vols(book.size());
+    BlackScholes::price(book.view(), quotes.data());
+    for (auto _ : state) {
+        BlackScholes::implied_vol(book.view(), quotes.data(), vols.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ImpliedVolBatch)->Arg(1024)->Arg(65536);
+
+// Normals per second of each RNG policy, one block of 4096 paths per step;
+// `args` follow (seed, first path) in the policy's constructor
+template <class Rng, class... Args>
+void BM_Rng(benchmark::State& state, Args... args) {
+    constexpr std::size_t kBlock = 4096;
+    std::vector<double> z(kBlock);
+    Rng rng(42, 0, args...);
+    std::size_t step = 0;
+    for (auto _ : state) {
+        rng.normals(0, kBlock, step++ % 64, z.data());
+        benchmark::DoNotOptimize(z.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kBlock);
+}
+BENCHMARK_TEMPLATE(BM_Rng, Mt19937Rng);
+BENCHMARK_TEMPLATE(BM_Rng, PhiloxRng);
+BENCHMARK_TEMPLATE(BM_Rng, SobolRng);
+
+const Option kAtm(OptionType::Call, 100.0, 1.0, 100.0);
+
+// Paths per second by thread count: one thread runs serially, n threads
+// are a pool of n - 1 workers plus the caller
+template <class Executor>
+void run_mc(benchmark::State& state, const McConfig& config, Executor executor) {
+    const MonteCarloPricer<PhiloxRng, Executor> pricer(config, std::move(executor));
+    for (auto _ : state) benchmark::DoNotOptimize(pricer.price(kAtm, 0.05, 0.2));
+    state.counters["paths_per_second"] =
+        benchmark::Counter(static_cast<double>(config.paths), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+void BM_McThreads(benchmark::State& state) {
+    const std::size_t threads = static_cast<std::size_t>(state.range(0));
+    McConfig config;
+    config.paths = 1 << 20;
+    config.steps = 16;
+    if (threads == 1) {
+        run_mc(state, config, SerialExecutor());
+        return;
+    }
+    ThreadPool pool(threads - 1);
+    run_mc(state, config, ThreadPoolExecutor(pool));
+}
+
+void thread_counts(benchmark::internal::Benchmark* b) {
+    const int hw = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    for (int t = 1; t < hw; t *= 2) b->Arg(t);
+    b->Arg(hw);
+}
+BENCHMARK(BM_McThreads)->Apply(thread_counts)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// Cost and standard error of each variance-reduction mode at a fixed path
+// count, on a monthly-averaged Asian call whose control variate is the
+// vanilla; error^2 x time is the figure of merit
+void BM_McVarianceReduction(benchmark::State& state) {
+    McConfig config;
+    config.paths = 1 << 18;
+    config.steps = 12;
+    config.variance_reduction = static_cast<VarianceReduction>(state.range(0));
+    const MonteCarloPricer<PhiloxRng> pricer(config);
+    const AsianPayoff<OptionType::Call> asian{100.0};
+    McResult r;
+    for (auto _ : state) benchmark::DoNotOptimize(r = pricer.price(asian, 100.0, 1.0, 0.05, 0.2));
+    static const char* const names[] = {"none", "antithetic", "control_variate", "antithetic_control_variate"};
+    state.SetLabel(names[state.range(0)]);
+    state.counters["std_error"] = r.std_error;
+    state.counters["paths_per_second"] =
+        benchmark::Counter(static_cast<double>(config.paths), benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(BM_McVarianceReduction)->DenseRange(0, 3)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// Longstaff-Schwartz American put by exercise dates, regression included,
+// antithetic with the European as control
+void BM_McAmerican(benchmark::State& state) {
+    McConfig config;
+    config.paths = 1 << 18;
+    config.variance_reduction = VarianceReduction::AntitheticControlVariate;
+    const MonteCarloPricer<PhiloxRng> pricer(config);
+    ExerciseConfig exercise;
+    exercise.dates = static_cast<std::size_t>(state.range(0));
+    const Option put(OptionType::Put, 100.0, 1.0, 100.0);
+    McResult r;
+    for (auto _ : state) benchmark::DoNotOptimize(r = pricer.price_american(put, 0.05, 0.2, exercise));
+    state.counters["std_error"] = r.std_error;
+    state.counters["paths_per_second"] =
+        benchmark::Counter(static_cast<double>(config.paths), benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(BM_McAmerican)->Arg(12)->Arg(50)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// Monte Carlo requests of which a given share (in percent) repeat an
+// earlier one in the same snapshot, served through a ResultCache; the hit
+// rate is reported by instrumented builds
+void BM_McCachedRequests(benchmark::State& state) {
+    McConfig config;
+    config.paths = 1 << 14;
+    const MonteCarloPricer<PhiloxRng> pricer(config);
+    ResultCache<McResult> cache;
+    const std::size_t repeat = static_cast<std::size_t>(state.range(0));
+    std::size_t request = 0, distinct = 0;
+    const InstrumentationSnapshot before = instrumentation_snapshot();
+    for (auto _ : state) {
+        const std::size_t k = request++ % 100 < repeat && distinct > 0 ? distinct / 2 : distinct++;
+        const Option opt(OptionType::Call, 50.0 + 0.01 * static_cast<double>(k), 1.0, 100.0);
+        benchmark::DoNotOptimize(cached_price(cache, pricer, opt, 0.05, 0.2));
+    }
+    if (kInstrumentation) {
+        const InstrumentationSnapshot after = instrumentation_snapshot();
+        const double hits = static_cast<double>(after[Counter::ResultCacheHits] - before[Counter::ResultCacheHits]);
+        const double misses =
+            static_cast<double>(after[Counter::ResultCacheMisses] - before[Counter::ResultCacheMisses]);
+        state.counters["hit_rate"] = hits / (hits + misses);
+    }
+}
+BENCHMARK(BM_McCachedRequests)->Arg(0)->Arg(40)->Arg(90)->Unit(benchmark::kMicrosecond);
+
+}
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::AddCustomContext("aemps_simd_isa", to_string(active_simd_isa()));
+    // A template with captured arguments cannot go through the macros
+    benchmark::RegisterBenchmark("BM_Rng<PhiloxRng>/single", BM_Rng<PhiloxRng, Precision>, Precision::Single);
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
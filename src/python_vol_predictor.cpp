@@ -0,0 +1,200 @@
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "python_vol_predictor.h"
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+namespace aemps {
+
+namespace {
+
+// Starts the interpreter unless the host already runs one, then drops the
+// GIL so any thread can take it through PyGILState_Ensure
+void ensure_interpreter() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        if (Py_IsInitialized()) return;
+        Py_InitializeEx(0);
+        PyEval_SaveThread();
+    });
+}
+
+class Gil {
+public:
+    Gil() : state_(PyGILState_Ensure()) {}
+    ~Gil() { PyGILState_Release(state_); }
+    Gil(const Gil&) = delete;
+    Gil& operator=(const Gil&) = delete;
+
+private:
+    PyGILState_STATE state_;
+};
+
+// Owned reference, released on scope exit
+struct Ref {
+    PyObject* p;
+    explicit Ref(PyObject* o) : p(o) {}
+    ~Ref() { Py_XDECREF(p); }
+    Ref(const Ref&) = delete;
+    Ref& operator=(const Ref&) = delete;
+};
+
+// Clears the pending Python exception and throws it as std::runtime_error
+[[noreturn]] void raise(const std::string& what) {
+    PyObject *type, *value, *trace;
+    PyErr_Fetch(&type, &value, &trace);
+    std::string text = what;
+    if (value) {
+        Ref str(PyObject_Str(value));
+        const char* s = str.p ? PyUnicode_AsUTF8(str.p) : nullptr;
+        if (s) text += std::string(": ") + s;
+    }
+    Py_XDECREF(type);
+    Py_XDECREF(value);
+    Py_XDECREF(trace);
+    PyErr_Clear();
+    throw std::runtime_error("PythonVolPredictor: " + text);
+}
+
+// Read-only 2-D float64 buffer over a FeatureMatrix that counts the
+// buffers it has handed out and not had back
+struct FeatureExporter {
+    PyObject_HEAD
+    const double* data;
+    Py_ssize_t shape[2];
+    Py_ssize_t strides[2];
+    Py_ssize_t exports;
+};
+
+char float64_format[] = "d";
+
+int exporter_getbuffer(PyObject* self, Py_buffer* view, int flags) {
+    if (flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "features are read-only");
+        view->obj = nullptr;
+        return -1;
+    }
+    FeatureExporter* e = reinterpret_cast<FeatureExporter*>(self);
+    view->obj = self;
+    Py_INCREF(self);
+    view->buf = const_cast<double*>(e->data);
+    view->len = e->shape[0] * e->shape[1] * static_cast<Py_ssize_t>(sizeof(double));
+    view->itemsize = sizeof(double);
+    view->readonly = 1;
+    view->ndim = 2;
+    view->format = (flags & PyBUF_FORMAT) ? float64_format : nullptr;
+    view->shape = (flags & PyBUF_ND) ? e->shape : nullptr;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? e->strides : nullptr;
+    view->suboffsets = nullptr;
+    view->internal = nullptr;
+    ++e->exports;
+    return 0;
+}
+
+void exporter_releasebuffer(PyObject* self, Py_buffer*) { --reinterpret_cast<FeatureExporter*>(self)->exports; }
+
+// New reference to an exporter over `features`; the GIL must be held.
+// Buffer slots in a type spec need Python 3.9
+PyObject* make_exporter(const FeatureMatrix& features) {
+    static PyObject* type = [] {
+        PyType_Slot slots[] = {{Py_bf_getbuffer, reinterpret_cast<void*>(exporter_getbuffer)},
+                               {Py_bf_releasebuffer, reinterpret_cast<void*>(exporter_releasebuffer)},
+                               {0, nullptr}};
+        PyType_Spec spec = {"aemps.FeatureMatrix", sizeof(FeatureExporter), 0, Py_TPFLAGS_DEFAULT, slots};
+        return PyType_FromSpec(&spec);
+    }();
+    if (!type) return nullptr;
+    FeatureExporter* e = PyObject_New(FeatureExporter, reinterpret_cast<PyTypeObject*>(type));
+    if (!e) return nullptr;
+    e->data = features.data;
+    e->shape[0] = static_cast<Py_ssize_t>(features.rows);
+    e->shape[1] = static_cast<Py_ssize_t>(features.cols);
+    e->strides[0] = static_cast<Py_ssize_t>(features.cols * sizeof(double));
+    e->strides[1] = static_cast<Py_ssize_t>(sizeof(double));
+    e->exports = 0;
+    return reinterpret_cast<PyObject*>(e);
+}
+
+// Native little- or machine-endian double, as numpy and array('d') report it
+bool is_float64(const char* format) {
+    if (!format) return false;
+    if (*format == '@' || *format == '=' || (*format == '<' && PY_LITTLE_ENDIAN)) ++format;
+    return std::strcmp(format, "d") == 0;
+}
+
+}
+
+PythonVolPredictor::PythonVolPredictor(const std::string& module, const std::string& function,
+                                       const std::string& search_path) {
+    ensure_interpreter();
+    Gil gil;
+    if (!search_path.empty()) {
+        PyObject* path = PySys_GetObject("path"); // borrowed
+        Ref entry(PyUnicode_FromString(search_path.c_str()));
+        if (!path || !entry.p || PyList_Insert(path, 0, entry.p) != 0) raise("cannot extend sys.path");
+    }
+    Ref mod(PyImport_ImportModule(module.c_str()));
+    if (!mod.p) raise("cannot import " + module);
+    PyObject* fn = PyObject_GetAttrString(mod.p, function.c_str());
+    if (!fn) raise("no " + module + "." + function);
+    if (!PyCallable_Check(fn)) {
+        Py_DECREF(fn);
+        throw std::runtime_error("PythonVolPredictor: " + module + "." + function + " is not callable");
+    }
+    callable_ = fn;
+}
+
+PythonVolPredictor::~PythonVolPredictor() {
+    if (!callable_ || !Py_IsInitialized()) return;
+    Gil gil;
+    Py_DECREF(static_cast<PyObject*>(callable_));
+}
+
+void PythonVolPredictor::predict(const FeatureMatrix& features, double* out) const {
+    if (features.rows == 0) return;
+    Gil gil;
+
+    // A memoryview over an exporter that counts its buffers: slices of
+    // the view share its buffer and outlive release(), so only an export
+    // count of zero afterwards proves Python let go of the caller's rows
+    Ref exporter(make_exporter(features));
+    if (!exporter.p) raise("cannot wrap features");
+    Ref mv(PyMemoryView_FromObject(exporter.p));
+    if (!mv.p) raise("cannot wrap features");
+    Ref result(PyObject_CallFunctionObjArgs(static_cast<PyObject*>(callable_), mv.p, nullptr));
+    if (!result.p) {
+        PyObject *type, *value, *trace;
+        PyErr_Fetch(&type, &value, &trace);
+        Ref released(PyObject_CallMethod(mv.p, "release", nullptr));
+        PyErr_Clear();
+        PyErr_Restore(type, value, trace);
+        raise("predict failed");
+    }
+    Ref released(PyObject_CallMethod(mv.p, "release", nullptr));
+    if (!released.p) raise("predict kept a reference to its features");
+    if (reinterpret_cast<FeatureExporter*>(exporter.p)->exports != 0)
+        throw std::runtime_error("PythonVolPredictor: predict kept a reference to its features");
+
+    if (PyObject_CheckBuffer(result.p)) {
+        Py_buffer b;
+        if (PyObject_GetBuffer(result.p, &b, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0) raise("unreadable result");
+        const bool ok = is_float64(b.format) && b.len == static_cast<Py_ssize_t>(features.rows * sizeof(double));
+        if (ok) std::memcpy(out, b.buf, features.rows * sizeof(double));
+        PyBuffer_Release(&b);
+        if (!ok) throw std::runtime_error("PythonVolPredictor: result must be rows float64 values");
+        return;
+    }
+    Ref seq(PySequence_Fast(result.p, "result is neither a buffer nor a sequence"));
+    if (!seq.p) raise("bad result");
+    if (PySequence_Fast_GET_SIZE(seq.p) != static_cast<Py_ssize_t>(features.rows))
+        throw std::runtime_error("PythonVolPredictor: result must hold one value per row");
+    PyObject** items = PySequence_Fast_ITEMS(seq.p);
+    for (std::size_t i = 0; i < features.rows; ++i) {
+        out[i] = PyFloat_AsDouble(items[i]);
+        if (out[i] == -1.0 && PyErr_Occurred()) raise("non-numeric result");
+    }
+}
+
+}
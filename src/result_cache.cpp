@@ -0,0 +1,79 @@
+#include "result_cache.h"
+#include <cmath>
+
+namespace aemps {
+
+namespace {
+
+// splitmix64 finaliser
+std::uint64_t mix(std::uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+std::uint64_t bits(double x) {
+    std::uint64_t b;
+    std::memcpy(&b, &x, sizeof b);
+    return b;
+}
+
+// Bits of x rounded to the nearest multiple of step, -0 folded into +0
+std::uint64_t quantise(double x, double step) {
+    return bits((step > 0.0 ? std::nearbyint(x / step) : x) + 0.0);
+}
+
+}
+
+std::uint64_t CacheKey::hash() const {
+    std::uint64_t h = 0;
+    for (std::uint64_t w : words) h = mix(h ^ w);
+    return h;
+}
+
+bool CacheKey::operator==(const CacheKey& other) const {
+    for (std::size_t k = 0; k < kWords; ++k)
+        if (words[k] != other.words[k]) return false;
+    return true;
+}
+
+CacheKey make_cache_key(std::uint64_t product, const Option& opt, double rate, double volatility,
+                        const CacheQuantum& quantum) {
+    CacheKey key;
+    key.words[0] = product;
+    key.words[1] = static_cast<std::uint64_t>(opt.type);
+    key.words[2] = quantise(opt.strike, quantum.strike);
+    key.words[3] = quantise(opt.maturity, quantum.maturity);
+    key.words[4] = quantise(opt.spot, quantum.spot);
+    key.words[5] = quantise(rate, quantum.rate);
+    key.words[6] = quantise(volatility, quantum.volatility);
+    return key;
+}
+
+std::uint64_t product_tag(const McConfig& config, std::uint64_t policies) {
+    // Every McConfig field that can change a result
+    const std::uint64_t fields[] = {config.paths,
+                                    config.steps,
+                                    config.seed,
+                                    config.block_size,
+                                    static_cast<std::uint64_t>(config.variance_reduction),
+                                    config.greeks ? 1u : 0u,
+                                    static_cast<std::uint64_t>(config.greek_method),
+                                    bits(config.target_std_error),
+                                    config.adaptive_round,
+                                    static_cast<std::uint64_t>(config.precision),
+                                    policies};
+    std::uint64_t h = 0x4D43434F4E464947ULL;
+    for (std::uint64_t f : fields) h = mix(h ^ f);
+    return h;
+}
+
+Greeks cached_greeks(ResultCache<Greeks>& cache, const Option& opt, double rate, double volatility,
+                     const CacheQuantum& quantum) {
+    const CacheKey key = make_cache_key(kBlackScholesTag, opt, rate, volatility, quantum);
+    return cache.get_or_compute(key, [&] { return BlackScholes::greeks(opt, rate, volatility); });
+}
+
+}
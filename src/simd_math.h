@@ -0,0 +1,484 @@
+#pragma once
+// Vector math shared by the per-ISA kernel translation units. Each TU defines
+// AEMPS_SIMD_NS and AEMPS_SIMD_WIDTH (doubles per vector) before including
+// this header and is compiled with its own target flags, so everything here
+// lives in that TU's namespace and only relies on compiler builtins and
+// intrinsics: a shared inline library function instantiated with AVX-512
+// flags could otherwise be picked by the linker for every caller.
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace aemps {
+namespace detail {
+namespace AEMPS_SIMD_NS {
+
+constexpr int W = AEMPS_SIMD_WIDTH;
+
+// Kernels only pay off fully inlined: vector arguments of out-of-line
+// helpers travel through memory
+#define AEMPS_SIMD_INLINE inline __attribute__((always_inline))
+
+typedef double vd __attribute__((vector_size(W * sizeof(double))));
+typedef long long vi __attribute__((vector_size(W * sizeof(long long))));
+typedef unsigned long long vu __attribute__((vector_size(W * sizeof(long long))));
+
+AEMPS_SIMD_INLINE vd splat(double x) { return vd{} + x; }
+
+AEMPS_SIMD_INLINE vd load(const double* p) {
+    vd v;
+    __builtin_memcpy(&v, p, sizeof v);
+    return v;
+}
+
+AEMPS_SIMD_INLINE void store(double* p, vd v) { __builtin_memcpy(p, &v, sizeof v); }
+
+// Partial load/store for loop tails; missing lanes take `fill`
+AEMPS_SIMD_INLINE vd load_n(const double* p, std::size_t n, double fill) {
+    vd v = splat(fill);
+    for (std::size_t j = 0; j < n; ++j) v[j] = p[j];
+    return v;
+}
+
+AEMPS_SIMD_INLINE void store_n(double* p, vd v, std::size_t n) {
+    for (std::size_t j = 0; j < n; ++j) p[j] = v[j];
+}
+
+AEMPS_SIMD_INLINE vu splat_u(unsigned long long x) { return vu{} + x; }
+
+// {0, 1, ..., W - 1}
+AEMPS_SIMD_INLINE vu iota_u() {
+    vu v = splat_u(0);
+    for (int j = 0; j < W; ++j) v[j] = static_cast<unsigned long long>(j);
+    return v;
+}
+
+AEMPS_SIMD_INLINE vu as_u(vd x) { return (vu)x; }
+AEMPS_SIMD_INLINE vd as_d(vu x) { return (vd)x; }
+
+AEMPS_SIMD_INLINE vd vmin(vd a, vd b) { return a < b ? a : b; }
+AEMPS_SIMD_INLINE vd vmax(vd a, vd b) { return a > b ? a : b; }
+AEMPS_SIMD_INLINE vd vabs(vd x) { return as_d(as_u(x) & 0x7FFFFFFFFFFFFFFFULL); }
+
+AEMPS_SIMD_INLINE bool any(vi m) {
+    long long r = 0;
+    for (int j = 0; j < W; ++j) r |= m[j];
+    return r != 0;
+}
+
+AEMPS_SIMD_INLINE bool all(vi m) {
+    long long r = -1;
+    for (int j = 0; j < W; ++j) r &= m[j];
+    return r != 0;
+}
+
+AEMPS_SIMD_INLINE vd vsqrt(vd x) {
+#if AEMPS_SIMD_WIDTH == 8 && defined(__AVX512F__)
+    // masked form: the unmasked one trips GCC 12's uninitialized warning
+    return (vd)_mm512_mask_sqrt_pd((__m512d)x, (__mmask8)0xFF, (__m512d)x);
+#elif AEMPS_SIMD_WIDTH == 4 && defined(__AVX__)
+    return (vd)_mm256_sqrt_pd((__m256d)x);
+#elif AEMPS_SIMD_WIDTH == 2 && defined(__SSE2__)
+    return (vd)_mm_sqrt_pd((__m128d)x);
+#elif AEMPS_SIMD_WIDTH == 2 && defined(__aarch64__)
+    return (vd)vsqrtq_f64((float64x2_t)x);
+#else
+    for (int j = 0; j < W; ++j) x[j] = __builtin_sqrt(x[j]);
+    return x;
+#endif
+}
+
+// Low 32 bits of every lane times a 32-bit constant, full 64-bit product
+AEMPS_SIMD_INLINE vu vmul32(vu a, unsigned c) {
+#if AEMPS_SIMD_WIDTH == 8 && defined(__AVX512F__)
+    return (vu)_mm512_mask_mul_epu32((__m512i)a, (__mmask8)0xFF, (__m512i)a, (__m512i)splat_u(c));
+#elif AEMPS_SIMD_WIDTH == 4 && defined(__AVX2__)
+    return (vu)_mm256_mul_epu32((__m256i)a, (__m256i)splat_u(c));
+#elif AEMPS_SIMD_WIDTH == 2 && defined(__SSE2__)
+    return (vu)_mm_mul_epu32((__m128i)a, (__m128i)splat_u(c));
+#elif AEMPS_SIMD_WIDTH == 2 && defined(__aarch64__)
+    return (vu)vmull_u32(vmovn_u64((uint64x2_t)a), vdup_n_u32(c));
+#else
+    return (a & 0xFFFFFFFFULL) * static_cast<unsigned long long>(c);
+#endif
+}
+
+// exp: Cody-Waite reduction x = n ln2 + r, |r| <= ln2/2, degree 13 Taylor
+// polynomial, 2^n folded straight into the exponent bits. Flushes to 0
+// below -708 and saturates to +inf above 709.
+AEMPS_SIMD_INLINE vd vexp(vd x) {
+    const double magic = 6755399441055744.0; // 1.5 * 2^52, rounds to integer
+    const vd xc = vmin(vmax(x, splat(-708.0)), splat(709.0));
+    const vd t = xc * 1.44269504088896340736 + magic;
+    const vd n = t - magic;
+    const vd r = (xc - n * 6.93147180369123816490e-01) - n * 1.90821492927058770002e-10;
+    vd p = splat(1.0 / 6227020800.0);
+    p = p * r + 1.0 / 479001600.0;
+    p = p * r + 1.0 / 39916800.0;
+    p = p * r + 1.0 / 3628800.0;
+    p = p * r + 1.0 / 362880.0;
+    p = p * r + 1.0 / 40320.0;
+    p = p * r + 1.0 / 5040.0;
+    p = p * r + 1.0 / 720.0;
+    p = p * r + 1.0 / 120.0;
+    p = p * r + 1.0 / 24.0;
+    p = p * r + 1.0 / 6.0;
+    p = p * r + 0.5;
+    p = p * r + 1.0;
+    p = p * r + 1.0;
+    const vu k = as_u(t) - as_u(splat(magic));
+    vd y = as_d(as_u(p) + (k << 52));
+    y = x < -708.0 ? splat(0.0) : y;
+    y = x > 709.0 ? splat(__builtin_inf()) : y;
+    return y;
+}
+
+// log for positive normal inputs: split x = 2^e m with m in [sqrt(1/2), sqrt(2)),
+// then log m = 2 atanh(s), s = (m - 1) / (m + 1), |s| <= 0.1716
+AEMPS_SIMD_INLINE vd vlog(vd x) {
+    const vu bits = as_u(x);
+    vd m = as_d((bits & 0x000FFFFFFFFFFFFFULL) | 0x3FF0000000000000ULL);
+    vd e = as_d((bits >> 52) | 0x4330000000000000ULL) - (4503599627370496.0 + 1023.0);
+    const vi big = m > 1.41421356237309504880;
+    m = big ? m * 0.5 : m;
+    e = big ? e + 1.0 : e;
+    const vd s = (m - 1.0) / (m + 1.0);
+    const vd s2 = s * s;
+    vd q = splat(1.0 / 21.0);
+    q = q * s2 + 1.0 / 19.0;
+    q = q * s2 + 1.0 / 17.0;
+    q = q * s2 + 1.0 / 15.0;
+    q = q * s2 + 1.0 / 13.0;
+    q = q * s2 + 1.0 / 11.0;
+    q = q * s2 + 1.0 / 9.0;
+    q = q * s2 + 1.0 / 7.0;
+    q = q * s2 + 1.0 / 5.0;
+    q = q * s2 + 1.0 / 3.0;
+    q = q * s2;
+    const vd twos = s + s;
+    return e * 6.93147180369123816490e-01 + (twos + (twos * q + e * 1.90821492927058770002e-10));
+}
+
+// sin and cos together: x = j pi/2 + r by a three-part Cody-Waite split,
+// good to full precision for |x| up to about 1e6, then the Cephes
+// polynomials on |r| <= pi/4 and a quadrant swap
+AEMPS_SIMD_INLINE void vsincos(vd x, vd* sin_out, vd* cos_out) {
+    const double magic = 6755399441055744.0;
+    const vd t = x * 0.636619772367581343076 + magic;
+    const vd j = t - magic;
+    const vd r = ((x - j * 1.57079632673412561417e+00) - j * 6.07710050630396597660e-11) -
+                 j * 2.02226624879595063154e-21;
+    const vd z = r * r;
+    vd ps = z * 1.58962301576546568060e-10 - 2.50507477628578072866e-8;
+    ps = ps * z + 2.75573136213857245213e-6;
+    ps = ps * z - 1.98412698295895385996e-4;
+    ps = ps * z + 8.33333333332211858878e-3;
+    ps = ps * z - 1.66666666666666307295e-1;
+    const vd sn = r + r * z * ps;
+    vd pc = z * -1.13585365213876817300e-11 + 2.08757008419747316778e-9;
+    pc = pc * z - 2.75573141792967388112e-7;
+    pc = pc * z + 2.48015872888517045348e-5;
+    pc = pc * z - 1.38888888888730564116e-3;
+    pc = pc * z + 4.16666666666665929218e-2;
+    const vd cs = 1.0 - 0.5 * z + z * z * pc;
+    const vu q = as_u(t) - as_u(splat(magic));
+    const vi odd = (vi)((q & 1ULL) != 0ULL);
+    const vi sin_neg = (vi)((q & 2ULL) != 0ULL);
+    const vi cos_neg = (vi)(((q + 1ULL) & 2ULL) != 0ULL);
+    const vd s = odd ? cs : sn;
+    const vd c = odd ? sn : cs;
+    *sin_out = sin_neg ? -s : s;
+    *cos_out = cos_neg ? -c : c;
+}
+
+// atan2 from atan of min(|x|, |y|) / max(|x|, |y|) in [0, 1], reduced to
+// |t| <= 0.66 around pi/4 and evaluated by the Cephes rational; 0 where
+// x = y = 0
+AEMPS_SIMD_INLINE vd vatan2(vd y, vd x) {
+    const vd ax = vabs(x), ay = vabs(y);
+    const vd hi = vmax(ax, ay), lo = vmin(ax, ay);
+    const vi live = hi > 0.0;
+    vd t = lo / (live ? hi : splat(1.0));
+    const vi upper = t > 0.66;
+    t = upper ? (t - 1.0) / (t + 1.0) : t;
+    const vd z = t * t;
+    vd p = z * -8.750608600031904122785e-1 - 1.615753718733365076637e1;
+    p = p * z - 7.500855792314704667340e1;
+    p = p * z - 1.228866684490136173410e2;
+    p = p * z - 6.485021904942025371773e1;
+    vd q = z + 2.485846490142306297962e1;
+    q = q * z + 1.650270098316988542046e2;
+    q = q * z + 4.328810604912902668951e2;
+    q = q * z + 4.853903996359136964868e2;
+    q = q * z + 1.945506571482613964425e2;
+    vd a = t + t * z * p / q;
+    a = upper ? a + (0.785398163397448309616 + 3.061616997868382943065e-17) : a;
+    a = ay > ax ? 1.57079632679489661923 - a + 6.123233995736765886130e-17 : a;
+    a = x < 0.0 ? 3.14159265358979323846 - a + 1.224646799147353177226e-16 : a;
+    a = live ? a : splat(0.0);
+    return as_d(as_u(a) | (as_u(y) & 0x8000000000000000ULL));
+}
+
+// Standard normal CDF, Hart (1968) double precision rational as given by
+// West (2005), with the continued fraction tail beyond 5 sqrt(2).
+// Also returns exp(-x^2/2) so callers can rebuild the density for free.
+AEMPS_SIMD_INLINE vd vnorm_cdf(vd x, vd* gauss = nullptr) {
+    const vd ax = vabs(x);
+    const vd e = vexp(-0.5 * ax * ax);
+    vd num = ax * 3.52624965998911e-02 + 0.700383064443688;
+    num = num * ax + 6.37396220353165;
+    num = num * ax + 33.912866078383;
+    num = num * ax + 112.079291497871;
+    num = num * ax + 221.213596169931;
+    num = num * ax + 220.206867912376;
+    vd den = ax * 8.83883476483184e-02 + 1.75566716318264;
+    den = den * ax + 16.064177579207;
+    den = den * ax + 86.7807322029461;
+    den = den * ax + 296.564248779674;
+    den = den * ax + 637.333633378831;
+    den = den * ax + 793.826512519948;
+    den = den * ax + 440.413735824752;
+    vd tail = e * num / den;
+    const vi far = ax >= 7.07106781186547;
+    if (any(far)) {
+        vd cf = ax + 0.65;
+        cf = ax + 4.0 / cf;
+        cf = ax + 3.0 / cf;
+        cf = ax + 2.0 / cf;
+        cf = ax + 1.0 / cf;
+        tail = far ? e / cf * 0.398942280401432677939946059934 : tail;
+    }
+    tail = ax > 37.0 ? splat(0.0) : tail;
+    if (gauss) *gauss = e;
+    return x > 0.0 ? 1.0 - tail : tail;
+}
+
+// Inverse standard normal CDF, Wichura AS241 (PPND16). Inputs in (0, 1).
+// The tail rational is only evaluated when some lane needs it.
+AEMPS_SIMD_INLINE vd vnorm_inv(vd p) {
+    const vd q = p - 0.5;
+    const vd r = 0.180625 - q * q;
+    vd num = r * 2509.0809287301226727 + 33430.575583588128105;
+    num = num * r + 67265.770927008700853;
+    num = num * r + 45921.953931549871457;
+    num = num * r + 13731.693765509461125;
+    num = num * r + 1971.5909503065514427;
+    num = num * r + 133.14166789178437745;
+    num = num * r + 3.387132872796366608;
+    vd den = r * 5226.495278852545925 + 28729.085735721942674;
+    den = den * r + 39307.89580009271061;
+    den = den * r + 21213.794301586595867;
+    den = den * r + 5394.1960214247511077;
+    den = den * r + 687.1870074920579083;
+    den = den * r + 42.313330701600911252;
+    den = den * r + 1.0;
+    vd val = q * num / den;
+    const vi tail = vabs(q) > 0.425;
+    if (!any(tail)) return val;
+
+    const vi lower = q < 0.0;
+    const vd t = vsqrt(-vlog(lower ? p : 1.0 - p));
+    const vd u = t - 1.6;
+    vd tn = u * 7.7454501427834140764e-4 + 0.0227238449892691845833;
+    tn = tn * u + 0.24178072517745061177;
+    tn = tn * u + 1.27045825245236838258;
+    tn = tn * u + 3.64784832476320460504;
+    tn = tn * u + 5.7694972214606914055;
+    tn = tn * u + 4.6303378461565452959;
+    tn = tn * u + 1.42343711074968357734;
+    vd td = u * 1.05075007164441684324e-9 + 5.475938084995344946e-4;
+    td = td * u + 0.0151986665636164571966;
+    td = td * u + 0.14810397642748007459;
+    td = td * u + 0.68976733498510000455;
+    td = td * u + 1.6763848301838038494;
+    td = td * u + 2.05319162663775882187;
+    td = td * u + 1.0;
+    vd tv = tn / td;
+    const vi far = t > 5.0;
+    if (any(far & tail)) {
+        const vd w = t - 5.0;
+        vd fn = w * 2.01033439929228813265e-7 + 2.71155556874348757815e-5;
+        fn = fn * w + 0.0012426609473880784386;
+        fn = fn * w + 0.026532189526576123093;
+        fn = fn * w + 0.29656057182850489123;
+        fn = fn * w + 1.7848265399172913358;
+        fn = fn * w + 5.4637849111641143699;
+        fn = fn * w + 6.6579046435011037772;
+        vd fd = w * 2.04426310338993978564e-15 + 1.4215117583164458887e-7;
+        fd = fd * w + 1.8463183175100546818e-5;
+        fd = fd * w + 7.868691311456132591e-4;
+        fd = fd * w + 0.0148753612908506148525;
+        fd = fd * w + 0.13692988092273580531;
+        fd = fd * w + 0.59983220655588793769;
+        fd = fd * w + 1.0;
+        tv = far ? fn / fd : tv;
+    }
+    tv = lower ? -tv : tv;
+    return tail ? tv : val;
+}
+
+
+// Single precision: vectors of the same width hold 2W floats. Inputs and
+// outputs stay double; load_f/store_f convert at the edges, so callers keep
+// their double arrays and only the arithmetic in between narrows.
+constexpr int WF = 2 * W;
+
+typedef float vf __attribute__((vector_size(W * sizeof(double))));
+typedef int vfi __attribute__((vector_size(W * sizeof(double))));
+typedef unsigned vfu __attribute__((vector_size(W * sizeof(double))));
+typedef double vdw __attribute__((vector_size(WF * sizeof(double)))); // WF doubles, two vd
+
+AEMPS_SIMD_INLINE vf splat_f(float x) { return vf{} + x; }
+
+AEMPS_SIMD_INLINE vf load_f(const double* p) {
+    vdw v;
+    __builtin_memcpy(&v, p, sizeof v);
+    return __builtin_convertvector(v, vf);
+}
+
+AEMPS_SIMD_INLINE void store_f(double* p, vf v) {
+    const vdw d = __builtin_convertvector(v, vdw);
+    __builtin_memcpy(p, &d, sizeof d);
+}
+
+AEMPS_SIMD_INLINE vf load_f_n(const double* p, std::size_t n, float fill) {
+    vf v = splat_f(fill);
+    for (std::size_t j = 0; j < n; ++j) v[j] = static_cast<float>(p[j]);
+    return v;
+}
+
+AEMPS_SIMD_INLINE void store_f_n(double* p, vf v, std::size_t n) {
+    for (std::size_t j = 0; j < n; ++j) p[j] = v[j];
+}
+
+AEMPS_SIMD_INLINE vfu as_u(vf x) { return (vfu)x; }
+AEMPS_SIMD_INLINE vf as_f(vfu x) { return (vf)x; }
+
+AEMPS_SIMD_INLINE vf vmin(vf a, vf b) { return a < b ? a : b; }
+AEMPS_SIMD_INLINE vf vmax(vf a, vf b) { return a > b ? a : b; }
+AEMPS_SIMD_INLINE vf vabs(vf x) { return as_f(as_u(x) & 0x7FFFFFFFU); }
+
+AEMPS_SIMD_INLINE bool any(vfi m) {
+    int r = 0;
+    for (int j = 0; j < WF; ++j) r |= m[j];
+    return r != 0;
+}
+
+AEMPS_SIMD_INLINE vf vsqrt(vf x) {
+#if AEMPS_SIMD_WIDTH == 8 && defined(__AVX512F__)
+    return (vf)_mm512_mask_sqrt_ps((__m512)x, (__mmask16)0xFFFF, (__m512)x);
+#elif AEMPS_SIMD_WIDTH == 4 && defined(__AVX__)
+    return (vf)_mm256_sqrt_ps((__m256)x);
+#elif AEMPS_SIMD_WIDTH == 2 && defined(__SSE2__)
+    return (vf)_mm_sqrt_ps((__m128)x);
+#elif AEMPS_SIMD_WIDTH == 2 && defined(__aarch64__)
+    return (vf)vsqrtq_f32((float32x4_t)x);
+#else
+    for (int j = 0; j < WF; ++j) x[j] = __builtin_sqrtf(x[j]);
+    return x;
+#endif
+}
+
+// Single-precision exp, Cephes expf: x = n ln2 + r, degree 7 polynomial.
+// Flushes to 0 below -86, where 2^n would leave the normal range, and
+// saturates to +inf above 88.
+AEMPS_SIMD_INLINE vf vexpf(vf x) {
+    const float magic = 12582912.0f; // 1.5 * 2^23
+    const vf xc = vmin(vmax(x, splat_f(-86.0f)), splat_f(88.0f));
+    const vf t = xc * 1.44269504f + magic;
+    const vf n = t - magic;
+    const vf r = (xc - n * 0.693359375f) + n * 2.12194440e-4f;
+    vf p = splat_f(1.9875691500e-4f);
+    p = p * r + 1.3981999507e-3f;
+    p = p * r + 8.3334519073e-3f;
+    p = p * r + 4.1665795894e-2f;
+    p = p * r + 1.6666665459e-1f;
+    p = p * r + 5.0000001201e-1f;
+    p = p * (r * r) + r + 1.0f;
+    const vfu k = as_u(t) - as_u(splat_f(magic));
+    vf y = as_f(as_u(p) + (k << 23));
+    y = x < -86.0f ? splat_f(0.0f) : y;
+    y = x > 88.0f ? splat_f(__builtin_inff()) : y;
+    return y;
+}
+
+// Single-precision log for positive normal inputs, as vlog with the
+// series cut at s^9
+AEMPS_SIMD_INLINE vf vlogf(vf x) {
+    const vfu bits = as_u(x);
+    vf m = as_f((bits & 0x007FFFFFU) | 0x3F800000U);
+    vf e = as_f((bits >> 23) | 0x4B000000U) - (8388608.0f + 127.0f);
+    const vfi big = m > 1.41421356f;
+    m = big ? m * 0.5f : m;
+    e = big ? e + 1.0f : e;
+    const vf s = (m - 1.0f) / (m + 1.0f);
+    const vf s2 = s * s;
+    vf q = splat_f(1.0f / 9.0f);
+    q = q * s2 + 1.0f / 7.0f;
+    q = q * s2 + 1.0f / 5.0f;
+    q = q * s2 + 1.0f / 3.0f;
+    q = q * s2;
+    const vf twos = s + s;
+    return e * 0.693359375f + (twos + (twos * q - e * 2.12194440e-4f));
+}
+
+// Standard normal CDF in single precision: vnorm_cdf's rational and tail,
+// evaluated in float. Also returns exp(-x^2/2).
+AEMPS_SIMD_INLINE vf vnorm_cdf(vf x, vf* gauss = nullptr) {
+    const vf ax = vabs(x);
+    const vf e = vexpf(-0.5f * ax * ax);
+    vf num = ax * 3.52624965998911e-02f + 0.700383064443688f;
+    num = num * ax + 6.37396220353165f;
+    num = num * ax + 33.912866078383f;
+    num = num * ax + 112.079291497871f;
+    num = num * ax + 221.213596169931f;
+    num = num * ax + 220.206867912376f;
+    vf den = ax * 8.83883476483184e-02f + 1.75566716318264f;
+    den = den * ax + 16.064177579207f;
+    den = den * ax + 86.7807322029461f;
+    den = den * ax + 296.564248779674f;
+    den = den * ax + 637.333633378831f;
+    den = den * ax + 793.826512519948f;
+    den = den * ax + 440.413735824752f;
+    vf tail = e * num / den;
+    const vfi far = ax >= 7.07106781f;
+    if (any(far)) {
+        vf cf = ax + 0.65f;
+        cf = ax + 4.0f / cf;
+        cf = ax + 3.0f / cf;
+        cf = ax + 2.0f / cf;
+        cf = ax + 1.0f / cf;
+        tail = far ? e / cf * 0.398942280f : tail;
+    }
+    if (gauss) *gauss = e;
+    return x > 0.0f ? 1.0f - tail : tail;
+}
+
+// Inverse standard normal CDF in single precision, Wichura AS241 (PPND7),
+// good to about 1e-7. Inputs in [2^-24, 1 - 2^-24], which keeps
+// sqrt(-log p) below 5 and the far-tail rational out of the picture.
+AEMPS_SIMD_INLINE vf vnorm_inv(vf p) {
+    const vf q = p - 0.5f;
+    const vf r = 0.180625f - q * q;
+    const vf num = ((r * 59.109374720f + 159.29113202f) * r + 50.434271938f) * r + 3.3871327179f;
+    const vf den = ((r * 67.187563600f + 78.757757664f) * r + 17.895169469f) * r + 1.0f;
+    const vf val = q * num / den;
+    const vfi tail = vabs(q) > 0.425f;
+    if (!any(tail)) return val;
+
+    const vfi lower = q < 0.0f;
+    const vf u = vsqrt(-vlogf(lower ? p : 1.0f - p)) - 1.6f;
+    const vf tn = ((u * 0.17023821103f + 1.3067284816f) * u + 2.7568153900f) * u + 1.4234372777f;
+    const vf td = (u * 0.12021132975f + 0.73700164250f) * u + 1.0f;
+    const vf tv = tn / td;
+    return tail ? (lower ? -tv : tv) : val;
+}
+
+}
+}
+}
@@ -0,0 +1,119 @@
+#include "rng.h"
+#include <stdexcept>
+#include <vector>
+
+namespace aemps {
+
+namespace {
+
+constexpr int kBits = 32;
+
+// Carry-less product modulo the GF(2) polynomial p of degree s
+std::uint32_t mulmod(std::uint32_t a, std::uint32_t b, std::uint32_t p, int s) {
+    std::uint32_t r = 0;
+    for (; b; b >>= 1) {
+        if (b & 1) r ^= a;
+        a <<= 1;
+        if (a >> s & 1) a ^= p;
+    }
+    return r;
+}
+
+std::uint32_t powmod(std::uint32_t e, std::uint32_t p, int s) {
+    std::uint32_t r = 1, base = 2; // the polynomial x
+    for (; e; e >>= 1) {
+        if (e & 1) r = mulmod(r, base, p, s);
+        base = mulmod(base, base, p, s);
+    }
+    return r;
+}
+
+// p is primitive iff x has multiplicative order exactly 2^s - 1 modulo p
+bool is_primitive(std::uint32_t p, int s) {
+    const std::uint32_t order = (1u << s) - 1;
+    if (powmod(order, p, s) != 1) return false;
+    std::uint32_t n = order;
+    for (std::uint32_t q = 2; q * q <= n; ++q) {
+        if (n % q) continue;
+        while (n % q == 0) n /= q;
+        if (powmod(order / q, p, s) == 1) return false;
+    }
+    return n == 1 || powmod(order / n, p, s) != 1;
+}
+
+std::uint64_t splitmix64(std::uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// kBits direction numbers per dimension, dimension-major
+std::vector<std::uint32_t> build_directions() {
+    std::vector<std::uint32_t> v(SobolRng::max_dimensions * kBits);
+    for (int k = 0; k < kBits; ++k) v[k] = 1u << (kBits - 1 - k); // van der Corput
+    std::size_t dim = 1;
+    for (int s = 1; dim < SobolRng::max_dimensions; ++s) {
+        for (std::uint32_t a = 0; a < (1u << (s - 1)) && dim < SobolRng::max_dimensions; ++a) {
+            const std::uint32_t poly = (1u << s) | (a << 1) | 1u;
+            if (!is_primitive(poly, s)) continue;
+            std::uint32_t m[kBits + 1];
+            for (int k = 1; k <= s && k <= kBits; ++k) {
+                // odd initial value below 2^k
+                const std::uint64_t r = splitmix64(dim * 64 + static_cast<std::uint64_t>(k));
+                m[k] = k == 1 ? 1u : static_cast<std::uint32_t>((r % (1ULL << (k - 1))) * 2 + 1);
+            }
+            for (int k = s + 1; k <= kBits; ++k) {
+                m[k] = m[k - s] ^ (m[k - s] << s);
+                for (int j = 1; j < s; ++j)
+                    if (a >> (s - 1 - j) & 1) m[k] ^= m[k - j] << j;
+            }
+            for (int k = 1; k <= kBits; ++k) v[dim * kBits + k - 1] = m[k] << (kBits - k);
+            ++dim;
+        }
+    }
+    return v;
+}
+
+const std::uint32_t* directions(std::size_t dim) {
+    static const std::vector<std::uint32_t> table = build_directions();
+    return &table[dim * kBits];
+}
+
+std::uint32_t reverse_bits(std::uint32_t x) {
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+    x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+// Burley, "Practical Hash-based Owen Scrambling" (JCGT 2020)
+std::uint32_t owen_scramble(std::uint32_t x, std::uint32_t seed) {
+    x = reverse_bits(x);
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return reverse_bits(x);
+}
+
+}
+
+void SobolRng::normals(std::uint64_t first_path, std::size_t count, std::size_t dim, double* out) const {
+    if (dim >= max_dimensions) throw std::out_of_range("SobolRng: dimension exceeds max_dimensions");
+    if (count && first_path + count - 1 > 0xFFFFFFFFULL) throw std::out_of_range("SobolRng: point index beyond 2^32");
+    const std::uint32_t* v = directions(dim);
+    const std::uint32_t scramble = static_cast<std::uint32_t>(splitmix64(seed_ ^ splitmix64(dim)));
+    for (std::size_t i = 0; i < count; ++i) {
+        std::uint32_t index = static_cast<std::uint32_t>(first_path + i);
+        std::uint32_t x = 0;
+        for (int k = 0; index; ++k, index >>= 1)
+            if (index & 1) x ^= v[k];
+        out[i] = (static_cast<double>(owen_scramble(x, scramble)) + 0.5) * 0x1.0p-32;
+    }
+    norm_inv_array(out, out, count);
+}
+
+}
@@ -0,0 +1,283 @@
+#include "stream_pricer.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <unistd.h>
+#include "black_scholes.h"
+#include "option.h"
+#include "spsc_queue.h"
+#include "utils.h"
+
+namespace aemps {
+
+namespace {
+
+struct Batch {
+    std::uint64_t seq = 0;
+    OptionBook book;
+    std::string ids;                   // id fields back to back
+    std::vector<std::uint32_t> id_end; // end of each id in `ids`
+    std::vector<const char*> error;    // null for a well-formed record
+    AlignedVector<double> price, delta, gamma, vega, theta, rho;
+    std::string text;                  // formatted result lines
+
+    void clear() {
+        book.clear();
+        ids.clear();
+        id_end.clear();
+        error.clear();
+    }
+    std::size_t size() const { return id_end.size(); }
+};
+
+bool parse_double(const char* first, const char* last, double& out) {
+#if defined(__cpp_lib_to_chars)
+    const std::from_chars_result r = std::from_chars(first, last, out);
+    return r.ec == std::errc() && r.ptr == last;
+#else
+    const std::string field(first, last);
+    char* end = nullptr;
+    out = std::strtod(field.c_str(), &end);
+    return !field.empty() && end == field.c_str() + field.size();
+#endif
+}
+
+void append_double(std::string& s, double x) {
+    char buf[32];
+#if defined(__cpp_lib_to_chars)
+    const std::to_chars_result r = std::to_chars(buf, buf + sizeof buf, x);
+    s.append(buf, r.ptr);
+#else
+    s.append(buf, static_cast<std::size_t>(std::snprintf(buf, sizeof buf, "%.17g", x)));
+#endif
+}
+
+// Case-insensitive match of [first, last) against lower-case `word`
+bool is_word(const char* first, const char* last, const char* word) {
+    for (; first != last; ++first, ++word)
+        if (*word == '\0' || (*first | 0x20) != *word) return false;
+    return *word == '\0';
+}
+
+// Parses one record into the batch; malformed records still take a row so
+// result lines stay aligned with input lines
+void parse_line(const char* line, const char* end, Batch& b) {
+    const char* field[8];
+    const char* field_end[8];
+    std::size_t count = 0;
+    const char* p = line;
+    for (;;) {
+        const char* comma = static_cast<const char*>(std::memchr(p, ',', static_cast<std::size_t>(end - p)));
+        const char* stop = comma ? comma : end;
+        if (count < 8) {
+            field[count] = p;
+            field_end[count] = stop;
+        }
+        ++count;
+        if (!comma) break;
+        p = comma + 1;
+    }
+
+    b.ids.append(field[0], field_end[0]);
+    b.id_end.push_back(static_cast<std::uint32_t>(b.ids.size()));
+    const char* error = nullptr;
+    OptionType type = OptionType::Call;
+    double v[5] = {1.0, 1.0, 1.0, 0.0, 0.0}; // strike, maturity, spot, vol, rate
+    if (count != 7) {
+        error = "expected 7 fields";
+    } else {
+        if (is_word(field[1], field_end[1], "c") || is_word(field[1], field_end[1], "call")) {
+            type = OptionType::Call;
+        } else if (is_word(field[1], field_end[1], "p") || is_word(field[1], field_end[1], "put")) {
+            type = OptionType::Put;
+        } else {
+            error = "bad option type";
+        }
+        for (std::size_t i = 0; i < 5 && !error; ++i)
+            if (!parse_double(field[i + 2], field_end[i + 2], v[i])) error = "bad number";
+    }
+    if (error) {
+        type = OptionType::Call;
+        v[0] = v[1] = v[2] = 1.0;
+        v[3] = v[4] = 0.0;
+    }
+    b.book.push_back(Option(type, v[0], v[1], v[2]), v[3], v[4]);
+    b.error.push_back(error);
+}
+
+void price_batch(Batch& b, bool greeks, Precision precision) {
+    const std::size_t n = b.size();
+    b.price.resize(n);
+    if (greeks) {
+        b.delta.resize(n);
+        b.gamma.resize(n);
+        b.vega.resize(n);
+        b.theta.resize(n);
+        b.rho.resize(n);
+        GreeksOutput out;
+        out.price = b.price.data();
+        out.delta = b.delta.data();
+        out.gamma = b.gamma.data();
+        out.vega = b.vega.data();
+        out.theta = b.theta.data();
+        out.rho = b.rho.data();
+        BlackScholes::greeks(b.book.view(), out);
+    } else {
+        BlackScholes::price(b.book.view(), b.price.data(), precision);
+    }
+
+    b.text.clear();
+    std::uint32_t id_start = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        b.text.append(b.ids, id_start, b.id_end[i] - id_start);
+        id_start = b.id_end[i];
+        if (b.error[i]) {
+            b.text += ",ERR,";
+            b.text += b.error[i];
+        } else {
+            const AlignedVector<double>* cols[6] = {&b.price, &b.delta, &b.gamma, &b.vega, &b.theta, &b.rho};
+            for (std::size_t c = 0; c < (greeks ? 6u : 1u); ++c) {
+                b.text += ',';
+                append_double(b.text, (*cols[c])[i]);
+            }
+        }
+        b.text += '\n';
+    }
+}
+
+bool write_all(int fd, const char* p, std::size_t bytes) {
+    while (bytes > 0) {
+        const ssize_t n = ::write(fd, p, bytes);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        bytes -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+// True when a read on fd would not block
+bool readable(int fd) {
+    pollfd p{fd, POLLIN, 0};
+    return ::poll(&p, 1, 0) > 0;
+}
+
+}
+
+StreamStats run_stream(int in_fd, int out_fd, const StreamConfig& config) {
+    std::size_t workers = config.workers;
+    if (workers == 0) {
+        const std::size_t hw = std::thread::hardware_concurrency();
+        workers = hw > 3 ? hw - 2 : 1;
+    }
+    const std::size_t depth = std::max<std::size_t>(config.queue_depth, 1);
+    const std::size_t batch_size = std::max<std::size_t>(config.batch_size, 1);
+
+    // Every batch in flight comes from this pool; the writer hands them back
+    std::vector<std::unique_ptr<Batch>> pool(workers * depth * 2 + 2);
+    SpscQueue<Batch*> free_batches(pool.size());
+    for (auto& b : pool) {
+        b = std::make_unique<Batch>();
+        b->book.reserve(batch_size);
+        Batch* raw = b.get();
+        free_batches.push(raw);
+    }
+    std::vector<std::unique_ptr<SpscQueue<Batch*>>> to_worker, to_writer;
+    for (std::size_t w = 0; w < workers; ++w) {
+        to_worker.push_back(std::make_unique<SpscQueue<Batch*>>(depth));
+        to_writer.push_back(std::make_unique<SpscQueue<Batch*>>(depth));
+    }
+
+    StreamStats stats;
+    std::atomic<bool> write_failed{false};
+
+    std::vector<std::thread> threads;
+    for (std::size_t w = 0; w < workers; ++w) {
+        threads.emplace_back([&, w] {
+            Batch* b;
+            while (to_worker[w]->pop(b)) {
+                price_batch(*b, config.greeks, config.precision);
+                to_writer[w]->push(b);
+            }
+            to_writer[w]->close();
+        });
+    }
+    threads.emplace_back([&] {
+        Batch* b;
+        for (std::uint64_t seq = 0; to_writer[seq % workers]->pop(b); ++seq) {
+            if (!write_failed.load(std::memory_order_relaxed) && !write_all(out_fd, b->text.data(), b->text.size()))
+                write_failed.store(true, std::memory_order_relaxed);
+            free_batches.push(b);
+        }
+    });
+
+    // Reader on the calling thread
+    std::vector<char> buf(std::size_t(1) << 16);
+    std::size_t have = 0; // bytes in buf, starting with an unfinished line
+    std::uint64_t seq = 0;
+    Batch* batch = nullptr;
+    auto send = [&] {
+        if (!batch) return;
+        batch->seq = seq;
+        to_worker[seq % workers]->push(batch);
+        ++seq;
+        batch = nullptr;
+    };
+    bool eof = false;
+    while (!eof && !write_failed.load(std::memory_order_relaxed)) {
+        if (have == buf.size()) buf.resize(buf.size() * 2); // one line longer than the buffer
+        const ssize_t n = ::read(in_fd, buf.data() + have, buf.size() - have);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            eof = true;
+            // A last line without its newline still counts
+            if (have > 0) {
+                if (have == buf.size()) buf.resize(have + 1);
+                buf[have++] = '\n';
+            }
+        } else {
+            have += static_cast<std::size_t>(n);
+        }
+
+        const char* p = buf.data();
+        const char* end = buf.data() + have;
+        for (;;) {
+            const char* nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+            if (!nl) break;
+            const char* line_end = nl > p && nl[-1] == '\r' ? nl - 1 : nl;
+            if (line_end > p && *p != '#') {
+                if (!batch) {
+                    free_batches.pop(batch);
+                    batch->clear();
+                }
+                parse_line(p, line_end, *batch);
+                ++stats.records;
+                if (batch->error.back()) ++stats.errors;
+                if (batch->size() == batch_size) send();
+            }
+            p = nl + 1;
+        }
+        have = static_cast<std::size_t>(end - p);
+        std::memmove(buf.data(), p, have);
+
+        // Out of ready input: ship the partial batch now rather than wait
+        if (!eof && !readable(in_fd)) send();
+    }
+    send();
+    stats.batches = seq;
+    for (auto& q : to_worker) q->close();
+    for (auto& t : threads) t.join();
+    stats.write_failed = write_failed.load();
+    return stats;
+}
+
+}
@@ -0,0 +1,149 @@
+#include "thread_pool.h"
+
+namespace aemps {
+
+struct ThreadPool::Job {
+    const std::function<void(std::size_t)>* fn;
+    std::atomic<std::size_t> remaining;
+    std::mutex error_m;
+    std::exception_ptr error;
+};
+
+ThreadPool::ThreadPool(std::size_t threads) {
+    if (threads == 0) {
+        const std::size_t hw = std::thread::hardware_concurrency();
+        threads = hw > 1 ? hw - 1 : 0;
+    }
+    for (std::size_t i = 0; i < threads + 1; ++i) slots_.push_back(std::make_unique<Slot>());
+    workers_.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) workers_.emplace_back([this, i] { worker_loop(i); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lk(wake_m_);
+        stop_ = true;
+    }
+    wake_cv_.notify_all();
+    for (auto& t : workers_) t.join();
+}
+
+bool ThreadPool::claim(std::size_t self, Job*& job, std::size_t& index) {
+    {
+        Slot& own = *slots_[self];
+        std::lock_guard<std::mutex> lk(own.m);
+        if (!own.ranges.empty()) {
+            Range& r = own.ranges.front();
+            job = r.job;
+            index = r.begin++;
+            if (r.begin == r.end) own.ranges.pop_front();
+            pending_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    // Own slice exhausted: steal the back half of the largest slice left in
+    // another slot. Sizes are read one lock at a time, so the chosen victim
+    // is re-checked under its lock and the scan repeats if it drained in
+    // between.
+    const std::size_t n = slots_.size();
+    for (;;) {
+        std::size_t best = n, best_size = 0;
+        for (std::size_t k = 1; k < n; ++k) {
+            const std::size_t v = (self + k) % n;
+            Slot& victim = *slots_[v];
+            std::lock_guard<std::mutex> lk(victim.m);
+            if (victim.ranges.empty()) continue;
+            const Range& r = victim.ranges.back();
+            if (r.end - r.begin > best_size) {
+                best = v;
+                best_size = r.end - r.begin;
+            }
+        }
+        if (best == n) return false;
+        Range stolen;
+        {
+            Slot& victim = *slots_[best];
+            std::lock_guard<std::mutex> lk(victim.m);
+            if (victim.ranges.empty()) continue;
+            Range& r = victim.ranges.back();
+            const std::size_t mid = r.begin + (r.end - r.begin) / 2;
+            stolen = Range{r.job, mid, r.end};
+            r.end = mid;
+            if (r.begin == r.end) victim.ranges.pop_back();
+        }
+        job = stolen.job;
+        index = stolen.begin++;
+        pending_.fetch_sub(1, std::memory_order_relaxed);
+        if (stolen.begin < stolen.end) {
+            Slot& own = *slots_[self];
+            std::lock_guard<std::mutex> lk(own.m);
+            own.ranges.push_back(stolen);
+        }
+        return true;
+    }
+}
+
+bool ThreadPool::try_run(std::size_t self) {
+    Job* job = nullptr;
+    std::size_t index = 0;
+    if (!claim(self, job, index)) return false;
+    try {
+        (*job->fn)(index);
+    } catch (...) {
+        std::lock_guard<std::mutex> lk(job->error_m);
+        if (!job->error) job->error = std::current_exception();
+    }
+    if (job->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard<std::mutex> lk(wake_m_);
+        done_cv_.notify_all();
+    }
+    return true;
+}
+
+void ThreadPool::worker_loop(std::size_t self) {
+    for (;;) {
+        if (try_run(self)) continue;
+        std::unique_lock<std::mutex> lk(wake_m_);
+        wake_cv_.wait(lk, [this] { return stop_ || pending_.load(std::memory_order_relaxed) > 0; });
+        if (stop_) return;
+    }
+}
+
+void ThreadPool::parallel_for(std::size_t n, const std::function<void(std::size_t)>& fn) {
+    if (n == 0) return;
+    if (workers_.empty() || n == 1) {
+        for (std::size_t i = 0; i < n; ++i) fn(i);
+        return;
+    }
+    Job job;
+    job.fn = &fn;
+    job.remaining.store(n, std::memory_order_relaxed);
+
+    const std::size_t parts = slots_.size() < n ? slots_.size() : n;
+    pending_.fetch_add(n, std::memory_order_relaxed);
+    for (std::size_t p = 0; p < parts; ++p) {
+        Slot& s = *slots_[p];
+        std::lock_guard<std::mutex> lk(s.m);
+        s.ranges.push_back(Range{&job, n * p / parts, n * (p + 1) / parts});
+    }
+    {
+        std::lock_guard<std::mutex> lk(wake_m_);
+    }
+    wake_cv_.notify_all();
+
+    const std::size_t self = slots_.size() - 1;
+    while (job.remaining.load(std::memory_order_acquire) > 0) {
+        if (try_run(self)) continue;
+        // Everything is claimed; wait for the in-flight indices to finish
+        std::unique_lock<std::mutex> lk(wake_m_);
+        done_cv_.wait(lk, [&] { return job.remaining.load(std::memory_order_acquire) == 0; });
+    }
+    if (job.error) std::rethrow_exception(job.error);
+}
+
+ThreadPool& default_thread_pool() {
+    static ThreadPool pool;
+    return pool;
+}
+
+}
@@ -0,0 +1,111 @@
+#include "vol_predictor.h"
+#include <stdexcept>
+#include "instrumentation.h"
+
+namespace aemps {
+
+VolPredictionCache::VolPredictionCache(std::shared_ptr<const VolPredictor> predictor, std::size_t capacity)
+    : predictor_(std::move(predictor)), capacity_(capacity > 0 ? capacity : 1) {
+    if (!predictor_) throw std::invalid_argument("VolPredictionCache: null predictor");
+}
+
+std::shared_future<VolPredictionCache::Predictions> VolPredictionCache::lookup(const Key& key,
+                                                                              const FeatureMatrix& features) {
+    std::promise<Predictions> promise;
+    std::shared_future<Predictions> future;
+    std::uint64_t miss;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it != entries_.end()) {
+            ++hits_;
+            add_count(Counter::CacheHits);
+            lru_.splice(lru_.begin(), lru_, it->second.lru);
+            return it->second.value;
+        }
+        miss = ++misses_;
+        add_count(Counter::CacheMisses);
+        future = promise.get_future().share();
+        lru_.push_front(key);
+        entries_.emplace(key, Entry{future, nullptr, lru_.begin(), miss});
+        while (entries_.size() > capacity_) {
+            entries_.erase(lru_.back());
+            lru_.pop_back();
+        }
+    }
+
+    // Inference runs unlocked; waiters on this key block on the future
+    try {
+        auto out = std::make_shared<std::vector<double>>(features.rows);
+        predictor_->predict(features, out->data());
+        promise.set_value(std::move(out));
+    } catch (...) {
+        promise.set_exception(std::current_exception());
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it != entries_.end() && it->second.miss == miss) {
+            lru_.erase(it->second.lru);
+            entries_.erase(it);
+        }
+    }
+    return future;
+}
+
+VolPredictionCache::Predictions VolPredictionCache::predict(const std::string& underlier, std::uint64_t snapshot,
+                                                            const FeatureMatrix& features) {
+    return lookup(Key(underlier, snapshot), features).get();
+}
+
+std::shared_ptr<const GridVolSurface> VolPredictionCache::surface(const std::string& underlier,
+                                                                  std::uint64_t snapshot,
+                                                                  const std::vector<double>& strikes,
+                                                                  const std::vector<double>& maturities,
+                                                                  const FeatureMatrix& features) {
+    if (features.rows != strikes.size() * maturities.size())
+        throw std::invalid_argument("VolPredictionCache: need one feature row per grid node");
+    const Key key(underlier, snapshot);
+    const Predictions vols = lookup(key, features).get();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it != entries_.end() && it->second.surface) return it->second.surface;
+    }
+    auto grid = std::make_shared<const GridVolSurface>(strikes, maturities, *vols);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) return grid;
+    if (!it->second.surface) it->second.surface = std::move(grid);
+    return it->second.surface;
+}
+
+void VolPredictionCache::invalidate(const std::string& underlier) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.lower_bound(Key(underlier, 0));
+    while (it != entries_.end() && it->first.first == underlier) {
+        lru_.erase(it->second.lru);
+        it = entries_.erase(it);
+    }
+}
+
+void VolPredictionCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    lru_.clear();
+}
+
+std::size_t VolPredictionCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+std::uint64_t VolPredictionCache::hits() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hits_;
+}
+
+std::uint64_t VolPredictionCache::misses() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return misses_;
+}
+
+}
@@ -0,0 +1,139 @@
+#include "volatility_model.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace aemps {
+
+void VolatilityModel::volatility(const double* strike, const double* maturity, std::size_t n, double* out) const {
+    for (std::size_t i = 0; i < n; ++i) out[i] = volatility(strike[i], maturity[i]);
+}
+
+double VolatilityModel::total_variance(double strike, double maturity) const {
+    const double v = volatility(strike, maturity);
+    return v * v * maturity;
+}
+
+void FlatVolatility::volatility(const double*, const double*, std::size_t n, double* out) const {
+    std::fill(out, out + n, vol_);
+}
+
+void GridVolSurface::Axis::build(const char* name) {
+    if (nodes.empty()) throw std::invalid_argument(std::string("GridVolSurface: no ") + name);
+    double min_gap = 0.0;
+    for (std::size_t i = 1; i < nodes.size(); ++i) {
+        const double gap = nodes[i] - nodes[i - 1];
+        if (!(gap > 0.0)) throw std::invalid_argument(std::string("GridVolSurface: ") + name + " must increase");
+        min_gap = i == 1 ? gap : std::min(min_gap, gap);
+    }
+    origin = nodes.front();
+    if (nodes.size() < 2) return;
+    inv_gap.resize(nodes.size() - 1);
+    for (std::size_t i = 0; i + 1 < nodes.size(); ++i) inv_gap[i] = 1.0 / (nodes[i + 1] - nodes[i]);
+    // Cells no wider than the closest node pair hold at most one node, so
+    // locate() steps at most once; very uneven axes cap the table instead
+    const double range = nodes.back() - nodes.front();
+    const std::size_t cells = static_cast<std::size_t>(
+        std::min(std::ceil(range / min_gap), static_cast<double>(64 * nodes.size())));
+    inv_width = static_cast<double>(cells) / range;
+    bucket.resize(cells);
+    std::size_t i = 0;
+    for (std::size_t c = 0; c < cells; ++c) {
+        const double x = origin + static_cast<double>(c) / inv_width;
+        while (i + 2 < nodes.size() && nodes[i + 1] <= x) ++i;
+        bucket[c] = static_cast<std::uint32_t>(i);
+    }
+}
+
+std::size_t GridVolSurface::Axis::locate(double x) const {
+    const std::size_t n = nodes.size();
+    if (n < 2 || !(x > origin)) return 0;
+    const double last = static_cast<double>(bucket.size() - 1);
+    const std::size_t c = static_cast<std::size_t>(std::min((x - origin) * inv_width, last));
+    std::size_t i = bucket[c];
+    while (i + 2 < n && nodes[i + 1] <= x) ++i;
+    return i;
+}
+
+GridVolSurface::GridVolSurface(std::vector<double> strikes, std::vector<double> maturities, std::vector<double> vols) {
+    strikes_.nodes = std::move(strikes);
+    maturities_.nodes = std::move(maturities);
+    strikes_.build("strikes");
+    maturities_.build("maturities");
+    if (!(maturities_.nodes.front() > 0.0)) throw std::invalid_argument("GridVolSurface: maturities must be positive");
+    const std::size_t ns = strikes_.nodes.size();
+    if (vols.size() != ns * maturities_.nodes.size())
+        throw std::invalid_argument("GridVolSurface: need one vol per (maturity, strike) node");
+    w_.resize(vols.size());
+    for (std::size_t m = 0; m < maturities_.nodes.size(); ++m)
+        for (std::size_t k = 0; k < ns; ++k) w_[m * ns + k] = vols[m * ns + k] * vols[m * ns + k] * maturities_.nodes[m];
+}
+
+double GridVolSurface::variance(double strike, double maturity) const {
+    const std::vector<double>& ks = strikes_.nodes;
+    const std::vector<double>& ts = maturities_.nodes;
+    const std::size_t ns = ks.size();
+    const std::size_t k = strikes_.locate(strike);
+    const double a = ns < 2 ? 0.0 : std::min(std::max((strike - ks[k]) * strikes_.inv_gap[k], 0.0), 1.0);
+    const std::size_t k1 = ns < 2 ? k : k + 1;
+    const auto row = [&](std::size_t m) { return w_[m * ns + k] + a * (w_[m * ns + k1] - w_[m * ns + k]); };
+
+    // Flat vol outside the maturity nodes
+    if (!(maturity > ts.front())) return row(0) * (maturity / ts.front());
+    if (!(maturity < ts.back())) return row(ts.size() - 1) * (maturity / ts.back());
+    const std::size_t m = maturities_.locate(maturity);
+    const double b = (maturity - ts[m]) * maturities_.inv_gap[m];
+    const double w0 = row(m);
+    return w0 + b * (row(m + 1) - w0);
+}
+
+double GridVolSurface::volatility(double strike, double maturity) const {
+    const double t = maturity > 0.0 ? maturity : maturities_.nodes.front();
+    return std::sqrt(std::max(variance(strike, t), 0.0) / t);
+}
+
+void GridVolSurface::volatility(const double* strike, const double* maturity, std::size_t n, double* out) const {
+    for (std::size_t i = 0; i < n; ++i) out[i] = GridVolSurface::volatility(strike[i], maturity[i]);
+}
+
+std::size_t GridVolSurface::stencil(double strike, double maturity, std::size_t nodes[4], double weights[4]) const {
+    const std::vector<double>& ks = strikes_.nodes;
+    const std::vector<double>& ts = maturities_.nodes;
+    const std::size_t ns = ks.size();
+    const std::size_t k = strikes_.locate(strike);
+    const std::size_t strike_count = ns < 2 ? 1 : 2;
+    const double t = maturity > 0.0 ? maturity : ts.front();
+    std::size_t m = 0, maturity_count = 1;
+    // Weights of the strike and maturity interpolation, as in variance()
+    double a = 0.0, row_weight[2] = {1.0, 0.0};
+    if (!(t > ts.front())) {
+        m = 0;
+        row_weight[0] = t / ts.front();
+    } else if (!(t < ts.back())) {
+        m = ts.size() - 1;
+        row_weight[0] = t / ts.back();
+    } else {
+        m = maturities_.locate(t);
+        maturity_count = 2;
+        const double b = (t - ts[m]) * maturities_.inv_gap[m];
+        row_weight[0] = 1.0 - b;
+        row_weight[1] = b;
+    }
+    if (ns >= 2) a = std::min(std::max((strike - ks[k]) * strikes_.inv_gap[k], 0.0), 1.0);
+    const double strike_weight[2] = {ns < 2 ? 1.0 : 1.0 - a, a};
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < maturity_count; ++i)
+        for (std::size_t j = 0; j < strike_count; ++j) {
+            if (weights) weights[count] = maturity > 0.0 ? row_weight[i] * strike_weight[j] : 0.0;
+            nodes[count++] = (m + i) * ns + k + j;
+        }
+    return count;
+}
+
+double GridVolSurface::total_variance(double strike, double maturity) const {
+    return maturity > 0.0 ? std::max(variance(strike, maturity), 0.0) : 0.0;
+}
+
+}
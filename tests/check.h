@@ -0,0 +1,35 @@
+#pragma once
+// Minimal checks for the ctest targets, so the tests need nothing beyond
+// the library: each test_*.cpp is one executable that reports every failed
+// check and exits non-zero if there was any
+#include <cmath>
+#include <cstdio>
+
+namespace aemps_test {
+
+inline int& failures() {
+    static int n = 0;
+    return n;
+}
+
+inline void check(bool ok, const char* what, const char* file, int line) {
+    if (ok) return;
+    ++failures();
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+}
+
+inline void check_near(double a, double b, double tol, const char* what, const char* file, int line) {
+    if (std::fabs(a - b) <= tol) return;
+    ++failures();
+    std::fprintf(stderr, "%s:%d: check failed: %s (%.17g vs %.17g, tolerance %.3g)\n", file, line, what, a, b, tol);
+}
+
+inline int result(const char* name) {
+    if (failures()) std::fprintf(stderr, "%s: %d checks failed\n", name, failures());
+    return failures() ? 1 : 0;
+}
+
+}
+
+#define CHECK(cond) aemps_test::check((cond), #cond, __FILE__, __LINE__)
+#define CHECK_NEAR(a, b, tol) aemps_test::check_near((a), (b), (tol), #a " ~ " #b, __FILE__, __LINE__)
@@ -0,0 +1,163 @@
+// Tape-based adjoints: the tape against hand derivatives, and the Monte
+// Carlo sensitivities, by bucket and by grid node, against bump-and-revalue
+// on the same paths and against Black-Scholes
+#include <cmath>
+#include <cstddef>
+#include <vector>
+#include "aad.h"
+#include "black_scholes.h"
+#include "check.h"
+#include "monte_carlo_pricer.h"
+#include "option.h"
+#include "rng.h"
+#include "thread_pool.h"
+#include "vol_term_structure.h"
+#include "volatility_model.h"
+
+using namespace aemps;
+
+namespace {
+
+const Option kPut(OptionType::Put, 105.0, 1.5, 100.0);
+constexpr double kRate = 0.03;
+
+void tape_matches_hand_derivatives() {
+    Tape tape;
+    const AReal x(tape, 1.3), y(tape, 0.7);
+    // f = exp(x * y) / y + sqrt(x) - log(y) + max(x - 1, 0)
+    const AReal f = exp(x * y) / y + sqrt(x) - log(y) + max(x - 1.0, 0.0);
+    tape.adjoint(f.index()) = 1.0;
+    tape.propagate(f.index(), 0);
+    const double e = std::exp(1.3 * 0.7);
+    CHECK_NEAR(f.value(), e / 0.7 + std::sqrt(1.3) - std::log(0.7) + 0.3, 1e-14);
+    CHECK_NEAR(x.adjoint(), e + 0.5 / std::sqrt(1.3) + 1.0, 1e-13);
+    CHECK_NEAR(y.adjoint(), 1.3 * e / 0.7 - e / (0.7 * 0.7) - 1.0 / 0.7, 1e-13);
+}
+
+// Sweeping to a mark and rewinding accumulates the inputs' adjoints over
+// every recording, as the Monte Carlo paths do
+void rewind_accumulates_inputs() {
+    Tape tape;
+    const AReal x(tape, 2.0);
+    const std::size_t mark = tape.mark();
+    for (int k = 1; k <= 3; ++k) {
+        const AReal f = x * x * static_cast<double>(k);
+        tape.adjoint(f.index()) = 1.0;
+        tape.propagate(f.index(), mark);
+        tape.rewind(mark);
+        CHECK(tape.size() == mark);
+    }
+    CHECK_NEAR(x.adjoint(), 2.0 * 2.0 * (1.0 + 2.0 + 3.0), 1e-14);
+    // sqrt at 0 differentiates to 0 rather than infinity
+    const AReal zero(tape, 0.0);
+    const AReal s = sqrt(zero);
+    tape.adjoint(s.index()) = 1.0;
+    tape.propagate(s.index(), zero.index());
+    CHECK(zero.adjoint() == 0.0);
+}
+
+McConfig config() {
+    McConfig cfg;
+    cfg.paths = 40000;
+    cfg.steps = 8;
+    cfg.block_size = 1000;
+    cfg.variance_reduction = VarianceReduction::Antithetic;
+    return cfg;
+}
+
+// Every bucket vega against central differences on the same paths; the
+// buckets split the steps unevenly and the last one overhangs maturity
+void bucket_vega_matches_bumps() {
+    const VolTermStructure vol({0.2, 0.5, 0.8, 1.2, 2.0}, {0.3, 0.25, 0.22, 0.2, 0.18});
+    const MonteCarloPricer<PhiloxRng, SerialExecutor> pricer(config());
+    const McSensitivities s = pricer.sensitivities(kPut, kRate, vol);
+    CHECK(s.vega.size() == vol.buckets());
+    const double h = 1e-5;
+    for (std::size_t j = 0; j < vol.buckets(); ++j) {
+        VolTermStructure up = vol, down = vol;
+        up.vols[j] += h;
+        down.vols[j] -= h;
+        const double bumped = (pricer.sensitivities(kPut, kRate, up).price -
+                               pricer.sensitivities(kPut, kRate, down).price) / (2.0 * h);
+        CHECK_NEAR(s.vega[j], bumped, 1e-4 * std::abs(bumped) + 1e-6);
+    }
+    const double hs = 1e-4 * kPut.spot;
+    const auto at_spot = [&](double spot) {
+        return pricer.sensitivities(Option(kPut.type, kPut.strike, kPut.maturity, spot), kRate, vol).price;
+    };
+    CHECK_NEAR(s.delta, (at_spot(kPut.spot + hs) - at_spot(kPut.spot - hs)) / (2.0 * hs), 1e-4);
+    const double hr = 1e-5;
+    CHECK_NEAR(s.rho,
+               (pricer.sensitivities(kPut, kRate + hr, vol).price - pricer.sensitivities(kPut, kRate - hr, vol).price) /
+                   (2.0 * hr),
+               1e-4 * std::abs(s.rho));
+}
+
+// Every node vega against central differences on the same paths; the strike
+// sits between the 100 and 110 columns, so the outer columns get none
+void node_vega_matches_bumps() {
+    const std::vector<double> strikes{90.0, 100.0, 110.0, 120.0}, maturities{0.5, 1.0, 2.0};
+    const std::vector<double> vols{0.32, 0.3, 0.28, 0.27, 0.29, 0.27, 0.25, 0.24, 0.26, 0.24, 0.23, 0.22};
+    const auto grid = [&](const std::vector<double>& v) { return GridVolSurface(strikes, maturities, v); };
+    const MonteCarloPricer<PhiloxRng, SerialExecutor> pricer(config());
+    const McSensitivities s = pricer.sensitivities(kPut, kRate, grid(vols));
+    CHECK(s.vega.size() == vols.size());
+    const double h = 1e-5;
+    for (std::size_t n = 0; n < vols.size(); ++n) {
+        const std::size_t k = n % strikes.size();
+        if (k == 0 || k == 3) {
+            CHECK(s.vega[n] == 0.0);
+            continue;
+        }
+        std::vector<double> up = vols, down = vols;
+        up[n] += h;
+        down[n] -= h;
+        const double bumped = (pricer.sensitivities(kPut, kRate, grid(up)).price -
+                               pricer.sensitivities(kPut, kRate, grid(down)).price) / (2.0 * h);
+        CHECK(s.vega[n] != 0.0);
+        CHECK_NEAR(s.vega[n], bumped, 1e-4 * std::abs(bumped) + 1e-6);
+    }
+    // A flat grid diffuses the flat vol, so its node vegas add up to the
+    // single-bucket vega
+    const McSensitivities flat = pricer.sensitivities(kPut, kRate, grid(std::vector<double>(vols.size(), 0.25)));
+    const McSensitivities bucket = pricer.sensitivities(kPut, kRate, VolTermStructure(0.25));
+    double total = 0.0;
+    for (double v : flat.vega) total += v;
+    CHECK_NEAR(flat.price, bucket.price, 1e-12);
+    CHECK_NEAR(total, bucket.vega[0], 1e-9 * std::abs(bucket.vega[0]));
+}
+
+void flat_vol_matches_black_scholes() {
+    McConfig cfg = config();
+    cfg.paths = 200000;
+    const double v = 0.25;
+    const McSensitivities s = MonteCarloPricer<PhiloxRng>(cfg).sensitivities(kPut, kRate, VolTermStructure(v));
+    const Greeks g = BlackScholes::greeks(kPut, kRate, v);
+    CHECK_NEAR(s.price, g.price, 4.0 * s.std_error);
+    CHECK_NEAR(s.delta, g.delta, 0.01);
+    CHECK_NEAR(s.rho, g.rho, 0.02 * std::abs(g.rho));
+    CHECK(s.vega.size() == 1);
+    CHECK_NEAR(s.vega[0], g.vega, 0.02 * g.vega);
+}
+
+void serial_equals_threaded(ThreadPool& pool) {
+    const VolTermStructure vol({0.5, 1.0, 1.5}, {0.3, 0.25, 0.2});
+    const McSensitivities a = MonteCarloPricer<PhiloxRng, SerialExecutor>(config()).sensitivities(kPut, kRate, vol);
+    const McSensitivities b =
+        MonteCarloPricer<PhiloxRng>(config(), ThreadPoolExecutor(pool)).sensitivities(kPut, kRate, vol);
+    CHECK(a.price == b.price && a.std_error == b.std_error && a.paths == b.paths);
+    CHECK(a.delta == b.delta && a.rho == b.rho && a.vega == b.vega);
+}
+
+}
+
+int main() {
+    ThreadPool pool(3);
+    tape_matches_hand_derivatives();
+    rewind_accumulates_inputs();
+    bucket_vega_matches_bumps();
+    node_vega_matches_bumps();
+    flat_vol_matches_black_scholes();
+    serial_equals_threaded(pool);
+    return aemps_test::result("test_aad");
+}
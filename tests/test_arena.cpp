@@ -0,0 +1,128 @@
+// Scratch arena: alignment, rewinding, consolidation on reset, nested
+// scopes, and the engine leaving the thread arena settled between runs
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "arena.h"
+#include "check.h"
+#include "monte_carlo_pricer.h"
+#include "option.h"
+#include "rng.h"
+#include "utils.h"
+
+using namespace aemps;
+
+namespace {
+
+bool aligned(const void* p, std::size_t alignment) {
+    return reinterpret_cast<std::uintptr_t>(p) % alignment == 0;
+}
+
+void allocations_are_aligned_and_disjoint() {
+    Arena arena(4096);
+    char* a = static_cast<char*>(arena.allocate(3));
+    char* b = static_cast<char*>(arena.allocate(10, 16));
+    char* c = static_cast<char*>(arena.allocate(100));
+    CHECK(aligned(a, kCacheLine) && aligned(b, 16) && aligned(c, kCacheLine));
+    CHECK(b >= a + 3 && c >= b + 10);
+    std::memset(a, 1, 3);
+    std::memset(b, 2, 10);
+    std::memset(c, 3, 100);
+    CHECK(a[2] == 1 && b[9] == 2 && c[99] == 3);
+    // Zero bytes still gets its own address
+    CHECK(arena.allocate(0) != arena.allocate(0));
+}
+
+void rewind_reuses_storage() {
+    Arena arena(4096);
+    arena.allocate(128);
+    const Arena::Marker m = arena.mark();
+    void* first = arena.allocate(256);
+    arena.allocate(512);
+    arena.rewind(m);
+    CHECK(arena.allocate(256) == first);
+    CHECK(arena.capacity() == 4096);
+}
+
+// Oversized requests get their own chunk; the reset folds them into one
+// chunk that holds the whole high-water mark
+void reset_consolidates_chunks() {
+    Arena arena(1024);
+    arena.allocate(512);
+    arena.allocate(900);
+    arena.allocate(5000);
+    const std::size_t held = arena.capacity();
+    CHECK(held >= 512 + 900 + 5000);
+    CHECK(arena.high_water() > 5000);
+    arena.reset();
+    CHECK(arena.capacity() == held);
+    // The same requests now fit in the one chunk
+    arena.allocate(512);
+    arena.allocate(900);
+    arena.allocate(5000);
+    CHECK(arena.capacity() == held);
+}
+
+void scopes_nest() {
+    Arena arena(1024);
+    {
+        ArenaScope a(arena);
+        arena.allocate(100);
+        const Arena::Marker before = arena.mark();
+        {
+            ArenaScope b(arena);
+            arena.allocate(2000);
+        }
+        const Arena::Marker after = arena.mark();
+        CHECK(after.chunk == before.chunk && after.offset == before.offset);
+    }
+    // The outermost scope reset the arena into one chunk that holds both
+    CHECK(arena.mark().chunk == 0 && arena.mark().offset == 0);
+    const std::size_t held = arena.capacity();
+    CHECK(held >= 100 + 2000);
+    arena.allocate(100);
+    arena.allocate(2000);
+    CHECK(arena.capacity() == held);
+}
+
+void vectors_grow_in_the_arena() {
+    Arena arena(1 << 16);
+    ArenaScope scope(arena);
+    ArenaVector<double> v{ArenaAllocator<double>(arena)};
+    for (int i = 0; i < 1000; ++i) v.push_back(i);
+    CHECK(aligned(v.data(), kCacheLine));
+    double sum = 0.0;
+    for (double x : v) sum += x;
+    CHECK(sum == 999.0 * 1000.0 / 2.0);
+    const ArenaVector<int> w(17, 3, ArenaAllocator<int>(arena));
+    CHECK(w.size() == 17 && w[16] == 3);
+}
+
+// A second identical run neither grows the thread arena nor changes the price
+void pricing_settles_the_thread_arena() {
+    McConfig config;
+    config.paths = 20000;
+    config.steps = 16;
+    config.block_size = 1000;
+    const Option put(OptionType::Put, 105.0, 1.5, 100.0);
+    const MonteCarloPricer<PhiloxRng, SerialExecutor> pricer(config);
+    const McResult first = pricer.price(put, 0.03, 0.25);
+    const std::size_t held = thread_arena().capacity();
+    CHECK(held > 0);
+    const McResult second = pricer.price(put, 0.03, 0.25);
+    CHECK(thread_arena().capacity() == held);
+    CHECK(first.price == second.price && first.std_error == second.std_error);
+}
+
+}
+
+int main() {
+    allocations_are_aligned_and_disjoint();
+    rewind_reuses_storage();
+    reset_consolidates_chunks();
+    scopes_nest();
+    vectors_grow_in_the_arena();
+    pricing_settles_the_thread_arena();
+    return aemps_test::result("test_arena");
+}
@@ -0,0 +1,213 @@
+// Batch Black-Scholes kernels against the scalar formulas, Greeks against
+// finite differences, implied vol round trips and scenario revaluation
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "black_scholes.h"
+#include "check.h"
+#include "cpu_features.h"
+#include "option.h"
+#include "scenario.h"
+
+using namespace aemps;
+
+namespace {
+
+// Strikes 50-150, maturities up to 3 years, odd size so every kernel
+// runs a partial tail vector
+OptionBook make_book(std::size_t n) {
+    std::mt19937_64 gen(11);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    OptionBook book;
+    book.reserve(n);
+    for (std::size_t i = 0; i < n; ++i)
+        book.push_back(Option(i % 2 ? OptionType::Put : OptionType::Call, 50.0 + 100.0 * u(gen), 0.02 + 3.0 * u(gen),
+                              100.0),
+                       0.05 + 0.6 * u(gen), 0.1 * u(gen) - 0.02);
+    return book;
+}
+
+Option option_at(const OptionBook& book, std::size_t i) {
+    return Option(book.type[i], book.strike[i], book.maturity[i], book.spot[i]);
+}
+
+void batch_matches_scalar() {
+    const OptionBook book = make_book(1003);
+    std::vector<double> prices(book.size());
+    BlackScholes::price(book.view(), prices.data());
+    for (std::size_t i = 0; i < book.size(); ++i) {
+        const double ref = BlackScholes::price(option_at(book, i), book.rate[i], book.volatility[i]);
+        CHECK_NEAR(prices[i], ref, 1e-12 * book.spot[i]);
+    }
+}
+
+void degenerate_contracts_price_at_intrinsic() {
+    OptionBook book;
+    book.push_back(Option(OptionType::Call, 90.0, 0.0, 100.0), 0.2, 0.05);
+    book.push_back(Option(OptionType::Put, 110.0, 0.0, 100.0), 0.2, 0.05);
+    book.push_back(Option(OptionType::Call, 90.0, 2.0, 100.0), 0.0, 0.05);
+    book.push_back(Option(OptionType::Put, 110.0, 2.0, 100.0), 0.0, 0.05);
+    book.push_back(Option(OptionType::Call, 110.0, 2.0, 100.0), 0.0, 0.0);
+    std::vector<double> prices(book.size());
+    BlackScholes::price(book.view(), prices.data());
+    CHECK_NEAR(prices[0], 10.0, 1e-12);
+    CHECK_NEAR(prices[1], 10.0, 1e-12);
+    CHECK_NEAR(prices[2], 100.0 - 90.0 * std::exp(-0.1), 1e-12);
+    CHECK_NEAR(prices[3], std::max(110.0 * std::exp(-0.1) - 100.0, 0.0), 1e-12);
+    CHECK_NEAR(prices[4], 0.0, 1e-12);
+}
+
+// Run under AEMPS_SIMD too (see CMakeLists.txt); the cap must hold
+void simd_cap_respected() {
+    const char* cap = std::getenv("AEMPS_SIMD");
+    if (!cap) return;
+    const auto rank = [](const std::string& isa) { return isa == "avx512" ? 3 : isa == "avx2" ? 2 : 1; };
+    CHECK(rank(to_string(active_simd_isa())) <= rank(cap));
+}
+
+void greeks_match_scalar_and_finite_differences() {
+    const OptionBook book = make_book(257);
+    const std::size_t n = book.size();
+    std::vector<double> price(n), delta(n), gamma(n), vega(n), theta(n), rho(n);
+    GreeksOutput out;
+    out.price = price.data();
+    out.delta = delta.data();
+    out.gamma = gamma.data();
+    out.vega = vega.data();
+    out.theta = theta.data();
+    out.rho = rho.data();
+    BlackScholes::greeks(book.view(), out);
+    for (std::size_t i = 0; i < n; ++i) {
+        const Option opt = option_at(book, i);
+        const double r = book.rate[i], vol = book.volatility[i];
+        const Greeks g = BlackScholes::greeks(opt, r, vol);
+        CHECK_NEAR(price[i], g.price, 1e-12 * opt.spot);
+        CHECK_NEAR(delta[i], g.delta, 1e-12);
+        CHECK_NEAR(gamma[i], g.gamma, 1e-12);
+        CHECK_NEAR(vega[i], g.vega, 1e-10 * opt.spot);
+        CHECK_NEAR(theta[i], g.theta, 1e-10 * opt.spot);
+        CHECK_NEAR(rho[i], g.rho, 1e-10 * opt.spot);
+
+        // Central differences
+        const auto at = [&](double S, double T, double rr, double v) {
+            return BlackScholes::price(Option(opt.type, opt.strike, T, S), rr, v);
+        };
+        const double hs = 1e-4 * opt.spot, hv = 1e-5, hr = 1e-5, ht = 1e-5;
+        const double p0 = at(opt.spot, opt.maturity, r, vol);
+        const double up = at(opt.spot + hs, opt.maturity, r, vol), down = at(opt.spot - hs, opt.maturity, r, vol);
+        CHECK_NEAR(g.delta, (up - down) / (2.0 * hs), 1e-6);
+        CHECK_NEAR(g.gamma, (up - 2.0 * p0 + down) / (hs * hs), 1e-5);
+        CHECK_NEAR(g.vega,
+                   (at(opt.spot, opt.maturity, r, vol + hv) - at(opt.spot, opt.maturity, r, vol - hv)) / (2.0 * hv),
+                   1e-5 * opt.spot);
+        CHECK_NEAR(g.rho,
+                   (at(opt.spot, opt.maturity, r + hr, vol) - at(opt.spot, opt.maturity, r - hr, vol)) / (2.0 * hr),
+                   1e-5 * opt.spot);
+        CHECK_NEAR(g.theta,
+                   -(at(opt.spot, opt.maturity + ht, r, vol) - at(opt.spot, opt.maturity - ht, r, vol)) / (2.0 * ht),
+                   1e-5 * opt.spot);
+    }
+
+    // Null columns are skipped
+    std::vector<double> only_vega(n);
+    GreeksOutput partial;
+    partial.vega = only_vega.data();
+    BlackScholes::greeks(book.view(), partial);
+    for (std::size_t i = 0; i < n; ++i) CHECK(only_vega[i] == vega[i]);
+}
+
+void implied_vol_round_trips() {
+    const OptionBook book = make_book(1003);
+    std::vector<double> quotes(book.size()), vols(book.size());
+    BlackScholes::price(book.view(), quotes.data());
+    BlackScholes::implied_vol(book.view(), quotes.data(), vols.data());
+    for (std::size_t i = 0; i < book.size(); ++i) {
+        const Option opt = option_at(book, i);
+        const Greeks g = BlackScholes::greeks(opt, book.rate[i], book.volatility[i]);
+        // Only where the quote pins the vol down
+        if (g.vega < 1e-3 * opt.spot) continue;
+        CHECK_NEAR(vols[i], book.volatility[i], 1e-8);
+        CHECK_NEAR(BlackScholes::implied_vol(opt, book.rate[i], quotes[i]), book.volatility[i], 1e-8);
+    }
+    // Below intrinsic has no implied vol
+    const Option itm(OptionType::Call, 50.0, 1.0, 100.0);
+    CHECK(std::isnan(BlackScholes::implied_vol(itm, 0.0, 10.0)));
+}
+
+void scenarios_match_shifted_prices() {
+    const OptionBook book = make_book(101);
+    ScenarioSet scenarios;
+    for (int k = 0; k < 9; ++k) scenarios.push_back(0.01 * (k - 4), 0.02 * (k - 4), 0.001 * k);
+    const std::size_t m = scenarios.size();
+    std::vector<double> prices(book.size() * m);
+    BlackScholes::price(book.view(), scenarios, prices.data());
+    std::vector<double> quantity(book.size()), values(m), expected(m, 0.0);
+    for (std::size_t i = 0; i < book.size(); ++i) {
+        quantity[i] = i % 3 ? 1.0 : -2.5;
+        for (std::size_t k = 0; k < m; ++k) {
+            const Option shifted(book.type[i], book.strike[i], book.maturity[i],
+                                 book.spot[i] * (1.0 + scenarios.spot[k]));
+            const double ref = BlackScholes::price(shifted, book.rate[i] + scenarios.rate[k],
+                                                   std::max(book.volatility[i] + scenarios.vol[k], 0.0));
+            CHECK_NEAR(prices[i * m + k], ref, 1e-11 * book.spot[i]);
+            expected[k] += quantity[i] * ref;
+        }
+    }
+    BlackScholes::book_values(book.view(), quantity.data(), scenarios, values.data());
+    for (std::size_t k = 0; k < m; ++k) CHECK_NEAR(values[k], expected[k], 1e-9 * book.size());
+    // Shifts of -1 or below would take the log of a non-positive spot
+    for (double shift : {-1.0, -2.0}) {
+        ScenarioSet bad = scenarios;
+        bad.spot[m - 1] = shift;
+        bool threw = false;
+        try {
+            BlackScholes::price(book.view(), bad, prices.data());
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        CHECK(threw);
+        threw = false;
+        try {
+            BlackScholes::book_values(book.view(), nullptr, bad, values.data());
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        CHECK(threw);
+    }
+}
+
+// Relative to the double tier, including deep out of the money, where
+// the float price cancels and is redone in double
+void single_tier_matches_double() {
+    OptionBook book = make_book(1003);
+    std::mt19937_64 gen(12);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    for (std::size_t i = 0; i < 20000; ++i)
+        book.push_back(Option(i % 2 ? OptionType::Put : OptionType::Call, 100.0 * std::exp(3.0 * (u(gen) - 0.5)),
+                              1e-3 + 5.0 * u(gen) * u(gen), 100.0),
+                       0.01 + 1.2 * u(gen), 0.12 * u(gen) - 0.02);
+    book.push_back(Option(OptionType::Call, 139.0, 0.25, 100.0), 0.2, 0.05);
+    book.push_back(Option(OptionType::Put, 61.0, 0.25, 100.0), 0.2, 0.05);
+    book.push_back(Option(OptionType::Call, 100.0, 0.0, 100.0), 0.2, 0.05);
+    book.push_back(Option(OptionType::Call, 80.0, 0.0, 100.0), 0.2, 0.05);
+    std::vector<double> single(book.size()), ref(book.size());
+    BlackScholes::price(book.view(), single.data(), Precision::Single);
+    BlackScholes::price(book.view(), ref.data());
+    for (std::size_t i = 0; i < book.size(); ++i) CHECK_NEAR(single[i], ref[i], 1e-6 * ref[i]);
+}
+}
+
+int main() {
+    batch_matches_scalar();
+    degenerate_contracts_price_at_intrinsic();
+    simd_cap_respected();
+    greeks_match_scalar_and_finite_differences();
+    implied_vol_round_trips();
+    scenarios_match_shifted_prices();
+    single_tier_matches_double();
+    return aemps_test::result("test_black_scholes");
+}
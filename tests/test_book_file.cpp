@@ -0,0 +1,150 @@
+// Mapped book files: round trips column for column, price bit for bit like
+// the book they were written from, survive a rewrite while mapped, and
+// reject malformed files
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include "black_scholes.h"
+#include "book_file.h"
+#include "check.h"
+#include "option.h"
+
+using namespace aemps;
+
+namespace {
+
+std::string temp_path(const char* name) {
+    return "/tmp/aemps_test_" + std::to_string(::getpid()) + "_" + name;
+}
+
+OptionBook make_book(std::size_t n, unsigned seed) {
+    std::mt19937_64 gen(seed);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    OptionBook book;
+    book.reserve(n);
+    for (std::size_t i = 0; i < n; ++i)
+        book.push_back(Option(i % 2 ? OptionType::Put : OptionType::Call, 50.0 + 100.0 * u(gen), 0.02 + 3.0 * u(gen),
+                              100.0),
+                       0.05 + 0.6 * u(gen), 0.1 * u(gen) - 0.02);
+    return book;
+}
+
+bool same_column(const double* a, const double* b, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i)
+        if (a[i] != b[i]) return false;
+    return true;
+}
+
+void round_trip_prices_bit_identically() {
+    const std::string path = temp_path("round_trip");
+    const OptionBook book = make_book(1001, 3);
+    std::vector<std::uint64_t> ids(book.size());
+    for (std::size_t i = 0; i < ids.size(); ++i) ids[i] = 1000000 + 7 * i;
+    write_book_file(path, book.view(), ids.data());
+    const MappedBook mapped(path);
+    const OptionBatch& v = mapped.view();
+    CHECK(mapped.size() == book.size());
+    bool types = true;
+    for (std::size_t i = 0; i < v.size; ++i) types = types && v.type[i] == book.type[i];
+    CHECK(types);
+    CHECK(same_column(v.strike, book.strike.data(), v.size) && same_column(v.maturity, book.maturity.data(), v.size));
+    CHECK(same_column(v.spot, book.spot.data(), v.size) && same_column(v.volatility, book.volatility.data(), v.size));
+    CHECK(same_column(v.rate, book.rate.data(), v.size));
+    CHECK(mapped.trade_ids() && mapped.trade_ids()[500] == 1003500);
+    std::vector<double> a(v.size), b(v.size);
+    BlackScholes::price(book.view(), a.data());
+    BlackScholes::price(v, b.data());
+    CHECK(same_column(a.data(), b.data(), v.size));
+    std::remove(path.c_str());
+}
+
+// Optional columns left out map to null
+void optional_columns_are_null() {
+    const std::string path = temp_path("optional");
+    const OptionBook book = make_book(10, 4);
+    OptionBatch batch = book.view();
+    batch.volatility = nullptr;
+    write_book_file(path, batch);
+    const MappedBook mapped(path);
+    CHECK(mapped.size() == 10 && !mapped.view().volatility && mapped.view().rate && !mapped.trade_ids());
+    std::remove(path.c_str());
+}
+
+// The writer renames over the old file, so an existing mapping keeps the
+// old book while a new one sees the new
+void rewrite_while_mapped() {
+    const std::string path = temp_path("rewrite");
+    const OptionBook first = make_book(100, 5), second = make_book(300, 6);
+    write_book_file(path, first.view());
+    MappedBook old_book(path);
+    write_book_file(path, second.view());
+    const MappedBook new_book(path);
+    CHECK(old_book.size() == 100 && same_column(old_book.view().strike, first.strike.data(), 100));
+    CHECK(new_book.size() == 300 && same_column(new_book.view().strike, second.strike.data(), 300));
+    MappedBook moved(std::move(old_book));
+    CHECK(moved.size() == 100 && same_column(moved.view().spot, first.spot.data(), 100));
+    std::remove(path.c_str());
+}
+
+bool rejects(const std::string& path) {
+    try {
+        MappedBook mapped(path);
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+void malformed_files_throw() {
+    const std::string path = temp_path("bad");
+    CHECK(rejects(path + "_missing"));
+    const OptionBook book = make_book(64, 7);
+    write_book_file(path, book.view());
+    std::vector<char> bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    const auto write = [&](const std::vector<char>& data) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    };
+    // Truncated inside the header, inside the directory and inside a column
+    for (std::size_t keep : {std::size_t(10), std::size_t(80), bytes.size() - 8}) {
+        write(std::vector<char>(bytes.begin(), bytes.begin() + keep));
+        CHECK(rejects(path));
+    }
+    std::vector<char> bad = bytes;
+    bad[0] = 'X'; // magic
+    write(bad);
+    CHECK(rejects(path));
+    bad = bytes;
+    bad[8] = 2; // version
+    write(bad);
+    CHECK(rejects(path));
+    bad = bytes;
+    bad[16] = static_cast<char>(bad[16] + 1); // one more row than the columns hold
+    write(bad);
+    CHECK(rejects(path));
+    write(bytes);
+    CHECK(!rejects(path));
+    std::remove(path.c_str());
+}
+
+}
+
+int main() {
+    round_trip_prices_bit_identically();
+    optional_columns_are_null();
+    rewrite_while_mapped();
+    malformed_files_throw();
+    return aemps_test::result("test_book_file");
+}
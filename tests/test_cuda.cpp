@@ -0,0 +1,92 @@
+// CUDA backend: CPU-only settings and incomplete batches are rejected before
+// any device work, and on a device the prices agree with
+// MonteCarloPricer<PhiloxRng> to rounding
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+#include "check.h"
+#include "cuda_pricer.h"
+#include "monte_carlo_pricer.h"
+#include "option.h"
+#include "rng.h"
+
+using namespace aemps;
+
+namespace {
+
+template <class F>
+bool rejects(F&& f) {
+    try {
+        f();
+    } catch (const std::invalid_argument&) {
+        return true;
+    }
+    return false;
+}
+
+void cpu_only_settings_rejected() {
+    McConfig greeks;
+    greeks.greeks = true;
+    CHECK(rejects([&] { CudaMonteCarloPricer pricer(greeks); }));
+    McConfig adaptive;
+    adaptive.target_std_error = 0.01;
+    CHECK(rejects([&] { CudaMonteCarloPricer pricer(adaptive); }));
+    McConfig single;
+    single.precision = Precision::Single;
+    CHECK(rejects([&] { CudaMonteCarloPricer pricer(single); }));
+    CudaExecutor odd;
+    odd.threads_per_block = 96;
+    CHECK(rejects([&] { CudaMonteCarloPricer pricer(McConfig(), odd); }));
+    CudaExecutor empty;
+    empty.blocks_per_trade = 0;
+    CHECK(rejects([&] { CudaMonteCarloPricer pricer(McConfig(), empty); }));
+}
+
+void missing_columns_rejected() {
+    OptionBook book;
+    book.push_back(Option(OptionType::Call, 100.0, 1.0, 100.0), 0.2, 0.03);
+    const CudaMonteCarloPricer pricer;
+    McResult out;
+    OptionBatch no_vol = book.view();
+    no_vol.volatility = nullptr;
+    CHECK(rejects([&] { pricer.price(no_vol, &out); }));
+    OptionBatch no_rate = book.view();
+    no_rate.rate = nullptr;
+    CHECK(rejects([&] { pricer.price(no_rate, &out); }));
+}
+
+// Same config on both sides, so the same Philox draws feed every path; only
+// the summation order differs
+void matches_cpu_philox() {
+    OptionBook book;
+    for (int i = 0; i < 24; ++i)
+        book.push_back(Option(i % 2 ? OptionType::Put : OptionType::Call, 80.0 + 2.0 * i, 0.25 + 0.1 * i, 100.0),
+                       0.15 + 0.01 * i, 0.01 * (i % 5));
+    for (VarianceReduction vr : {VarianceReduction::None, VarianceReduction::Antithetic}) {
+        McConfig config;
+        config.paths = 50000;
+        config.steps = 4;
+        config.variance_reduction = vr;
+        const CudaMonteCarloPricer gpu(config);
+        const MonteCarloPricer<PhiloxRng> cpu(config);
+        std::vector<McResult> out(book.size());
+        gpu.price(book.view(), out.data());
+        for (std::size_t i = 0; i < book.size(); ++i) {
+            const Option opt(book.type[i], book.strike[i], book.maturity[i], book.spot[i]);
+            const McResult ref = cpu.price(opt, book.rate[i], book.volatility[i]);
+            CHECK(out[i].paths == ref.paths);
+            CHECK_NEAR(out[i].price, ref.price, 1e-9 * ref.price + 1e-12);
+            CHECK_NEAR(out[i].std_error, ref.std_error, 1e-7 * ref.std_error + 1e-12);
+        }
+    }
+}
+
+}
+
+int main() {
+    cpu_only_settings_rejected();
+    missing_columns_rejected();
+    if (cuda_available()) matches_cpu_philox();
+    return aemps_test::result("test_cuda");
+}
@@ -0,0 +1,141 @@
+// Distributed Monte Carlo against in-process loopback workers: results
+// equal the single-process run bit for bit, unreachable workers are
+// skipped, and a run with none left throws
+#include <arpa/inet.h>
+#include <cstddef>
+#include <mutex>
+#include <netinet/in.h>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "check.h"
+#include "distributed.h"
+#include "monte_carlo_pricer.h"
+#include "option.h"
+#include "rng.h"
+
+using namespace aemps;
+
+namespace {
+
+// Listens on an ephemeral loopback port and serves every connection on
+// its own thread, as pricer_demo --mc-worker does
+class LoopbackWorker {
+public:
+    LoopbackWorker() {
+        fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof addr;
+        if (fd_ < 0 || ::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0 || ::listen(fd_, 8) != 0 ||
+            ::getsockname(fd_, reinterpret_cast<sockaddr*>(&addr), &len) != 0)
+            throw std::runtime_error("LoopbackWorker: cannot listen");
+        endpoint_ = "127.0.0.1:" + std::to_string(ntohs(addr.sin_port));
+        acceptor_ = std::thread([this] {
+            for (int conn; (conn = ::accept(fd_, nullptr, nullptr)) >= 0;) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                connections_.emplace_back([conn] {
+                    serve_mc_worker(conn);
+                    ::close(conn);
+                });
+            }
+        });
+    }
+    ~LoopbackWorker() {
+        ::shutdown(fd_, SHUT_RDWR);
+        acceptor_.join();
+        ::close(fd_);
+        for (std::thread& t : connections_) t.join();
+    }
+
+    const std::string& endpoint() const { return endpoint_; }
+
+private:
+    int fd_;
+    std::string endpoint_;
+    std::thread acceptor_;
+    std::mutex mutex_;
+    std::vector<std::thread> connections_;
+};
+
+bool same(const McResult& a, const McResult& b) {
+    return a.price == b.price && a.std_error == b.std_error && a.paths == b.paths && a.beta == b.beta &&
+           a.delta == b.delta && a.gamma == b.gamma && a.vega == b.vega;
+}
+
+McConfig config_for(VarianceReduction vr) {
+    McConfig config;
+    config.paths = 30000;
+    config.steps = 8;
+    config.block_size = 1000;
+    config.variance_reduction = vr;
+    config.greeks = true;
+    return config;
+}
+
+// A port that was just released has nobody listening
+std::string dead_endpoint() {
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof addr;
+    ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr);
+    ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+    ::close(fd);
+    return "127.0.0.1:" + std::to_string(ntohs(addr.sin_port));
+}
+
+void matches_local_runs() {
+    const LoopbackWorker a, b;
+    const Option put(OptionType::Put, 105.0, 1.5, 100.0);
+    for (VarianceReduction vr : {VarianceReduction::None, VarianceReduction::AntitheticControlVariate}) {
+        const McConfig config = config_for(vr);
+        const McResult local = MonteCarloPricer<PhiloxRng>(config).price(put, 0.03, 0.25);
+        for (std::size_t blocks_per_task : {0, 1, 7}) {
+            const DistributedMc mc({a.endpoint(), b.endpoint()}, blocks_per_task);
+            CHECK(same(mc.price(put, 0.03, 0.25, config), local));
+        }
+    }
+
+    OptionBook book;
+    for (int i = 0; i < 5; ++i)
+        book.push_back(Option(i % 2 ? OptionType::Call : OptionType::Put, 90.0 + 5.0 * i, 0.5 + 0.25 * i, 100.0),
+                       0.2 + 0.02 * i, 0.01 * i);
+    const McConfig config = config_for(VarianceReduction::Antithetic);
+    const std::vector<McResult> results = DistributedMc({a.endpoint(), b.endpoint()}).price(book.view(), config);
+    CHECK(results.size() == book.size());
+    for (std::size_t i = 0; i < book.size() && i < results.size(); ++i) {
+        const Option opt(book.type[i], book.strike[i], book.maturity[i], book.spot[i]);
+        CHECK(same(results[i], MonteCarloPricer<PhiloxRng>(config).price(opt, book.rate[i], book.volatility[i])));
+    }
+}
+
+void unreachable_workers() {
+    const Option call(OptionType::Call, 100.0, 1.0, 100.0);
+    const McConfig config = config_for(VarianceReduction::Antithetic);
+    {
+        const LoopbackWorker live;
+        const DistributedMc mc({dead_endpoint(), live.endpoint()});
+        CHECK(same(mc.price(call, 0.02, 0.3, config), MonteCarloPricer<PhiloxRng>(config).price(call, 0.02, 0.3)));
+    }
+    bool threw = false;
+    try {
+        DistributedMc({dead_endpoint()}).price(call, 0.02, 0.3, config);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+}
+
+int main() {
+    matches_local_runs();
+    unreachable_workers();
+    return aemps_test::result("test_distributed");
+}
@@ -0,0 +1,111 @@
+// Path dynamics: local vol from flat and smiled implied surfaces against
+// Black-Scholes at the implied vol, Heston in its GBM limit, and the
+// constraints the engine puts on non-GBM dynamics
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "black_scholes.h"
+#include "check.h"
+#include "dynamics.h"
+#include "monte_carlo_pricer.h"
+#include "option.h"
+#include "rng.h"
+#include "volatility_model.h"
+
+using namespace aemps;
+
+namespace {
+
+constexpr double kRate = 0.03;
+
+McConfig config() {
+    McConfig cfg;
+    cfg.paths = 200000;
+    cfg.steps = 64;
+    cfg.variance_reduction = VarianceReduction::Antithetic;
+    return cfg;
+}
+
+void flat_local_vol_is_black_scholes() {
+    const FlatVolatility flat(0.25);
+    const auto surface =
+        std::make_shared<const LocalVolSurface>(LocalVolSurface::from_implied(flat, 100.0, kRate, 2.0));
+    for (double t : {0.0, 0.3, 1.0, 2.0})
+        for (double y : {-1.0, 0.0, 0.5}) CHECK_NEAR(surface->local_vol(t, y), 0.25, 1e-6);
+    const MonteCarloPricer<PhiloxRng> pricer(config());
+    const LocalVolModel model(surface);
+    for (double K : {80.0, 100.0, 120.0}) {
+        const Option put(OptionType::Put, K, 1.5, 100.0);
+        const McResult r = pricer.price(put, kRate, model);
+        CHECK_NEAR(r.price, BlackScholes::price(put, kRate, 0.25), 4.0 * r.std_error);
+    }
+}
+
+// A smile and a term structure; vanillas priced under the Dupire local
+// vol come back at the implied vol they were built from
+void smile_reprices() {
+    const std::vector<double> strikes{60.0, 80.0, 90.0, 100.0, 110.0, 120.0, 150.0};
+    const std::vector<double> maturities{0.25, 0.5, 1.0, 2.0};
+    std::vector<double> vols;
+    for (double t : maturities)
+        for (double k : strikes) {
+            const double y = std::log(k / 100.0);
+            vols.push_back(0.22 + 0.02 * t - 0.08 * y + 0.1 * y * y);
+        }
+    const GridVolSurface implied(strikes, maturities, vols);
+    const LocalVolModel model(
+        std::make_shared<const LocalVolSurface>(LocalVolSurface::from_implied(implied, 100.0, kRate, 2.0)));
+    const MonteCarloPricer<PhiloxRng> pricer(config());
+    for (double K : {90.0, 100.0, 110.0}) {
+        const Option call(OptionType::Call, K, 1.0, 100.0);
+        const double vol = implied.volatility(K, 1.0);
+        const McResult r = pricer.price(call, kRate, model);
+        const double vega = BlackScholes::greeks(call, kRate, vol).vega;
+        CHECK_NEAR(r.price, BlackScholes::price(call, kRate, vol), 4.0 * r.std_error + 1e-4 * vega);
+    }
+}
+
+// With vanishing vol of variance started at its mean, Heston is GBM at
+// sqrt(v0)
+void heston_gbm_limit() {
+    const HestonModel model(HestonParams{0.0625, 1.0, 0.0625, 1e-4, -0.5});
+    const MonteCarloPricer<PhiloxRng> pricer(config());
+    const Option put(OptionType::Put, 105.0, 1.5, 100.0);
+    const McResult r = pricer.price(put, kRate, model);
+    CHECK_NEAR(r.price, BlackScholes::price(put, kRate, 0.25), 4.0 * r.std_error + 1e-3);
+}
+
+void invalid_inputs_throw() {
+    const auto throws = [](auto&& f) {
+        try {
+            f();
+        } catch (const std::invalid_argument&) {
+            return true;
+        }
+        return false;
+    };
+    CHECK(throws([] { LocalVolSurface(1.0, 1, -1.0, 1.0, 3, std::vector<double>(3, 0.2)); }));
+    CHECK(throws([] { LocalVolSurface(1.0, 2, -1.0, 1.0, 3, std::vector<double>(5, 0.2)); }));
+    CHECK(throws([] { LocalVolModel(nullptr); }));
+    CHECK(throws([] { HestonModel(HestonParams{0.04, 1.0, 0.04, 0.5, -1.5}); }));
+    CHECK(throws([] { HestonModel(HestonParams{-0.01, 1.0, 0.04, 0.5, 0.0}); }));
+    // The control variate is the GBM closed form
+    McConfig cfg = config();
+    cfg.paths = 1000;
+    cfg.variance_reduction = VarianceReduction::ControlVariate;
+    const HestonModel heston(HestonParams{0.04, 1.0, 0.04, 0.5, -0.7});
+    const Option call(OptionType::Call, 100.0, 1.0, 100.0);
+    CHECK(throws([&] { MonteCarloPricer<PhiloxRng>(cfg).price(call, kRate, heston); }));
+}
+
+}
+
+int main() {
+    flat_local_vol_is_black_scholes();
+    smile_reprices();
+    heston_gbm_limit();
+    invalid_inputs_throw();
+    return aemps_test::result("test_dynamics");
+}
@@ -0,0 +1,81 @@
+// Heston COS prices against Fang & Oosterlee's reference value, parity,
+// strip and book entry points, and the QE Monte Carlo scheme
+#include <cmath>
+#include <vector>
+#include "check.h"
+#include "dynamics.h"
+#include "heston.h"
+#include "monte_carlo_pricer.h"
+#include "rng.h"
+
+using namespace aemps;
+
+namespace {
+
+// Fang & Oosterlee (2008), section 5.2: v0 0.0175, kappa 1.5768, theta
+// 0.0398, xi 0.5751, rho -0.5711, S = K = 100, T = 1, r = 0
+const HestonParams kFangOosterlee{0.0175, 1.5768, 0.0398, 0.5751, -0.5711};
+constexpr double kReferenceCall = 5.785155450;
+
+void matches_reference() {
+    const HestonAnalytic heston(kFangOosterlee);
+    CHECK_NEAR(heston.price(Option(OptionType::Call, 100.0, 1.0, 100.0), 0.0), kReferenceCall, 1e-7);
+}
+
+void put_call_parity() {
+    const HestonAnalytic heston(kFangOosterlee);
+    const double rate = 0.03;
+    for (double strike : {70.0, 90.0, 100.0, 110.0, 140.0}) {
+        for (double T : {0.1, 1.0, 3.0}) {
+            const double call = heston.price(Option(OptionType::Call, strike, T, 100.0), rate);
+            const double put = heston.price(Option(OptionType::Put, strike, T, 100.0), rate);
+            CHECK_NEAR(call - put, 100.0 - strike * std::exp(-rate * T), 1e-8);
+        }
+    }
+}
+
+void strip_and_book_match_single_prices() {
+    const HestonAnalytic heston(kFangOosterlee);
+    const double rate = 0.01;
+    OptionBook book;
+    for (int i = 0; i < 21; ++i)
+        book.push_back(Option(i % 3 ? OptionType::Call : OptionType::Put, 60.0 + 4.0 * i, i < 10 ? 0.5 : 2.0, 100.0),
+                       0.0, rate);
+    std::vector<double> prices(book.size());
+    heston.price(book.view(), prices.data());
+    for (std::size_t i = 0; i < book.size(); ++i) {
+        const double single =
+            heston.price(Option(book.type[i], book.strike[i], book.maturity[i], book.spot[i]), rate);
+        // Strips truncate on a range set by their extreme strikes, so the
+        // two differ within the series' accuracy
+        CHECK_NEAR(prices[i], single, 1e-7);
+    }
+}
+
+void monte_carlo_agrees() {
+    McConfig config;
+    config.paths = 200000;
+    config.steps = 50;
+    config.variance_reduction = VarianceReduction::Antithetic;
+    const Option atm(OptionType::Call, 100.0, 1.0, 100.0);
+    const McResult r = MonteCarloPricer<PhiloxRng>(config).price(atm, 0.0, HestonModel(kFangOosterlee));
+    // QE discretisation bias at 50 steps is well inside the statistics
+    CHECK_NEAR(r.price, kReferenceCall, 4.0 * r.std_error + 0.01);
+    // Sobol' with a bridge per factor; std_error overstates the QMC error
+    config.paths = 1 << 15;
+    config.steps = 32;
+    const McResult q =
+        MonteCarloPricer<SobolRng, ThreadPoolExecutor, BrownianBridgePath>(config).price(atm, 0.0,
+                                                                                    HestonModel(kFangOosterlee));
+    CHECK_NEAR(q.price, kReferenceCall, 4.0 * q.std_error + 0.01);
+}
+
+}
+
+int main() {
+    matches_reference();
+    put_call_parity();
+    strip_and_book_match_single_prices();
+    monte_carlo_agrees();
+    return aemps_test::result("test_heston");
+}
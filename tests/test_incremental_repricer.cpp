@@ -0,0 +1,162 @@
+// Incremental repricing: after every burst of random ticks the cached
+// positions and totals equal a from-scratch valuation, only dependent
+// positions are revalued, and bad updates change nothing
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "black_scholes.h"
+#include "check.h"
+#include "incremental_repricer.h"
+#include "option.h"
+#include "volatility_model.h"
+
+using namespace aemps;
+
+namespace {
+
+const std::vector<double> kStrikes{70.0, 85.0, 100.0, 115.0, 130.0};
+const std::vector<double> kMaturities{0.25, 0.5, 1.0, 2.0};
+
+// The market as the test sees it, priced from scratch
+struct Market {
+    std::vector<double> spot, rate;
+    std::vector<std::vector<double>> vols;
+};
+
+struct Position {
+    std::size_t underlier;
+    OptionType type;
+    double strike, maturity, quantity;
+};
+
+void check_against_scratch(const IncrementalRepricer& repricer, const Market& market,
+                           const std::vector<Position>& positions) {
+    std::vector<Greeks> totals(market.spot.size(), Greeks{});
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+        const Position& p = positions[i];
+        const GridVolSurface surface(kStrikes, kMaturities, market.vols[p.underlier]);
+        const double spot = market.spot[p.underlier];
+        const Greeks ref = BlackScholes::greeks(Option(p.type, p.strike, p.maturity, spot), market.rate[p.underlier],
+                                                surface.volatility(p.strike, p.maturity));
+        const Greeks got = repricer.position(i);
+        CHECK_NEAR(got.price, ref.price, 2e-14 * spot);
+        CHECK_NEAR(got.delta, ref.delta, 2e-14);
+        CHECK_NEAR(got.vega, ref.vega, 2e-14 * spot);
+        Greeks& t = totals[p.underlier];
+        t.price += p.quantity * ref.price;
+        t.delta += p.quantity * ref.delta;
+        t.gamma += p.quantity * ref.gamma;
+        t.vega += p.quantity * ref.vega;
+    }
+    for (std::size_t u = 0; u < totals.size(); ++u) {
+        const Greeks& got = repricer.totals(u);
+        CHECK_NEAR(got.price, totals[u].price, 1e-10 * market.spot[u]);
+        CHECK_NEAR(got.delta, totals[u].delta, 1e-10);
+        CHECK_NEAR(got.gamma, totals[u].gamma, 1e-10);
+        CHECK_NEAR(got.vega, totals[u].vega, 1e-10 * market.spot[u]);
+    }
+}
+
+void random_ticks_match_full_valuation() {
+    std::mt19937_64 gen(21);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    IncrementalRepricer repricer;
+    Market market;
+    for (std::size_t k = 0; k < 3; ++k) {
+        market.spot.push_back(80.0 + 20.0 * k);
+        market.rate.push_back(0.01 * k);
+        std::vector<double> vols;
+        for (std::size_t n = 0; n < kStrikes.size() * kMaturities.size(); ++n) vols.push_back(0.15 + 0.2 * u(gen));
+        market.vols.push_back(vols);
+        CHECK(repricer.add_underlier(market.spot[k], market.rate[k], kStrikes, kMaturities, vols) == k);
+    }
+    std::vector<Position> positions;
+    for (std::size_t i = 0; i < 300; ++i) {
+        const Position p{i % 3, i % 2 ? OptionType::Put : OptionType::Call, 60.0 + 80.0 * u(gen),
+                         0.1 + 2.5 * u(gen), u(gen) < 0.3 ? -1.0 - u(gen) : 1.0 + 4.0 * u(gen)};
+        CHECK(repricer.add_position(p.underlier, p.type, p.strike, p.maturity, p.quantity) == i);
+        positions.push_back(p);
+    }
+    check_against_scratch(repricer, market, positions);
+
+    std::uniform_int_distribution<std::size_t> name(0, 2), node(0, kStrikes.size() * kMaturities.size() - 1);
+    for (int burst = 0; burst < 200; ++burst) {
+        std::vector<MarketUpdate> updates;
+        const int n = 1 + burst % 5;
+        for (int j = 0; j < n; ++j) {
+            const std::size_t k = name(gen);
+            const double draw = u(gen);
+            if (draw < 0.4) {
+                market.spot[k] *= std::exp(0.01 * (u(gen) - 0.5));
+                updates.push_back(MarketUpdate::spot(k, market.spot[k]));
+            } else if (draw < 0.5) {
+                market.rate[k] = 0.05 * u(gen);
+                updates.push_back(MarketUpdate::rate(k, market.rate[k]));
+            } else {
+                const std::size_t m = node(gen);
+                market.vols[k][m] = 0.15 + 0.2 * u(gen);
+                updates.push_back(MarketUpdate::vol(k, m, market.vols[k][m]));
+            }
+        }
+        repricer.apply(updates.data(), updates.size());
+        if (burst % 20 == 0) check_against_scratch(repricer, market, positions);
+    }
+    check_against_scratch(repricer, market, positions);
+    repricer.reprice_all();
+    check_against_scratch(repricer, market, positions);
+}
+
+// A spot tick touches exactly its underlier's positions; a vol node only
+// the positions interpolating from it
+void only_dependents_are_revalued() {
+    IncrementalRepricer repricer;
+    const std::vector<double> vols(kStrikes.size() * kMaturities.size(), 0.2);
+    repricer.add_underlier(100.0, 0.02, kStrikes, kMaturities, vols);
+    repricer.add_underlier(50.0, 0.02, kStrikes, kMaturities, vols);
+    for (int i = 0; i < 10; ++i) repricer.add_position(0, OptionType::Call, 72.0 + 5.0 * i, 0.3, 1.0);
+    for (int i = 0; i < 4; ++i) repricer.add_position(1, OptionType::Put, 90.0, 1.5, 1.0);
+    CHECK(repricer.apply(MarketUpdate::spot(0, 101.0)) == 10);
+    CHECK(repricer.apply(MarketUpdate::rate(1, 0.03)) == 4);
+    // Node (m = 3, k = 0) is the 2y, 70 strike: nothing reads it
+    CHECK(repricer.apply(MarketUpdate::vol(0, 3 * kStrikes.size(), 0.3)) == 0);
+    // Node (m = 1, k = 1), 0.5y at 85, under the 0.3y contracts at 72-97
+    const std::size_t touched = repricer.apply(MarketUpdate::vol(0, kStrikes.size() + 1, 0.25));
+    CHECK(touched > 0 && touched < 10);
+    // A burst revalues each position once
+    const MarketUpdate burst[] = {MarketUpdate::spot(1, 49.0), MarketUpdate::spot(1, 48.0),
+                                  MarketUpdate::vol(1, 2 * kStrikes.size() + 2, 0.3)};
+    CHECK(repricer.apply(burst, 3) == 4);
+}
+
+void bad_updates_change_nothing() {
+    IncrementalRepricer repricer;
+    repricer.add_underlier(100.0, 0.02, kStrikes, kMaturities,
+                           std::vector<double>(kStrikes.size() * kMaturities.size(), 0.2));
+    repricer.add_position(0, OptionType::Call, 100.0, 1.0, 2.0);
+    const double before = repricer.totals(0).price;
+    const auto throws = [&](auto&& f) {
+        try {
+            f();
+        } catch (const std::out_of_range&) {
+            return true;
+        }
+        return false;
+    };
+    const MarketUpdate burst[] = {MarketUpdate::spot(0, 120.0), MarketUpdate::spot(1, 10.0)};
+    CHECK(throws([&] { repricer.apply(burst, 2); }));
+    CHECK(throws([&] { repricer.apply(MarketUpdate::vol(0, kStrikes.size() * kMaturities.size(), 0.3)); }));
+    CHECK(throws([&] { repricer.add_position(1, OptionType::Put, 100.0, 1.0); }));
+    CHECK(repricer.totals(0).price == before && repricer.positions() == 1);
+}
+
+}
+
+int main() {
+    random_ticks_match_full_valuation();
+    only_dependents_are_revalued();
+    bad_updates_change_nothing();
+    return aemps_test::result("test_incremental_repricer");
+}
@@ -0,0 +1,392 @@
+// Monte Carlo engine: agreement with Black-Scholes and other closed forms,
+// results independent of the thread count and of how blocks are split,
+// scenario runs equal to separate runs, and Longstaff-Schwartz against a
+// lattice
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "black_scholes.h"
+#include "check.h"
+#include "monte_carlo_pricer.h"
+#include "path_builder.h"
+#include "payoff.h"
+#include "rng.h"
+#include "scenario.h"
+#include "thread_pool.h"
+#include "utils.h"
+
+using namespace aemps;
+
+namespace {
+
+const Option kPut(OptionType::Put, 105.0, 1.5, 100.0);
+constexpr double kRate = 0.03, kVol = 0.25;
+constexpr int kModes = 4;
+
+bool same(const McResult& a, const McResult& b) {
+    bool equal = a.price == b.price && a.std_error == b.std_error && a.paths == b.paths;
+    equal = equal && a.beta == b.beta;
+    equal = equal && a.delta == b.delta && a.gamma == b.gamma && a.vega == b.vega;
+    return equal;
+}
+
+McConfig config_for(int mode) {
+    McConfig config;
+    config.paths = 40000;
+    config.steps = 8;
+    config.block_size = 1000;
+    config.variance_reduction = static_cast<VarianceReduction>(mode);
+    config.greeks = true;
+    return config;
+}
+
+void matches_black_scholes() {
+    const double bs = BlackScholes::price(kPut, kRate, kVol);
+    const Greeks g = BlackScholes::greeks(kPut, kRate, kVol);
+    for (int mode = 0; mode < kModes; ++mode) {
+        McConfig config = config_for(mode);
+        config.paths = 200000;
+        const McResult r = MonteCarloPricer<>(config).price(kPut, kRate, kVol);
+        // The put is its own control variate, which leaves no error bar
+        CHECK_NEAR(r.price, bs, 4.0 * r.std_error + 1e-12);
+        CHECK_NEAR(r.delta, g.delta, 4.0 * r.delta_error);
+        CHECK_NEAR(r.gamma, g.gamma, 4.0 * r.gamma_error);
+        CHECK_NEAR(r.vega, g.vega, 4.0 * r.vega_error);
+    }
+}
+
+template <class Rng, class PathBuilder = IncrementalPath>
+void thread_count_invariant(ThreadPool& pool) {
+    for (int mode = 0; mode < kModes; ++mode) {
+        const McConfig config = config_for(mode);
+        const McResult serial = MonteCarloPricer<Rng, SerialExecutor, PathBuilder>(config).price(kPut, kRate, kVol);
+        const McResult pooled =
+            MonteCarloPricer<Rng, ThreadPoolExecutor, PathBuilder>(config, ThreadPoolExecutor(pool)).price(kPut, kRate,
+                                                                                                            kVol);
+        CHECK(same(serial, pooled));
+    }
+}
+
+// path() replays exactly the paths that price() averaged
+template <class Rng, class PathBuilder = IncrementalPath>
+void paths_replay_the_simulation() {
+    McConfig config;
+    config.paths = 301;
+    config.steps = 4;
+    config.block_size = 100;
+    const MonteCarloPricer<Rng, SerialExecutor, PathBuilder> pricer(config);
+    const McResult r = pricer.price(kPut, kRate, kVol);
+    double sum = 0.0;
+    for (std::uint64_t i = 0; i < config.paths; ++i) {
+        const std::vector<double> p = pricer.path(kPut, kRate, kVol, i);
+        CHECK(p.size() == config.steps + 1 && p.front() == kPut.spot);
+        sum += std::max(kPut.strike - p.back(), 0.0);
+    }
+    CHECK_NEAR(std::exp(-kRate * kPut.maturity) * sum / config.paths, r.price, 1e-12 * r.price);
+    bool threw = false;
+    try {
+        pricer.path(kPut, kRate, kVol, config.paths);
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+void variance_reduction_modes() {
+    McConfig config;
+    config.paths = 100001;
+    config.steps = 1;
+    const Option call(OptionType::Call, 100.0, 1.0, 100.0);
+    const McResult plain = MonteCarloPricer<>(config).price(call, kRate, kVol);
+    config.variance_reduction = VarianceReduction::Antithetic;
+    const McResult anti = MonteCarloPricer<>(config).price(call, kRate, kVol);
+    // An odd path count is rounded up to whole pairs
+    CHECK(plain.paths == 100001 && anti.paths == 100002);
+    CHECK(anti.std_error < 0.8 * plain.std_error);
+    CHECK(plain.beta == 0.0 && anti.beta == 0.0);
+    // A vanilla is its own control, so the estimate is the closed form
+    config.variance_reduction = VarianceReduction::ControlVariate;
+    const McResult cv = MonteCarloPricer<>(config).price(call, kRate, kVol);
+    CHECK_NEAR(cv.beta, 1.0, 1e-9);
+    CHECK_NEAR(cv.price, BlackScholes::price(call, kRate, kVol), 1e-9);
+}
+
+// Scrambled Sobol' with a bridge lands far inside its i.i.d. error bar
+void sobol_bridge_beats_its_error_bar() {
+    McConfig config;
+    config.paths = 1 << 16;
+    config.steps = 16;
+    const MonteCarloPricer<SobolRng, ThreadPoolExecutor, BrownianBridgePath> pricer(config);
+    const McResult r = pricer.price(kPut, kRate, kVol);
+    CHECK_NEAR(r.price, BlackScholes::price(kPut, kRate, kVol), 0.25 * r.std_error);
+}
+
+void likelihood_ratio_greeks_agree() {
+    McConfig config = config_for(0);
+    config.paths = 400000;
+    config.greek_method = GreekMethod::LikelihoodRatio;
+    const Greeks bs = BlackScholes::greeks(kPut, kRate, kVol);
+    const McResult r = MonteCarloPricer<>(config).price(kPut, kRate, kVol);
+    CHECK_NEAR(r.delta, bs.delta, 4.0 * r.delta_error);
+    CHECK_NEAR(r.gamma, bs.gamma, 4.0 * r.gamma_error);
+    CHECK_NEAR(r.vega, bs.vega, 4.0 * r.vega_error);
+}
+
+// Cash-or-nothing digital against e^{-rT} N(d2); Auto picks
+// likelihood-ratio Greeks for its discontinuous payoff
+void digital_matches_closed_form() {
+    McConfig config = config_for(1);
+    config.paths = 400000;
+    const double K = 100.0, S = 100.0, T = 1.0, sqrt_T = std::sqrt(T);
+    const double d2 = (std::log(S / K) + (kRate - 0.5 * kVol * kVol) * T) / (kVol * sqrt_T);
+    const double df = std::exp(-kRate * T);
+    const McResult r = MonteCarloPricer<>(config).price(DigitalCallPayoff{K}, S, T, kRate, kVol);
+    CHECK_NEAR(r.price, df * norm_cdf(d2), 4.0 * r.std_error);
+    CHECK_NEAR(r.delta, df * norm_pdf(d2) / (S * kVol * sqrt_T), 4.0 * r.delta_error);
+    CHECK_NEAR(r.vega, -df * norm_pdf(d2) * (d2 + kVol * sqrt_T) / kVol, 4.0 * r.vega_error);
+}
+
+// Discretely monitored geometric Asian: ln G is normal with mean
+// ln S + (r - vol^2 / 2) dt (n + 1) / 2 and variance vol^2 dt (n + 1)(2n + 1) / (6n)
+void geometric_asian_matches_closed_form() {
+    McConfig config;
+    config.paths = 200000;
+    config.steps = 12;
+    config.variance_reduction = VarianceReduction::Antithetic;
+    const double K = 100.0, S = 100.0, T = 1.0, n = 12.0, dt = T / n;
+    const double mu = std::log(S) + (kRate - 0.5 * kVol * kVol) * dt * (n + 1.0) / 2.0;
+    const double var = kVol * kVol * dt * (n + 1.0) * (2.0 * n + 1.0) / (6.0 * n);
+    const double d2 = (mu - std::log(K)) / std::sqrt(var), d1 = d2 + std::sqrt(var);
+    const double ref = std::exp(-kRate * T) * (std::exp(mu + 0.5 * var) * norm_cdf(d1) - K * norm_cdf(d2));
+    const MonteCarloPricer<PhiloxRng> pricer(config);
+    const McResult r = pricer.price(AsianPayoff<OptionType::Call, Averaging::Geometric>{K}, S, T, kRate, kVol);
+    CHECK_NEAR(r.price, ref, 4.0 * r.std_error);
+    // The arithmetic average dominates the geometric one
+    const McResult arithmetic = pricer.price(AsianPayoff<OptionType::Call>{K}, S, T, kRate, kVol);
+    CHECK(arithmetic.price > r.price);
+}
+
+// Knock-in plus knock-out is the vanilla, path by path
+void barrier_parity_and_lookback_bound() {
+    McConfig config;
+    config.paths = 50000;
+    config.steps = 20;
+    const MonteCarloPricer<PhiloxRng> pricer(config);
+    const double K = 100.0, S = 100.0, T = 1.0, B = 120.0;
+    const McResult in = pricer.price(BarrierPayoff<OptionType::Call, BarrierKind::UpAndIn>{K, B}, S, T, kRate, kVol);
+    const McResult out = pricer.price(BarrierPayoff<OptionType::Call, BarrierKind::UpAndOut>{K, B}, S, T, kRate, kVol);
+    const McResult vanilla = pricer.price(CallPayoff{K}, S, T, kRate, kVol);
+    CHECK_NEAR(in.price + out.price, vanilla.price, 1e-12 * vanilla.price);
+    CHECK(in.price > 0.0 && out.price > 0.0);
+    const McResult down_in = pricer.price(BarrierPayoff<OptionType::Put, BarrierKind::DownAndIn>{K, 80.0}, S, T, kRate,
+                                          kVol);
+    const McResult down_out = pricer.price(BarrierPayoff<OptionType::Put, BarrierKind::DownAndOut>{K, 80.0}, S, T,
+                                           kRate, kVol);
+    const McResult put = pricer.price(PutPayoff{K}, S, T, kRate, kVol);
+    CHECK_NEAR(down_in.price + down_out.price, put.price, 1e-12 * put.price);
+    // A barrier already breached at inception knocks in for sure
+    const McResult breached = pricer.price(BarrierPayoff<OptionType::Call, BarrierKind::UpAndIn>{K, 90.0}, S, T, kRate,
+                                           kVol);
+    CHECK_NEAR(breached.price, vanilla.price, 1e-12 * vanilla.price);
+    // The running maximum is at least the terminal spot
+    const McResult lookback = pricer.price(LookbackPayoff<OptionType::Call>{K}, S, T, kRate, kVol);
+    CHECK(lookback.price > vanilla.price);
+}
+
+// In-pass Greeks come from the terminal spot, so path-dependent payoffs
+// turn them down rather than report zeros
+void path_dependent_greeks_rejected() {
+    McConfig config;
+    config.paths = 1000;
+    config.steps = 4;
+    config.greeks = true;
+    const MonteCarloPricer<PhiloxRng> pricer(config);
+    const auto rejects = [](auto&& price) {
+        try {
+            price();
+        } catch (const std::invalid_argument&) {
+            return true;
+        }
+        return false;
+    };
+    CHECK(rejects([&] { pricer.price(AsianPayoff<OptionType::Call>{100.0}, 100.0, 1.0, kRate, kVol); }));
+    CHECK(rejects([&] {
+        pricer.price(BarrierPayoff<OptionType::Call, BarrierKind::UpAndOut>{100.0, 120.0}, 100.0, 1.0, kRate, kVol);
+    }));
+    CHECK(rejects([&] {
+        pricer.simulate_blocks(LookbackPayoff<OptionType::Call>{100.0}, 100.0, 1.0, kRate, kVol, 0, 1);
+    }));
+    CHECK(!rejects([&] { pricer.price(CallPayoff{100.0}, 100.0, 1.0, kRate, kVol); }));
+}
+
+// Welford moments do not cancel at a large offset, and merging partials
+// is the same as one pass
+void path_stats_are_stable() {
+    PathStats all, head, tail;
+    const std::size_t n = 10000;
+    for (std::size_t i = 0; i < n; ++i) {
+        const double x = 1e9 + static_cast<double>(i % 10);
+        all.add(x);
+        (i < 3333 ? head : tail).add(x);
+    }
+    head.merge(tail);
+    const double var = 8.25 * n / (n - 1); // of 0..9, sample
+    CHECK_NEAR(all.result(1.0).std_error, std::sqrt(var / n), 1e-9);
+    CHECK_NEAR(head.result(1.0).std_error, std::sqrt(var / n), 1e-9);
+    CHECK_NEAR(head.result(1.0).price, 1e9 + 4.5, 1e-6);
+}
+
+void adaptive_mode_stops_at_target(ThreadPool& pool) {
+    McConfig config;
+    config.paths = 4000000;
+    config.block_size = 1000;
+    config.target_std_error = 0.02;
+    const McResult serial = MonteCarloPricer<PhiloxRng, SerialExecutor>(config).price(kPut, kRate, kVol);
+    const McResult pooled = MonteCarloPricer<PhiloxRng>(config, ThreadPoolExecutor(pool)).price(kPut, kRate, kVol);
+    CHECK(serial.converged && serial.std_error <= 0.02);
+    CHECK(serial.paths < config.paths && serial.paths % (config.adaptive_round * config.block_size) == 0);
+    CHECK(same(serial, pooled) && serial.converged == pooled.converged);
+    // The round before stopping was short of the target
+    config.paths = serial.paths - config.adaptive_round * config.block_size;
+    config.target_std_error = 0.0;
+    CHECK(MonteCarloPricer<PhiloxRng>(config).price(kPut, kRate, kVol).std_error > 0.02);
+    // An unreachable target runs to the cap
+    config.paths = 20000;
+    config.target_std_error = 1e-6;
+    const McResult capped = MonteCarloPricer<PhiloxRng>(config).price(kPut, kRate, kVol);
+    CHECK(!capped.converged && capped.paths == 20000);
+}
+
+void block_ranges_combine_to_price() {
+    const McConfig config = config_for(3);
+    const MonteCarloPricer<PhiloxRng> pricer(config);
+    const std::size_t blocks = pricer.blocks(), half = blocks / 2;
+    std::vector<PathStats> partials = pricer.simulate_blocks(kPut, kRate, kVol, 0, half);
+    const std::vector<PathStats> rest = pricer.simulate_blocks(kPut, kRate, kVol, half, blocks - half);
+    partials.insert(partials.end(), rest.begin(), rest.end());
+    CHECK(same(pricer.combine(kPut, kRate, kVol, partials), pricer.price(kPut, kRate, kVol)));
+    partials.pop_back();
+    bool threw = false;
+    try {
+        pricer.combine(kPut, kRate, kVol, partials);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+void scenarios_equal_separate_runs() {
+    ScenarioSet scenarios;
+    for (int k = 0; k < 5; ++k) scenarios.push_back(0.02 * (k - 2), 0.01 * (k - 2), 0.002 * k);
+    for (int mode = 0; mode < 4; ++mode) {
+        const McConfig config = config_for(mode);
+        const MonteCarloPricer<PhiloxRng> pricer(config);
+        const std::vector<McResult> all = pricer.price(kPut, kRate, kVol, scenarios);
+        CHECK(all.size() == scenarios.size());
+        for (std::size_t k = 0; k < scenarios.size(); ++k) {
+            const Option shifted(kPut.type, kPut.strike, kPut.maturity, kPut.spot * (1.0 + scenarios.spot[k]));
+            CHECK(same(all[k], pricer.price(shifted, kRate + scenarios.rate[k], kVol + scenarios.vol[k])));
+        }
+    }
+    // A spot shift of -1 or below leaves no spot to simulate
+    for (double shift : {-1.0, -1.5}) {
+        ScenarioSet bad = scenarios;
+        bad.spot[1] = shift;
+        bool threw = false;
+        try {
+            MonteCarloPricer<PhiloxRng>(config_for(0)).price(kPut, kRate, kVol, bad);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        CHECK(threw);
+    }
+}
+
+// Cox-Ross-Rubinstein tree exercising every `every` steps
+double bermudan_tree(const Option& opt, double rate, double vol, int steps, int every) {
+    const double dt = opt.maturity / steps, u = std::exp(vol * std::sqrt(dt)), d = 1.0 / u;
+    const double p = (std::exp(rate * dt) - d) / (u - d), df = std::exp(-rate * dt);
+    const auto intrinsic = [&](int k, int i) {
+        const double S = opt.spot * std::pow(u, i) * std::pow(d, k - i);
+        return opt.type == OptionType::Put ? std::max(opt.strike - S, 0.0) : std::max(S - opt.strike, 0.0);
+    };
+    std::vector<double> v(steps + 1);
+    for (int i = 0; i <= steps; ++i) v[i] = intrinsic(steps, i);
+    for (int k = steps - 1; k >= 0; --k) {
+        for (int i = 0; i <= k; ++i) {
+            v[i] = df * (p * v[i + 1] + (1.0 - p) * v[i]);
+            if (k > 0 && k % every == 0) v[i] = std::max(v[i], intrinsic(k, i));
+        }
+    }
+    return v[0];
+}
+
+void longstaff_schwartz_matches_lattice() {
+    McConfig config;
+    config.paths = 200000;
+    config.variance_reduction = VarianceReduction::AntitheticControlVariate;
+    const MonteCarloPricer<PhiloxRng> pricer(config);
+    ExerciseConfig exercise;
+    exercise.dates = 50;
+    const Option puts[] = {Option(OptionType::Put, 40.0, 1.0, 36.0), Option(OptionType::Put, 40.0, 2.0, 44.0),
+                           Option(OptionType::Put, 100.0, 0.5, 100.0)};
+    for (const Option& put : puts) {
+        const double vol = put.spot == 44.0 ? 0.4 : 0.2;
+        const McResult r = pricer.price_american(put, 0.06, vol, exercise);
+        const double tree = bermudan_tree(put, 0.06, vol, 5000, 100);
+        // Out-of-sample LSM is biased low, by well under a cent here
+        CHECK_NEAR(r.price, tree, 4.0 * r.std_error + 0.01);
+        CHECK(r.price > BlackScholes::price(put, 0.06, vol));
+    }
+    // Without early exercise it is the European
+    exercise.dates = 1;
+    const McResult euro = pricer.price_american(kPut, kRate, kVol, exercise);
+    CHECK_NEAR(euro.price, BlackScholes::price(kPut, kRate, kVol), 4.0 * euro.std_error);
+
+    exercise.basis = ExerciseConfig::kMaxBasis + 1;
+    bool threw = false;
+    try {
+        pricer.price_american(kPut, kRate, kVol, exercise);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+void longstaff_schwartz_thread_count_invariant(ThreadPool& pool) {
+    McConfig config = config_for(1);
+    config.greeks = false;
+    const McResult serial = MonteCarloPricer<PhiloxRng, SerialExecutor>(config).price_american(kPut, kRate, kVol);
+    const McResult pooled =
+        MonteCarloPricer<PhiloxRng>(config, ThreadPoolExecutor(pool)).price_american(kPut, kRate, kVol);
+    CHECK(same(serial, pooled));
+}
+
+}
+
+int main() {
+    ThreadPool pool(3);
+    matches_black_scholes();
+    thread_count_invariant<Mt19937Rng>(pool);
+    thread_count_invariant<PhiloxRng>(pool);
+    thread_count_invariant<SobolRng, BrownianBridgePath>(pool);
+    paths_replay_the_simulation<Mt19937Rng>();
+    paths_replay_the_simulation<PhiloxRng>();
+    paths_replay_the_simulation<SobolRng, BrownianBridgePath>();
+    variance_reduction_modes();
+    sobol_bridge_beats_its_error_bar();
+    likelihood_ratio_greeks_agree();
+    digital_matches_closed_form();
+    geometric_asian_matches_closed_form();
+    barrier_parity_and_lookback_bound();
+    path_dependent_greeks_rejected();
+    path_stats_are_stable();
+    adaptive_mode_stops_at_target(pool);
+    block_ranges_combine_to_price();
+    scenarios_equal_separate_runs();
+    longstaff_schwartz_matches_lattice();
+    longstaff_schwartz_thread_count_invariant(pool);
+    return aemps_test::result("test_monte_carlo");
+}
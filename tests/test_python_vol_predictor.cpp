@@ -0,0 +1,111 @@
+// Embedded-Python predictor: the features reach Python as a read-only 2-D
+// float64 view, either result form is read back, Python errors surface as
+// std::runtime_error, and a model that holds on to its features is caught
+#include <cstddef>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "check.h"
+#include "python_vol_predictor.h"
+
+using namespace aemps;
+
+namespace {
+
+const char* kModule = R"(import array
+
+kept = []
+
+def first_plus(x):
+    return [0.1 + row[0] for row in x.tolist()]
+
+def shape(x):
+    assert x.readonly and x.format == "d"
+    return array.array("d", [10.0 * x.shape[0] + x.shape[1]] * x.shape[0])
+
+def keep_view(x):
+    kept.append(x)
+    return [0.0] * x.shape[0]
+
+def keep_slice(x):
+    kept.append(x[0:2])
+    return [0.0] * x.shape[0]
+
+def keep_cast(x):
+    kept.append(x.cast("B"))
+    return [0.0] * x.shape[0]
+
+def write(x):
+    x[0, 0] = 1.0
+
+def fail(x):
+    raise ValueError("no model")
+
+def short(x):
+    return [1.0]
+)";
+
+std::string module_dir() {
+    const std::string dir = "/tmp/aemps_test_" + std::to_string(::getpid()) + "_py";
+    ::mkdir(dir.c_str(), 0700);
+    std::ofstream(dir + "/aemps_test_model.py") << kModule;
+    return dir;
+}
+
+const std::vector<double> kFeatures{0.1, 1.0, 0.2, 2.0, 0.3, 3.0};
+const FeatureMatrix kMatrix{kFeatures.data(), 3, 2};
+
+bool throws(const std::string& dir, const char* function) {
+    const PythonVolPredictor model("aemps_test_model", function, dir);
+    std::vector<double> out(kMatrix.rows);
+    try {
+        model.predict(kMatrix, out.data());
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+void reads_the_features(const std::string& dir) {
+    std::vector<double> out(kMatrix.rows);
+    PythonVolPredictor("aemps_test_model", "first_plus", dir).predict(kMatrix, out.data());
+    for (std::size_t i = 0; i < kMatrix.rows; ++i) CHECK_NEAR(out[i], 0.1 + kFeatures[2 * i], 1e-15);
+    PythonVolPredictor("aemps_test_model", "shape", dir).predict(kMatrix, out.data());
+    for (double v : out) CHECK(v == 32.0);
+}
+
+// Keeping the view itself is harmless, since release() detaches it; a
+// slice or cast of it shares its buffer and outlives release()
+void held_features_are_caught(const std::string& dir) {
+    CHECK(!throws(dir, "keep_view"));
+    CHECK(throws(dir, "keep_slice"));
+    CHECK(throws(dir, "keep_cast"));
+    // The predictor stays usable afterwards
+    CHECK(!throws(dir, "first_plus"));
+}
+
+void errors_surface(const std::string& dir) {
+    CHECK(throws(dir, "write"));
+    CHECK(throws(dir, "fail"));
+    CHECK(throws(dir, "short"));
+    bool threw = false;
+    try {
+        PythonVolPredictor("aemps_test_model", "missing", dir);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+}
+
+int main() {
+    const std::string dir = module_dir();
+    reads_the_features(dir);
+    held_features_are_caught(dir);
+    errors_surface(dir);
+    return aemps_test::result("test_python_vol_predictor");
+}
@@ -0,0 +1,127 @@
+// Result cache: one computation per canonical request and epoch, late
+// inserts dropped, and readers that never see a torn value while a writer
+// churns the slots
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "black_scholes.h"
+#include "check.h"
+#include "monte_carlo_pricer.h"
+#include "option.h"
+#include "result_cache.h"
+#include "rng.h"
+
+using namespace aemps;
+
+namespace {
+
+const Option kCall(OptionType::Call, 100.0, 1.0, 100.0);
+
+void computes_once_per_key_and_epoch() {
+    ResultCache<Greeks> cache(256, 4);
+    CHECK(cache.capacity() >= 256);
+    int computed = 0;
+    const auto compute = [&] {
+        ++computed;
+        return BlackScholes::greeks(kCall, 0.02, 0.2);
+    };
+    const CacheKey key = make_cache_key(kBlackScholesTag, kCall, 0.02, 0.2);
+    const Greeks a = cache.get_or_compute(key, compute);
+    const Greeks b = cache.get_or_compute(key, compute);
+    CHECK(computed == 1 && a.price == b.price && a.vega == b.vega);
+    // Rounding noise maps to the same key, a real move does not
+    CHECK(make_cache_key(kBlackScholesTag, kCall, 0.02, 0.2 + 1e-14) == key);
+    CHECK(!(make_cache_key(kBlackScholesTag, kCall, 0.02, 0.2001) == key));
+    CHECK(!(make_cache_key(kBlackScholesTag, Option(OptionType::Put, 100.0, 1.0, 100.0), 0.02, 0.2) == key));
+    // A new snapshot invalidates everything
+    Greeks out;
+    cache.advance_epoch();
+    CHECK(!cache.find(key, out));
+    cache.get_or_compute(key, compute);
+    CHECK(computed == 2 && cache.find(key, out) && out.price == a.price);
+}
+
+// A value computed under an old snapshot never lands in the new one
+void late_inserts_are_dropped() {
+    ResultCache<Greeks> cache(64, 1);
+    const CacheKey key = make_cache_key(kBlackScholesTag, kCall, 0.02, 0.2);
+    const std::uint64_t started = cache.epoch();
+    CHECK(cache.advance_epoch() == started + 1);
+    cache.insert(key, BlackScholes::greeks(kCall, 0.02, 0.2), started);
+    Greeks out;
+    CHECK(!cache.find(key, out));
+    cache.insert(key, BlackScholes::greeks(kCall, 0.02, 0.2), cache.epoch());
+    CHECK(cache.find(key, out));
+}
+
+// Many more keys than slots, so the writer keeps overwriting what readers
+// are reading; every hit must be a whole value written for its key
+void concurrent_readers_see_whole_values() {
+    ResultCache<Greeks> cache(64, 2);
+    const std::size_t keys = 1000;
+    std::vector<CacheKey> key(keys);
+    for (std::size_t i = 0; i < keys; ++i)
+        key[i] = make_cache_key(kBlackScholesTag, Option(OptionType::Call, 50.0 + i, 1.0, 100.0), 0.02, 0.2);
+    const auto value_for = [](std::size_t i) {
+        Greeks g{};
+        g.price = g.delta = g.gamma = g.vega = g.theta = g.rho = static_cast<double>(i);
+        return g;
+    };
+    std::atomic<bool> done{false};
+    std::atomic<std::uint64_t> hits{0}, torn{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t)
+        readers.emplace_back([&, t] {
+            Greeks g;
+            for (std::size_t n = t; !done.load(std::memory_order_relaxed); ++n) {
+                const std::size_t i = n % keys;
+                if (!cache.find(key[i], g)) continue;
+                ++hits;
+                const double v = static_cast<double>(i);
+                if (g.price != v || g.delta != v || g.gamma != v || g.vega != v || g.theta != v || g.rho != v) ++torn;
+            }
+        });
+    for (int round = 0; round < 200; ++round) {
+        for (std::size_t i = 0; i < keys; ++i) cache.insert(key[i], value_for(i), cache.epoch());
+        if (round % 50 == 49) cache.advance_epoch();
+    }
+    done = true;
+    for (std::thread& t : readers) t.join();
+    CHECK(torn == 0);
+    CHECK(hits > 0);
+}
+
+void cached_engines_match_direct_calls() {
+    ResultCache<Greeks> greeks(256);
+    const Greeks g = cached_greeks(greeks, kCall, 0.02, 0.2);
+    CHECK(g.price == BlackScholes::greeks(kCall, 0.02, 0.2).price);
+    CHECK(cached_greeks(greeks, kCall, 0.02, 0.2).delta == g.delta);
+
+    McConfig config;
+    config.paths = 20000;
+    config.block_size = 1000;
+    const MonteCarloPricer<PhiloxRng> pricer(config);
+    ResultCache<McResult> results(256);
+    const McResult first = cached_price(results, pricer, kCall, 0.02, 0.2);
+    const McResult direct = pricer.price(kCall, 0.02, 0.2);
+    CHECK(first.price == direct.price && first.std_error == direct.std_error);
+    CHECK(cached_price(results, pricer, kCall, 0.02, 0.2).price == first.price);
+    // Another seed is another product
+    McConfig reseeded = config;
+    reseeded.seed = config.seed + 1;
+    CHECK(product_tag(reseeded, 1) != product_tag(config, 1) && product_tag(config, 2) != product_tag(config, 1));
+    const McResult other = cached_price(results, MonteCarloPricer<PhiloxRng>(reseeded), kCall, 0.02, 0.2);
+    CHECK(other.price != first.price);
+}
+
+}
+
+int main() {
+    computes_once_per_key_and_epoch();
+    late_inserts_are_dropped();
+    concurrent_readers_see_whole_values();
+    cached_engines_match_direct_calls();
+    return aemps_test::result("test_result_cache");
+}
@@ -0,0 +1,201 @@
+// Philox against the Random123 known answers, the vectorized kernels against
+// the scalar cipher and formulas, random access of every RNG policy, and the
+// Brownian bridge
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "check.h"
+#include "path_builder.h"
+#include "path_kernels.h"
+#include "rng.h"
+#include "utils.h"
+
+using namespace aemps;
+
+namespace {
+
+void philox_known_answers() {
+    // kat_vectors from Random123 1.09, philox4x32 with 10 rounds
+    struct Kat {
+        std::uint32_t ctr[4], key[2], out[4];
+    };
+    const Kat kats[] = {
+        {{0, 0, 0, 0}, {0, 0}, {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}},
+        {{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+         {0xffffffff, 0xffffffff},
+         {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}},
+        {{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344},
+         {0xa4093822, 0x299f31d0},
+         {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}},
+    };
+    for (const Kat& k : kats) {
+        const Philox4x32 r = philox4x32_10(Philox4x32{{k.ctr[0], k.ctr[1], k.ctr[2], k.ctr[3]}}, k.key[0], k.key[1]);
+        for (int w = 0; w < 4; ++w) CHECK(r.v[w] == k.out[w]);
+    }
+}
+
+void norm_inv_inverts_cdf() {
+    for (double p : {1e-300, 1e-12, 1e-5, 0.01, 0.02425, 0.2, 0.5, 0.7, 0.97575, 0.999, 1.0 - 1e-9}) {
+        const double x = norm_inv(p);
+        const double tail = x < 0.0 ? norm_cdf(x) : 1.0 - norm_cdf(x);
+        CHECK_NEAR(tail, x < 0.0 ? p : 1.0 - p, 1e-11 * (x < 0.0 ? p : 1.0 - p));
+    }
+    CHECK(norm_inv(0.5) == 0.0);
+}
+
+template <class Rng>
+void random_access() {
+    const Rng rng(7, 0);
+    std::vector<double> block(300), part(50);
+    rng.normals(0, block.size(), 2, block.data());
+    rng.normals(123, part.size(), 2, part.data());
+    for (std::size_t i = 0; i < part.size(); ++i) CHECK(part[i] == block[123 + i]);
+}
+
+void philox_single_draws() {
+    const PhiloxRng rng(99, 0);
+    std::vector<double> row(64);
+    rng.normals(1000, row.size(), 5, row.data());
+    for (std::size_t i = 0; i < row.size(); ++i) CHECK(rng.normal(1000 + i, 5) == row[i]);
+    // Other steps and seeds are other numbers
+    CHECK(rng.normal(1000, 6) != row[0]);
+    CHECK(PhiloxRng(100, 0).normal(1000, 5) != row[0]);
+}
+
+// philox_normals: inverse CDF of the top 52 bits of words 1:0 of the cipher
+// at counter (path, step), on (0, 1)
+void kernel_matches_scalar_cipher() {
+    const std::uint32_t k0 = 0x12345678, k1 = 0x9abcdef0;
+    const std::uint64_t first = (std::uint64_t(1) << 32) - 5; // path crosses a word boundary
+    const std::size_t n = 37, step = 3;
+    std::vector<double> z(n);
+    philox_normals(k0, k1, first, n, step, z.data());
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::uint64_t path = first + i;
+        const Philox4x32 r = philox4x32_10(
+            Philox4x32{{static_cast<std::uint32_t>(path), static_cast<std::uint32_t>(path >> 32),
+                        static_cast<std::uint32_t>(step), 0}},
+            k0, k1);
+        const std::uint64_t bits = (std::uint64_t(r.v[1]) << 32) | r.v[0];
+        const double u = (static_cast<double>(bits >> 12) + 0.5) * 0x1.0p-52;
+        CHECK_NEAR(z[i], norm_inv(u), 1e-12);
+    }
+}
+
+void path_kernels_match_scalar() {
+    const std::size_t n = 29;
+    std::vector<double> x(n), z(n), e(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        x[i] = -3.0 + 0.25 * static_cast<double>(i);
+        z[i] = std::sin(static_cast<double>(i));
+    }
+    std::vector<double> stepped = x;
+    gbm_advance(stepped.data(), z.data(), n, -0.01, 0.2);
+    exp_array(x.data(), e.data(), n);
+    for (std::size_t i = 0; i < n; ++i) {
+        CHECK_NEAR(stepped[i], x[i] + (-0.01 + 0.2 * z[i]), 1e-15);
+        CHECK_NEAR(e[i], std::exp(x[i]), 1e-15 * std::exp(x[i]));
+    }
+}
+
+void philox_moments() {
+    const std::size_t n = 1 << 18;
+    std::vector<double> z(n);
+    for (Precision precision : {Precision::Double, Precision::Single}) {
+        PhiloxRng(42, 0, precision).normals(0, n, 0, z.data());
+        double mean = 0.0, var = 0.0;
+        for (double x : z) mean += x;
+        mean /= n;
+        for (double x : z) var += (x - mean) * (x - mean);
+        var /= n - 1;
+        CHECK_NEAR(mean, 0.0, 5.0 / std::sqrt(double(n)));
+        CHECK_NEAR(var, 1.0, 5.0 * std::sqrt(2.0 / n));
+    }
+}
+
+// Scrambled points integrate the low moments far better than i.i.d. draws
+void sobol_moments() {
+    const std::size_t n = 1 << 14;
+    std::vector<double> z(n);
+    const SobolRng rng(3, 0);
+    for (std::size_t dim : {0, 1, 2, 7, 63, 511, 1023}) {
+        rng.normals(0, n, dim, z.data());
+        double mean = 0.0, second = 0.0;
+        for (double x : z) {
+            mean += x;
+            second += x * x;
+        }
+        CHECK_NEAR(mean / n, 0.0, 0.5 / std::sqrt(double(n)));
+        CHECK_NEAR(second / n, 1.0, 0.5 * std::sqrt(2.0 / n));
+    }
+    bool threw = false;
+    try {
+        rng.normals(0, 1, SobolRng::max_dimensions, z.data());
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+// Dimension 0 sets the endpoint, and the bridge is an orthogonal map of
+// the normals, so each lane keeps its norm
+void brownian_bridge_is_orthogonal() {
+    const std::size_t lanes = 5;
+    std::mt19937_64 gen(5);
+    std::normal_distribution<double> normal;
+    for (std::size_t steps : {1, 2, 7, 8, 13}) {
+        const BrownianBridge bridge(steps);
+        std::vector<double> z(steps * lanes), dz(steps * lanes);
+        for (double& v : z) v = normal(gen);
+        bridge.build(z.data(), lanes, dz.data());
+        for (std::size_t i = 0; i < lanes; ++i) {
+            double sum = 0.0, norm_z = 0.0, norm_dz = 0.0;
+            for (std::size_t s = 0; s < steps; ++s) {
+                sum += dz[s * lanes + i];
+                norm_z += z[s * lanes + i] * z[s * lanes + i];
+                norm_dz += dz[s * lanes + i] * dz[s * lanes + i];
+            }
+            CHECK_NEAR(sum, std::sqrt(double(steps)) * z[i], 1e-12);
+            CHECK_NEAR(norm_dz, norm_z, 1e-12 * norm_z);
+        }
+    }
+}
+
+// With several factors each one is bridged on its own, bridge point k of
+// factor f taken from dimension k * factors + f
+void bridge_path_per_factor() {
+    const SobolRng rng(7, 0);
+    const std::size_t steps = 6, factors = 2, count = 16;
+    ArenaScope scratch;
+    BrownianBridgePath path(steps, factors);
+    path.begin(rng, 0, count);
+    const BrownianBridge bridge(steps);
+    std::vector<double> z(steps * count), expected(steps * count), dz(count);
+    for (std::size_t f = 0; f < factors; ++f) {
+        for (std::size_t k = 0; k < steps; ++k) rng.normals(0, count, k * factors + f, &z[k * count]);
+        bridge.build(z.data(), count, expected.data());
+        for (std::size_t s = 0; s < steps; ++s) {
+            path.increments(rng, 0, count, s * factors + f, dz.data());
+            for (std::size_t i = 0; i < count; ++i) CHECK(dz[i] == expected[s * count + i]);
+        }
+    }
+}
+
+}
+
+int main() {
+    philox_known_answers();
+    norm_inv_inverts_cdf();
+    random_access<PhiloxRng>();
+    random_access<SobolRng>();
+    philox_single_draws();
+    kernel_matches_scalar_cipher();
+    path_kernels_match_scalar();
+    philox_moments();
+    sobol_moments();
+    brownian_bridge_is_orthogonal();
+    bridge_path_per_factor();
+    return aemps_test::result("test_rng");
+}
@@ -0,0 +1,147 @@
+// Streaming service over pipes: one result per record in input order,
+// prices equal to the batch formula, ERR lines for malformed records, and
+// the stats to match
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "black_scholes.h"
+#include "check.h"
+#include "option.h"
+#include "stream_pricer.h"
+
+using namespace aemps;
+
+namespace {
+
+struct Record {
+    std::string id;
+    Option opt;
+    double vol, rate;
+    const char* error; // expected ERR reason, null if well formed
+};
+
+// Feeds `input` through run_stream on a pair of pipes, collecting the output
+std::string run(const std::string& input, const StreamConfig& config, StreamStats& stats) {
+    int in[2], out[2];
+    CHECK(::pipe(in) == 0 && ::pipe(out) == 0);
+    std::thread feeder([&] {
+        for (std::size_t done = 0; done < input.size();) {
+            const ssize_t n = ::write(in[1], input.data() + done, input.size() - done);
+            if (n <= 0) break;
+            done += static_cast<std::size_t>(n);
+        }
+        ::close(in[1]);
+    });
+    std::string output;
+    std::thread drain([&] {
+        char buf[4096];
+        for (ssize_t n; (n = ::read(out[0], buf, sizeof buf)) > 0;) output.append(buf, static_cast<std::size_t>(n));
+    });
+    stats = run_stream(in[0], out[1], config);
+    ::close(out[1]);
+    feeder.join();
+    drain.join();
+    ::close(in[0]);
+    ::close(out[0]);
+    return output;
+}
+
+std::vector<std::string> split(const std::string& s, char sep) {
+    std::vector<std::string> parts;
+    std::size_t start = 0;
+    for (std::size_t i = 0; i <= s.size(); ++i)
+        if (i == s.size() || s[i] == sep) {
+            parts.push_back(s.substr(start, i - start));
+            start = i + 1;
+        }
+    return parts;
+}
+
+void ordered_results_and_errors(bool greeks) {
+    std::mt19937_64 gen(23);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    std::vector<Record> records;
+    std::string input = "# id,type,strike,maturity,spot,vol,rate\n";
+    for (std::size_t i = 0; i < 5000; ++i) {
+        const bool put = u(gen) < 0.5;
+        Record r{"t" + std::to_string(i),
+                 Option(put ? OptionType::Put : OptionType::Call, 50.0 + 100.0 * u(gen), 0.05 + 2.0 * u(gen),
+                        80.0 + 40.0 * u(gen)),
+                 0.1 + 0.5 * u(gen), 0.05 * u(gen), nullptr};
+        const char* type = i % 8 == 0   ? (put ? "Put" : "CALL")
+                           : i % 4 == 0 ? (put ? "put" : "call")
+                           : i % 2 == 0 ? (put ? "p" : "c")
+                                        : (put ? "P" : "C");
+        std::string line = r.id + "," + type + "," + std::to_string(r.opt.strike) + "," +
+                           std::to_string(r.opt.maturity) + "," + std::to_string(r.opt.spot) + "," +
+                           std::to_string(r.vol) + "," + std::to_string(r.rate);
+        // std::to_string rounds to 6 decimals; price what was sent
+        const std::vector<std::string> f = split(line, ',');
+        r.opt = Option(r.opt.type, std::strtod(f[2].c_str(), nullptr), std::strtod(f[3].c_str(), nullptr),
+                       std::strtod(f[4].c_str(), nullptr));
+        r.vol = std::strtod(f[5].c_str(), nullptr);
+        r.rate = std::strtod(f[6].c_str(), nullptr);
+        switch (i % 97) {
+        case 13: line = r.id + ",C,100,1,100,0.2"; r.error = "expected 7 fields"; break;
+        case 29: line = r.id + ",X,100,1,100,0.2,0.01"; r.error = "bad option type"; break;
+        case 31: line = r.id + ",Cx,100,1,100,0.2,0.01"; r.error = "bad option type"; break;
+        case 37: line = r.id + ",puts,100,1,100,0.2,0.01"; r.error = "bad option type"; break;
+        case 43: line = r.id + ",,100,1,100,0.2,0.01"; r.error = "bad option type"; break;
+        case 41: line = r.id + ",P,100,1y,100,0.2,0.01"; r.error = "bad number"; break;
+        case 53: line = r.id + ",P,100,1,100,0.2,"; r.error = "bad number"; break;
+        default: break;
+        }
+        input += line + "\n";
+        if (i % 500 == 7) input += "\n# comment\n";
+        records.push_back(r);
+    }
+
+    StreamConfig config;
+    config.workers = 3;
+    config.batch_size = 64;
+    config.greeks = greeks;
+    StreamStats stats;
+    const std::vector<std::string> lines = split(run(input, config, stats), '\n');
+    CHECK(stats.records == records.size() && !stats.write_failed);
+    CHECK(lines.size() == records.size() + 1 && lines.back().empty());
+    std::uint64_t errors = 0;
+    for (std::size_t i = 0; i < records.size() && i + 1 < lines.size(); ++i) {
+        const Record& r = records[i];
+        const std::vector<std::string> f = split(lines[i], ',');
+        CHECK(f[0] == r.id);
+        if (r.error) {
+            ++errors;
+            CHECK(f.size() == 3 && f[1] == "ERR" && f[2] == r.error);
+            continue;
+        }
+        CHECK(f.size() == (greeks ? 7u : 2u));
+        const Greeks g = BlackScholes::greeks(r.opt, r.rate, r.vol);
+        CHECK_NEAR(std::strtod(f[1].c_str(), nullptr), g.price, 1e-12 * r.opt.spot);
+        if (greeks && f.size() == 7) {
+            CHECK_NEAR(std::strtod(f[2].c_str(), nullptr), g.delta, 1e-12);
+            CHECK_NEAR(std::strtod(f[6].c_str(), nullptr), g.rho, 1e-10 * r.opt.spot);
+        }
+    }
+    CHECK(stats.errors == errors && errors > 0);
+    CHECK(stats.batches >= (records.size() + config.batch_size - 1) / config.batch_size);
+}
+
+void empty_input() {
+    StreamStats stats;
+    CHECK(run("", StreamConfig(), stats).empty());
+    CHECK(stats.records == 0 && stats.errors == 0);
+}
+
+}
+
+int main() {
+    ordered_results_and_errors(true);
+    ordered_results_and_errors(false);
+    empty_input();
+    return aemps_test::result("test_stream_pricer");
+}
@@ -0,0 +1,71 @@
+// Work-stealing pool: every index runs exactly once whatever the balance of
+// work, exceptions reach the caller and the pool stays usable after one
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "check.h"
+#include "thread_pool.h"
+
+using namespace aemps;
+
+namespace {
+
+void every_index_once(ThreadPool& pool) {
+    for (std::size_t n : {0, 1, 3, 7, 64, 1000, 4099}) {
+        std::vector<std::atomic<int>> runs(n);
+        for (auto& r : runs) r = 0;
+        pool.parallel_for(n, [&](std::size_t i) { ++runs[i]; });
+        bool once = true;
+        for (auto& r : runs) once = once && r == 1;
+        CHECK(once);
+    }
+}
+
+// All the work sits in the first slice, so the others must steal it
+void skewed_work_is_stolen(ThreadPool& pool) {
+    const std::size_t n = 64;
+    std::vector<std::atomic<int>> runs(n);
+    for (auto& r : runs) r = 0;
+    pool.parallel_for(n, [&](std::size_t i) {
+        if (i < n / 4) std::this_thread::sleep_for(std::chrono::microseconds(200));
+        ++runs[i];
+    });
+    bool once = true;
+    for (auto& r : runs) once = once && r == 1;
+    CHECK(once);
+}
+
+void exceptions_propagate(ThreadPool& pool) {
+    std::atomic<std::size_t> ran{0};
+    bool threw = false;
+    try {
+        pool.parallel_for(100, [&](std::size_t i) {
+            ++ran;
+            if (i == 37) throw std::runtime_error("index 37");
+        });
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+    // The loop drains before rethrowing
+    CHECK(ran == 100);
+    std::atomic<std::size_t> after{0};
+    pool.parallel_for(50, [&](std::size_t) { ++after; });
+    CHECK(after == 50);
+}
+
+}
+
+int main() {
+    for (std::size_t threads : {1, 2, 4}) {
+        ThreadPool pool(threads);
+        CHECK(pool.concurrency() == threads + 1);
+        every_index_once(pool);
+        skewed_work_is_stolen(pool);
+        exceptions_propagate(pool);
+    }
+    return aemps_test::result("test_thread_pool");
+}
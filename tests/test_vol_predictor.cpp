@@ -0,0 +1,143 @@
+// Prediction cache: one model call per (underlier, snapshot) however many
+// callers ask, LRU eviction, invalidation, and predictor failures that
+// reach every caller without being cached
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "check.h"
+#include "vol_predictor.h"
+
+using namespace aemps;
+
+namespace {
+
+// Predicts 0.1 + the row's first feature, slowly enough that concurrent
+// callers overlap; throws while `fail` is set
+class CountingPredictor : public VolPredictor {
+public:
+    void predict(const FeatureMatrix& features, double* out) const override {
+        ++calls;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        if (fail) throw std::runtime_error("model down");
+        for (std::size_t i = 0; i < features.rows; ++i) out[i] = 0.1 + features.data[i * features.cols];
+    }
+
+    mutable std::atomic<int> calls{0};
+    std::atomic<bool> fail{false};
+};
+
+const std::vector<double> kFeatures{0.1, 1.0, 0.2, 2.0, 0.3, 3.0, 0.15, 4.0, 0.25, 5.0, 0.35, 6.0};
+const FeatureMatrix kMatrix{kFeatures.data(), 6, 2};
+
+void repeats_hit_the_cache() {
+    auto model = std::make_shared<CountingPredictor>();
+    VolPredictionCache cache(model);
+    const VolPredictionCache::Predictions first = cache.predict("SPX", 1, kMatrix);
+    CHECK(first->size() == 6);
+    CHECK_NEAR((*first)[2], 0.4, 1e-15);
+    // The features are not read on a hit
+    const VolPredictionCache::Predictions again = cache.predict("SPX", 1, FeatureMatrix{});
+    CHECK(again == first);
+    cache.predict("SPX", 2, kMatrix);
+    cache.predict("NDX", 1, kMatrix);
+    CHECK(model->calls == 3 && cache.hits() == 1 && cache.misses() == 3 && cache.size() == 3);
+}
+
+void concurrent_misses_share_one_call() {
+    auto model = std::make_shared<CountingPredictor>();
+    VolPredictionCache cache(model);
+    std::vector<VolPredictionCache::Predictions> seen(8);
+    std::vector<std::thread> callers;
+    for (std::size_t t = 0; t < seen.size(); ++t)
+        callers.emplace_back([&, t] { seen[t] = cache.predict("SPX", 7, kMatrix); });
+    for (std::thread& t : callers) t.join();
+    CHECK(model->calls == 1);
+    for (const auto& p : seen) CHECK(p == seen[0]);
+    CHECK(cache.misses() == 1 && cache.hits() == seen.size() - 1);
+}
+
+void least_recent_key_is_evicted() {
+    auto model = std::make_shared<CountingPredictor>();
+    VolPredictionCache cache(model, 2);
+    cache.predict("A", 1, kMatrix);
+    cache.predict("B", 1, kMatrix);
+    cache.predict("A", 1, kMatrix); // B is now least recent
+    cache.predict("C", 1, kMatrix);
+    CHECK(cache.size() == 2 && model->calls == 3);
+    cache.predict("A", 1, kMatrix);
+    CHECK(model->calls == 3);
+    cache.predict("B", 1, kMatrix);
+    CHECK(model->calls == 4);
+}
+
+void invalidate_drops_every_snapshot() {
+    auto model = std::make_shared<CountingPredictor>();
+    VolPredictionCache cache(model);
+    cache.predict("SPX", 1, kMatrix);
+    cache.predict("SPX", 2, kMatrix);
+    cache.predict("SPXW", 1, kMatrix);
+    cache.invalidate("SPX");
+    CHECK(cache.size() == 1);
+    cache.predict("SPXW", 1, kMatrix);
+    CHECK(model->calls == 3);
+    cache.predict("SPX", 2, kMatrix);
+    CHECK(model->calls == 4);
+    cache.clear();
+    CHECK(cache.size() == 0);
+}
+
+void failures_reach_every_waiter_uncached() {
+    auto model = std::make_shared<CountingPredictor>();
+    model->fail = true;
+    VolPredictionCache cache(model);
+    std::atomic<int> failed{0};
+    std::vector<std::thread> callers;
+    for (int t = 0; t < 4; ++t)
+        callers.emplace_back([&] {
+            try {
+                cache.predict("SPX", 1, kMatrix);
+            } catch (const std::runtime_error&) {
+                ++failed;
+            }
+        });
+    for (std::thread& t : callers) t.join();
+    CHECK(failed == 4 && cache.size() == 0);
+    model->fail = false;
+    CHECK(cache.predict("SPX", 1, kMatrix)->size() == 6);
+}
+
+void surfaces_are_built_once_per_key() {
+    auto model = std::make_shared<CountingPredictor>();
+    VolPredictionCache cache(model);
+    const std::vector<double> strikes{90.0, 100.0, 110.0}, maturities{0.5, 1.0};
+    const auto a = cache.surface("SPX", 1, strikes, maturities, kMatrix);
+    const auto b = cache.surface("SPX", 1, strikes, maturities, kMatrix);
+    CHECK(a == b && model->calls == 1);
+    // Maturity-major rows: row 4 is (1.0, 100)
+    CHECK_NEAR(a->volatility(100.0, 1.0), 0.35, 1e-14);
+    bool threw = false;
+    try {
+        cache.surface("SPX", 2, strikes, {0.5}, kMatrix);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    CHECK(threw && model->calls == 1);
+}
+
+}
+
+int main() {
+    repeats_hit_the_cache();
+    concurrent_misses_share_one_call();
+    least_recent_key_is_evicted();
+    invalidate_drops_every_snapshot();
+    failures_reach_every_waiter_uncached();
+    surfaces_are_built_once_per_key();
+    return aemps_test::result("test_vol_predictor");
+}
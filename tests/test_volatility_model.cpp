@@ -0,0 +1,136 @@
+// Volatility models: the grid surface against its nodes and interpolation
+// rules, batch queries against scalar ones, and both engines priced off a
+// model against the same contracts priced at the model's vol
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "black_scholes.h"
+#include "check.h"
+#include "monte_carlo_pricer.h"
+#include "option.h"
+#include "rng.h"
+#include "volatility_model.h"
+
+using namespace aemps;
+
+namespace {
+
+// Uneven axes so the bucket tables have to step
+GridVolSurface make_surface() {
+    const std::vector<double> strikes{60.0, 80.0, 95.0, 100.0, 105.0, 120.0, 150.0};
+    const std::vector<double> maturities{0.1, 0.25, 0.5, 1.0, 2.0, 3.0};
+    std::vector<double> vols;
+    for (double t : maturities)
+        for (double k : strikes) vols.push_back(0.2 + 0.1 * std::abs(std::log(k / 100.0)) / std::sqrt(t) + 0.01 * t);
+    return GridVolSurface(strikes, maturities, vols);
+}
+
+void grid_reproduces_nodes_and_interpolates_variance() {
+    const GridVolSurface surface = make_surface();
+    const std::vector<double>& ks = surface.strikes();
+    const std::vector<double>& ts = surface.maturities();
+    for (double t : ts)
+        for (double k : ks) {
+            const double v = 0.2 + 0.1 * std::abs(std::log(k / 100.0)) / std::sqrt(t) + 0.01 * t;
+            CHECK_NEAR(surface.volatility(k, t), v, 1e-14);
+            CHECK_NEAR(surface.total_variance(k, t), v * v * t, 1e-14);
+        }
+    // Total variance is linear along each axis between nodes
+    const double t = 0.7, k = 97.0;
+    const double bt = (t - 0.5) / 0.5, bk = (k - 95.0) / 5.0;
+    CHECK_NEAR(surface.total_variance(95.0, t),
+               (1.0 - bt) * surface.total_variance(95.0, 0.5) + bt * surface.total_variance(95.0, 1.0), 1e-14);
+    CHECK_NEAR(surface.total_variance(k, 1.0),
+               (1.0 - bk) * surface.total_variance(95.0, 1.0) + bk * surface.total_variance(100.0, 1.0), 1e-14);
+    // Flat in strike beyond the grid, flat in vol beyond the maturities
+    CHECK_NEAR(surface.volatility(10.0, 1.0), surface.volatility(60.0, 1.0), 1e-14);
+    CHECK_NEAR(surface.volatility(500.0, 1.0), surface.volatility(150.0, 1.0), 1e-14);
+    CHECK_NEAR(surface.volatility(100.0, 0.01), surface.volatility(100.0, 0.1), 1e-14);
+    CHECK_NEAR(surface.volatility(100.0, 10.0), surface.volatility(100.0, 3.0), 1e-14);
+    CHECK(surface.total_variance(100.0, 0.0) == 0.0);
+}
+
+void bad_grids_throw() {
+    const auto throws = [](std::vector<double> k, std::vector<double> t, std::vector<double> v) {
+        try {
+            GridVolSurface(std::move(k), std::move(t), std::move(v));
+        } catch (const std::invalid_argument&) {
+            return true;
+        }
+        return false;
+    };
+    CHECK(throws({}, {1.0}, {}));
+    CHECK(throws({100.0, 100.0}, {1.0}, {0.2, 0.2}));
+    CHECK(throws({100.0}, {1.0, 0.5}, {0.2, 0.2}));
+    CHECK(throws({100.0}, {0.0, 1.0}, {0.2, 0.2}));
+    CHECK(throws({90.0, 110.0}, {1.0}, {0.2}));
+    CHECK(!throws({100.0}, {1.0}, {0.2}));
+}
+
+OptionBook make_book(std::size_t n) {
+    std::mt19937_64 gen(17);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    OptionBook book;
+    book.reserve(n);
+    for (std::size_t i = 0; i < n; ++i)
+        book.push_back(Option(i % 2 ? OptionType::Put : OptionType::Call, 40.0 + 130.0 * u(gen), 0.02 + 3.5 * u(gen),
+                              100.0),
+                       0.0, 0.05 * u(gen));
+    return book;
+}
+
+// More than one 256-contract chunk, with a partial last one
+void batch_engines_match_scalar() {
+    const GridVolSurface surface = make_surface();
+    const OptionBook book = make_book(601);
+    const std::size_t n = book.size();
+    std::vector<double> vols(n), prices(n), delta(n), vega(n);
+    surface.volatility(book.strike.data(), book.maturity.data(), n, vols.data());
+    BlackScholes::price(book.view(), surface, prices.data());
+    GreeksOutput out;
+    out.delta = delta.data();
+    out.vega = vega.data();
+    BlackScholes::greeks(book.view(), surface, out);
+    for (std::size_t i = 0; i < n; ++i) {
+        CHECK(vols[i] == surface.volatility(book.strike[i], book.maturity[i]));
+        const Option opt(book.type[i], book.strike[i], book.maturity[i], book.spot[i]);
+        const Greeks g = BlackScholes::greeks(opt, book.rate[i], vols[i]);
+        CHECK_NEAR(prices[i], g.price, 1e-12 * opt.spot);
+        CHECK_NEAR(delta[i], g.delta, 1e-12);
+        CHECK_NEAR(vega[i], g.vega, 1e-10 * opt.spot);
+    }
+    std::vector<double> flat(n);
+    FlatVolatility(0.3).volatility(book.strike.data(), book.maturity.data(), n, flat.data());
+    for (double v : flat) CHECK(v == 0.3);
+}
+
+// A vanilla diffused along the strike's forward variances prices at the
+// surface vol, and a flat model is the flat-vol engine
+void monte_carlo_reads_the_surface() {
+    McConfig config;
+    config.paths = 200000;
+    config.steps = 12;
+    config.variance_reduction = VarianceReduction::Antithetic;
+    const MonteCarloPricer<PhiloxRng> pricer(config);
+    const GridVolSurface surface = make_surface();
+    const Option call(OptionType::Call, 90.0, 1.7, 100.0);
+    const double rate = 0.02;
+    const McResult r = pricer.price(call, rate, surface);
+    CHECK_NEAR(r.price, BlackScholes::price(call, rate, surface.volatility(90.0, 1.7)), 4.0 * r.std_error);
+    const McResult flat = pricer.price(call, rate, FlatVolatility(0.25));
+    const McResult ref = pricer.price(call, rate, 0.25);
+    CHECK_NEAR(flat.price, ref.price, 1e-12 * ref.price);
+    CHECK_NEAR(flat.std_error, ref.std_error, 1e-12 * ref.std_error);
+}
+
+}
+
+int main() {
+    grid_reproduces_nodes_and_interpolates_variance();
+    bad_grids_throw();
+    batch_engines_match_scalar();
+    monte_carlo_reads_the_surface();
+    return aemps_test::result("test_volatility_model");
+}